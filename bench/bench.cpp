@@ -0,0 +1,168 @@
+/**
+ * @file      bench.cpp
+ * @brief     Measurement helpers of the benchmarks on the POSIX port
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "bench.h"
+#include "freertos/thread.h"
+#include "freertos/scheduler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace freertos;
+
+static int open_counter(std::uint64_t config, int group_fd)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // the calling thread only, on any CPU
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+static std::uint64_t read_counter(int fd)
+{
+    std::uint64_t value = 0;
+    if ((fd < 0) || (read(fd, &value, sizeof(value)) != sizeof(value)))
+    {
+        return 0;
+    }
+    return value;
+}
+
+static std::uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+namespace bench
+{
+    counters::counters()
+        : instr_fd_(open_counter(PERF_COUNT_HW_INSTRUCTIONS, -1)),
+          cycles_fd_(open_counter(PERF_COUNT_HW_CPU_CYCLES, instr_fd_)),
+          start_ns_(0)
+    {
+        if ((instr_fd_ < 0) || (cycles_fd_ < 0))
+        {
+            std::printf("note: perf events are unavailable (instructions: %s, cycles: %s), "
+                    "check /proc/sys/kernel/perf_event_paranoid\n",
+                    (instr_fd_ < 0) ? "no" : "yes", (cycles_fd_ < 0) ? "no" : "yes");
+        }
+    }
+
+    counters::~counters()
+    {
+        if (cycles_fd_ >= 0)
+        {
+            close(cycles_fd_);
+        }
+        if (instr_fd_ >= 0)
+        {
+            close(instr_fd_);
+        }
+    }
+
+    void counters::start()
+    {
+        if (instr_fd_ >= 0)
+        {
+            ioctl(instr_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(instr_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+        start_ns_ = now_ns();
+    }
+
+    sample counters::stop(std::size_t iterations)
+    {
+        const std::uint64_t end_ns = now_ns();
+        if (instr_fd_ >= 0)
+        {
+            ioctl(instr_fd_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+        const double n = static_cast<double>(iterations);
+        return sample {
+            read_counter(instr_fd_) / n,
+            read_counter(cycles_fd_) / n,
+            (end_ns - start_ns_) / n };
+    }
+
+    void print_header(const char *title)
+    {
+        std::printf("\n%-44s %12s %12s %12s\n", title, "instructions", "cycles", "ns");
+    }
+
+    void print_row(const counters& c, const char *name, const sample& s)
+    {
+        char instructions[16] = "-";
+        char cycles[16] = "-";
+        if (c.has_instructions())
+        {
+            std::snprintf(instructions, sizeof(instructions), "%.1f", s.instructions);
+        }
+        if (c.has_cycles())
+        {
+            std::snprintf(cycles, sizeof(cycles), "%.1f", s.cycles);
+        }
+        std::printf("%-44s %12s %12s %12.1f\n", name, instructions, cycles, s.nanoseconds);
+    }
+
+    static void (*bench_func)();
+
+    static void bench_thread(void *)
+    {
+        bench_func();
+        std::fflush(stdout);
+        // the kernel's threads and objects aren't torn down
+        std::_Exit(EXIT_SUCCESS);
+    }
+
+    void run(void (*func)())
+    {
+        static_assert(configMAX_PRIORITIES > 2, "The benchmark runs below the timer task.");
+
+        bench_func = func;
+        static static_thread<64 * 1024> t(&bench_thread, nullptr,
+                thread::priority(configMAX_PRIORITIES - 2), "bench");
+
+        scheduler::start();
+    }
+}
+
+extern "C" void vAssertCalled(const char *file, unsigned long line)
+{
+    std::fprintf(stderr, "assertion failed: %s:%lu\n", file, line);
+    std::abort();
+}
@@ -0,0 +1,122 @@
+/**
+ * @file      bench.h
+ * @brief     Measurement helpers of the benchmarks on the POSIX port
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_BENCH_H_
+#define __FREERTOS_BENCH_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bench
+{
+    /// @brief  The per iteration cost of a measured operation.
+    struct sample
+    {
+        double instructions;
+        double cycles;
+        double nanoseconds;
+    };
+
+    /// @brief  User space instruction and cycle counters of the calling host thread
+    ///         (each kernel task is a separate thread on the POSIX port, so the counters
+    ///         must be created by the measuring task). Without perf event access
+    ///         (e.g. perf_event_paranoid, containers) only the elapsed time is measured.
+    class counters
+    {
+    public:
+        counters();
+        ~counters();
+
+        /// @return true if the instructions are counted
+        bool has_instructions() const
+        {
+            return instr_fd_ >= 0;
+        }
+
+        /// @return true if the cycles are counted
+        bool has_cycles() const
+        {
+            return cycles_fd_ >= 0;
+        }
+
+        void start();
+        sample stop(std::size_t iterations);
+
+    private:
+        int instr_fd_;
+        int cycles_fd_;
+        std::uint64_t start_ns_;
+
+        // non-copyable
+        counters(const counters&) = delete;
+        counters& operator=(const counters&) = delete;
+    };
+
+    /// @brief  Measures an operation several times, and keeps the lowest cost
+    ///         to filter out the tick interrupt and host scheduling noise.
+    /// @param  c: the counters of the calling thread
+    /// @param  iterations: the number of calls in a single run
+    /// @param  op: the measured operation
+    /// @return The lowest per iteration cost
+    template<class Operation>
+    sample measure(counters& c, std::size_t iterations, Operation op)
+    {
+        sample best {};
+        for (unsigned run = 0; run < 5; run++)
+        {
+            c.start();
+            for (std::size_t i = 0; i < iterations; i++)
+            {
+                op();
+            }
+            sample s = c.stop(iterations);
+            if ((run == 0) || (s.instructions < best.instructions))
+            {
+                best.instructions = s.instructions;
+            }
+            if ((run == 0) || (s.cycles < best.cycles))
+            {
+                best.cycles = s.cycles;
+            }
+            if ((run == 0) || (s.nanoseconds < best.nanoseconds))
+            {
+                best.nanoseconds = s.nanoseconds;
+            }
+        }
+        return best;
+    }
+
+    /// @brief  Prints the column titles of @ref print_row.
+    void print_header(const char *title);
+
+    /// @brief  Prints a measurement, the unavailable counters are shown as "-".
+    void print_row(const counters& c, const char *name, const sample& s);
+
+    /// @brief  Runs the benchmark in a kernel task, and exits the process when it returns.
+    /// @param  func: the benchmark function
+    [[noreturn]] void run(void (*func)());
+}
+
+#endif // __FREERTOS_BENCH_H_
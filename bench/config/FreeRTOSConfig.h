@@ -0,0 +1,110 @@
+/**
+ * @file      FreeRTOSConfig.h
+ * @brief     Kernel configuration of the benchmarks on the POSIX port
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void vAssertCalled(const char *file, unsigned long line);
+void vTaskExitHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define configUSE_PREEMPTION                    1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
+#define configUSE_TICKLESS_IDLE                 0
+#define configTICK_RATE_HZ                      1000
+#define configMAX_PRIORITIES                    8
+/* the POSIX port runs the tasks on their own stack, which has to fit PTHREAD_STACK_MIN */
+#define configMINIMAL_STACK_SIZE                4096
+#define configSTACK_DEPTH_TYPE                  uint32_t
+#define configMAX_TASK_NAME_LEN                 16
+#define configTICK_TYPE_WIDTH_IN_BITS           TICK_TYPE_WIDTH_32_BITS
+#define configIDLE_SHOULD_YIELD                 1
+#define configQUEUE_REGISTRY_SIZE               0
+#define configUSE_IDLE_HOOK                     0
+#define configUSE_TICK_HOOK                     0
+#define configUSE_MALLOC_FAILED_HOOK            0
+#define configCHECK_FOR_STACK_OVERFLOW          0
+
+#define configSUPPORT_STATIC_ALLOCATION         1
+#define configSUPPORT_DYNAMIC_ALLOCATION        1
+#define configTOTAL_HEAP_SIZE                   (1024 * 1024)
+#define configTASK_RETURN_ADDRESS               vTaskExitHandler
+
+/* slot 0 is the thread exit condition, the rest are allocated at runtime (fibers) */
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS 4
+#define configTHREAD_EXIT_CONDITION_INDEX       0
+
+#define configUSE_TASK_NOTIFICATIONS            1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES   2
+#define configWAKEUP_NOTIFICATION_INDEX         1
+
+#define configUSE_MUTEXES                       1
+#define configUSE_RECURSIVE_MUTEXES             1
+#define configUSE_COUNTING_SEMAPHORES           1
+#define configUSE_QUEUE_SETS                    1
+
+#define configUSE_TIMERS                        1
+#define configTIMER_TASK_PRIORITY               (configMAX_PRIORITIES - 1)
+#define configTIMER_QUEUE_LENGTH                16
+#define configTIMER_TASK_STACK_DEPTH            configMINIMAL_STACK_SIZE
+
+#define configUSE_TRACE_FACILITY                1
+#define configGENERATE_RUN_TIME_STATS           0
+
+/* the wrapper mode under measurement is selected by the build */
+#ifndef configINLINE_WRAPPERS
+#define configINLINE_WRAPPERS                   0
+#endif
+#define configASSUME_THREAD_CONTEXT             0
+#define configUSE_TRACE_RECORDER                0
+#define configUSE_CRITICAL_SECTION_PROFILER     0
+
+#define INCLUDE_vTaskPrioritySet                1
+#define INCLUDE_uxTaskPriorityGet               1
+#define INCLUDE_vTaskDelete                     1
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_xTaskDelayUntil                 1
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_xTaskGetSchedulerState          1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+#define INCLUDE_xTaskGetIdleTaskHandle          1
+#define INCLUDE_eTaskGetState                   1
+#define INCLUDE_xTaskAbortDelay                 1
+#define INCLUDE_xTaskGetHandle                  1
+#define INCLUDE_xTimerPendFunctionCall          1
+#define INCLUDE_xSemaphoreGetMutexHolder        1
+#define INCLUDE_xTaskResumeFromISR              1
+
+#define configASSERT(x)     if (!(x)) { vAssertCalled(__FILE__, __LINE__); }
+
+#endif /* FREERTOS_CONFIG_H */
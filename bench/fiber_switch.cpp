@@ -0,0 +1,151 @@
+/**
+ * @file      fiber_switch.cpp
+ * @brief     Compares the fiber switch cost to kernel task switches
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "bench.h"
+#include "freertos/fiber.h"
+
+#include <atomic>
+#include <cstdio>
+
+using namespace freertos;
+
+static constexpr std::size_t FIBER_SWITCHES = 100000;
+static constexpr std::size_t TASK_SWITCHES = 10000;
+static constexpr std::size_t FIBER_STACK_SIZE = 16 * 1024;
+static constexpr std::size_t THREAD_STACK_SIZE = 64 * 1024;
+
+// fibers: everything runs in the measuring thread, so all counters are complete
+
+static void fiber_yield(void *)
+{
+    for (std::size_t i = 0; i < FIBER_SWITCHES / 2; i++)
+    {
+        this_fiber::yield();
+    }
+}
+
+static fiber_wait_queue ping_fibers;
+static fiber_wait_queue pong_fibers;
+
+static void fiber_ping(void *)
+{
+    for (std::size_t i = 0; i < FIBER_SWITCHES / 2; i++)
+    {
+        (void)pong_fibers.notify_one();
+        ping_fibers.wait();
+    }
+}
+
+// started first, so it's already waiting for the first ping
+static void fiber_pong(void *)
+{
+    for (std::size_t i = 0; i < FIBER_SWITCHES / 2; i++)
+    {
+        pong_fibers.wait();
+        (void)ping_fibers.notify_one();
+    }
+}
+
+static bench::sample measure_fibers(bench::counters& c, fiber::function first, fiber::function second)
+{
+    fiber_scheduler sched;
+    static_fiber<FIBER_STACK_SIZE> a(first, nullptr);
+    static_fiber<FIBER_STACK_SIZE> b(second, nullptr);
+
+    // the fibers run in their start order
+    sched.start(a);
+    sched.start(b);
+    c.start();
+    sched.run();
+    return c.stop(FIBER_SWITCHES);
+}
+
+// tasks: each kernel task is a separate host thread on the POSIX port,
+// so the counters only contain the measuring task's part of the switches
+
+static std::atomic<bool> partner_stop;
+
+static void task_yield(void *)
+{
+    while (!partner_stop.load(std::memory_order_relaxed))
+    {
+        this_thread::yield();
+    }
+}
+
+static thread *ping_thread;
+
+static void task_pong(void *)
+{
+    thread::notifier ping(*ping_thread);
+    for (std::size_t i = 0; i < TASK_SWITCHES / 2; i++)
+    {
+        (void)this_thread::wait_signal_for(tick_timer::duration::max());
+        ping.signal();
+    }
+}
+
+static void fiber_switch()
+{
+    bench::counters c;
+    bench::print_header("per switch");
+
+    bench::print_row(c, "fiber yield", measure_fibers(c, &fiber_yield, &fiber_yield));
+    bench::print_row(c, "fiber wait queue ping-pong", measure_fibers(c, &fiber_pong, &fiber_ping));
+
+    {
+        // the partner has the same priority, so each yield switches to it
+        partner_stop = false;
+        static static_thread<THREAD_STACK_SIZE> partner(&task_yield, nullptr,
+                thread::get_current()->get_priority(), "yield");
+
+        c.start();
+        for (std::size_t i = 0; i < TASK_SWITCHES / 2; i++)
+        {
+            this_thread::yield();
+        }
+        bench::print_row(c, "thread yield", c.stop(TASK_SWITCHES));
+        partner_stop = true;
+    }
+    {
+        ping_thread = thread::get_current();
+        static static_thread<THREAD_STACK_SIZE> partner(&task_pong, nullptr,
+                thread::get_current()->get_priority(), "pong");
+        thread::notifier pong(partner);
+
+        c.start();
+        for (std::size_t i = 0; i < TASK_SWITCHES / 2; i++)
+        {
+            pong.signal();
+            (void)this_thread::wait_signal_for(tick_timer::duration::max());
+        }
+        bench::print_row(c, "thread notification ping-pong", c.stop(TASK_SWITCHES));
+    }
+}
+
+int main()
+{
+    bench::run(&fiber_switch);
+}
@@ -0,0 +1,109 @@
+/**
+ * @file      parallel_scaling.cpp
+ * @brief     Measures the scaling of parallel_for and parallel_reduce with the worker count
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "bench.h"
+#include "freertos/parallel.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace freertos;
+
+// the POSIX port runs a single kernel task at a time (even on SMP kernels),
+// so on the host the results show the fork-join overhead, and the speedup
+// is only measurable on multi-core targets
+static constexpr std::size_t COUNT = 1 << 18;
+static constexpr std::size_t GRAIN = 1024;
+static constexpr std::size_t WORKER_STACK_SIZE = 64 * 1024;
+
+static float data[COUNT];
+
+static void transform(std::size_t first, std::size_t last)
+{
+    for (std::size_t i = first; i < last; i++)
+    {
+        data[i] = std::sqrt(data[i] * 1.0001f + 1.0f);
+    }
+}
+
+static double sum(std::size_t first, std::size_t last, double acc)
+{
+    for (std::size_t i = first; i < last; i++)
+    {
+        acc += data[i];
+    }
+    return acc;
+}
+
+static void print_row(const char *name, std::size_t workers, const bench::sample& s, double serial_ns)
+{
+    std::printf("%-16s %8zu %12.3f %10.2f %16.0f\n", name, workers,
+            s.nanoseconds / 1e6, serial_ns / s.nanoseconds, s.instructions);
+}
+
+template<const std::size_t WORKERS>
+static void measure_workers(bench::counters& c, const bench::sample& serial_for,
+        const bench::sample& serial_reduce)
+{
+    // the workers run at the caller's priority, so they share the time slices with it
+    static executor<WORKERS, WORKER_STACK_SIZE, 2 * WORKERS> ex(
+            thread::get_current()->get_priority(), "worker");
+
+    print_row("parallel_for", WORKERS,
+            bench::measure(c, 1, []{ parallel_for(ex, std::size_t(0), COUNT, GRAIN, transform); }),
+            serial_for.nanoseconds);
+    volatile double result;
+    print_row("parallel_reduce", WORKERS,
+            bench::measure(c, 1, [&]{
+                result = parallel_reduce(ex, std::size_t(0), COUNT, GRAIN, 0.0, sum,
+                        [](double a, double b) { return a + b; });
+            }),
+            serial_reduce.nanoseconds);
+    (void)result;
+}
+
+static void parallel_scaling()
+{
+    bench::counters c;
+    std::printf("\n%-16s %8s %12s %10s %16s\n", "", "workers", "ms", "speedup", "caller instr.");
+
+    // the caller processes the whole range alone
+    const bench::sample serial_for = bench::measure(c, 1, []{ transform(0, COUNT); });
+    print_row("serial for", 0, serial_for, serial_for.nanoseconds);
+    volatile double result;
+    const bench::sample serial_reduce = bench::measure(c, 1, [&]{ result = sum(0, COUNT, 0.0); });
+    print_row("serial reduce", 0, serial_reduce, serial_reduce.nanoseconds);
+    (void)result;
+
+    measure_workers<1>(c, serial_for, serial_reduce);
+    measure_workers<2>(c, serial_for, serial_reduce);
+    measure_workers<3>(c, serial_for, serial_reduce);
+    measure_workers<4>(c, serial_for, serial_reduce);
+}
+
+int main()
+{
+    bench::run(&parallel_scaling);
+}
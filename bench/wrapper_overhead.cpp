@@ -0,0 +1,164 @@
+/**
+ * @file      wrapper_overhead.cpp
+ * @brief     Measures each wrapper call next to the kernel API call it wraps
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "bench.h"
+#include "freertos/condition_flags.h"
+#include "freertos/condition_variable.h"
+#include "freertos/cpu.h"
+#include "freertos/mutex.h"
+#include "freertos/queue.h"
+#include "freertos/semaphore.h"
+#include "freertos/thread.h"
+#include "freertos/tick_timer.h"
+#include "freertos/timed_service.h"
+
+#include <cstdio>
+#include <mutex>
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "event_groups.h"
+        #include "queue.h"
+        #include "semphr.h"
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+// every operation is a non-blocking pair that returns the object to its initial state,
+// so the measurement contains no context switch
+static constexpr std::size_t ITERATIONS = 100000;
+
+template<class Wrapper, class Raw>
+static void compare(bench::counters& c, const char *wrapper_name, Wrapper wrapper,
+        const char *raw_name, Raw raw)
+{
+    const bench::sample w = bench::measure(c, ITERATIONS, wrapper);
+    const bench::sample r = bench::measure(c, ITERATIONS, raw);
+    bench::print_row(c, wrapper_name, w);
+    bench::print_row(c, raw_name, r);
+    bench::print_row(c, "  wrapper overhead", bench::sample {
+            w.instructions - r.instructions, w.cycles - r.cycles, w.nanoseconds - r.nanoseconds });
+}
+
+static void print_size(const char *wrapper_name, std::size_t wrapper_size,
+        const char *kernel_name, std::size_t kernel_size)
+{
+    std::printf("%-28s %6zu   %-24s %6zu\n", wrapper_name, wrapper_size, kernel_name, kernel_size);
+}
+
+static void print_sizes()
+{
+    std::printf("\n%-28s %6s   %-24s %6s\n", "wrapper", "bytes", "kernel object", "bytes");
+    print_size("thread", sizeof(thread), "StaticTask_t", sizeof(StaticTask_t));
+    print_size("queue", sizeof(queue), "StaticQueue_t", sizeof(StaticQueue_t));
+    print_size("binary_semaphore", sizeof(binary_semaphore), "StaticSemaphore_t", sizeof(StaticSemaphore_t));
+    print_size("mutex", sizeof(mutex), "StaticSemaphore_t", sizeof(StaticSemaphore_t));
+    print_size("condition_flags", sizeof(condition_flags), "StaticEventGroup_t", sizeof(StaticEventGroup_t));
+    print_size("condition_variable_any", sizeof(condition_variable_any), "StaticQueue_t", sizeof(StaticQueue_t));
+    print_size("timed_service", sizeof(timed_service), "StaticTimer_t", sizeof(StaticTimer_t));
+}
+
+static void wrapper_overhead()
+{
+    std::printf("configINLINE_WRAPPERS = %d\n", configINLINE_WRAPPERS);
+    bench::counters c;
+    bench::print_header("per call pair");
+
+    {
+        shallow_copy_queue<int, 4> q;
+        static StaticQueue_t raw_buffer;
+        static std::uint8_t raw_storage[4 * sizeof(int)];
+        QueueHandle_t raw = xQueueCreateStatic(4, sizeof(int), raw_storage, &raw_buffer);
+        int value = 0;
+
+        compare(c, "queue::push_back + pop_front", [&]{ q.push_back(value); q.pop_front(&value); },
+                "xQueueSendToBack + xQueueReceive",
+                [&]{ xQueueSendToBack(raw, &value, 0); xQueueReceive(raw, &value, 0); });
+        vQueueDelete(raw);
+    }
+    {
+        binary_semaphore sem;
+        static StaticSemaphore_t raw_buffer;
+        SemaphoreHandle_t raw = xSemaphoreCreateBinaryStatic(&raw_buffer);
+
+        compare(c, "binary_semaphore::release + try_acquire", [&]{ sem.release(); sem.try_acquire(); },
+                "xSemaphoreGive + xSemaphoreTake",
+                [&]{ xSemaphoreGive(raw); xSemaphoreTake(raw, 0); });
+        vSemaphoreDelete(raw);
+    }
+    {
+        mutex m;
+        static StaticSemaphore_t raw_buffer;
+        SemaphoreHandle_t raw = xSemaphoreCreateMutexStatic(&raw_buffer);
+
+        compare(c, "mutex::lock + unlock", [&]{ m.lock(); m.unlock(); },
+                "xSemaphoreTake + xSemaphoreGive",
+                [&]{ xSemaphoreTake(raw, portMAX_DELAY); xSemaphoreGive(raw); });
+        vSemaphoreDelete(raw);
+    }
+    {
+        condition_flags flags;
+        static StaticEventGroup_t raw_buffer;
+        EventGroupHandle_t raw = xEventGroupCreateStatic(&raw_buffer);
+
+        compare(c, "condition_flags::set + clear", [&]{ flags.set(1); flags.clear(1); },
+                "xEventGroupSetBits + xEventGroupClearBits",
+                [&]{ xEventGroupSetBits(raw, 1); xEventGroupClearBits(raw, 1); });
+        vEventGroupDelete(raw);
+    }
+    {
+        volatile TickType_t sink;
+
+        compare(c, "tick_timer::now", [&]{ sink = tick_timer::now().time_since_epoch().count(); },
+                "xTaskGetTickCount", [&]{ sink = xTaskGetTickCount(); });
+        (void)sink;
+    }
+    {
+        cpu::critical_section cs;
+
+        compare(c, "lock_guard<cpu::critical_section>", [&]{ const std::lock_guard<decltype(cs)> lock(cs); },
+                "taskENTER_CRITICAL + taskEXIT_CRITICAL", []{ taskENTER_CRITICAL(); taskEXIT_CRITICAL(); });
+    }
+    {
+        thread::notifier n(*thread::get_current());
+        TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+        compare(c, "notifier::signal + wait_signal_for(0)",
+                [&]{ n.signal(); this_thread::wait_signal_for(tick_timer::duration(0)); },
+                "xTaskNotify + xTaskNotifyWait",
+                [&]{ xTaskNotify(self, 0, eNoAction); xTaskNotifyWait(0, 0, nullptr, 0); });
+    }
+
+    print_sizes();
+}
+
+int main()
+{
+    bench::run(&wrapper_overhead);
+}
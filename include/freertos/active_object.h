@@ -0,0 +1,383 @@
+/**
+ * @file      active_object.h
+ * @brief     Active objects: threads with event queues, typed dispatch and pooled events
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_ACTIVE_OBJECT_H_
+#define __FREERTOS_ACTIVE_OBJECT_H_
+
+#include "freertos/queue.h"
+#include "freertos/thread.h"
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace freertos
+{
+    class event_pool_base;
+    class active_object_base;
+
+    /// @brief  The common header of all events. Events are passed by pointer,
+    ///         and are reference counted when allocated from an @ref event_pool.
+    ///         Events that aren't allocated from a pool (e.g. constant static events)
+    ///         are never freed.
+    class event
+    {
+    public:
+        using type_id = const void*;
+
+        /// @return The unique identifier of the event's type
+        type_id get_type() const
+        {
+            return type_;
+        }
+
+        /// @return true if the event's type is E
+        template<class E>
+        bool is() const
+        {
+            return type_ == E::type();
+        }
+
+    protected:
+        explicit constexpr event(type_id type)
+            : type_(type), pool_(nullptr), refs_(0)
+        {
+        }
+
+    private:
+        friend class event_pool_base;
+
+        // acquires and releases a reference to the event
+        friend void retain(const event *e);
+        friend void release(const event *e);
+
+        const type_id type_;
+        event_pool_base *pool_;
+        std::uint8_t refs_;
+    };
+
+    /// @brief  Takes a reference of the event, keeping it from being freed.
+    /// @remark Thread and ISR context callable
+    void retain(const event *e);
+
+    /// @brief  Drops a reference of the event, the pooled event is freed when the last one is dropped.
+    /// @remark Thread and ISR context callable
+    void release(const event *e);
+
+    /// @brief  The base class of concrete event types, provides the compile-time type identifier.
+    /// @tparam Derived: the event type
+    template<class Derived>
+    class event_base : public event
+    {
+    public:
+        /// @return The unique identifier of the Derived event type
+        static constexpr type_id type()
+        {
+            return &tag;
+        }
+
+    protected:
+        constexpr event_base()
+            : event(type())
+        {
+        }
+
+    private:
+        static constexpr char tag = 0;
+    };
+
+    template<class Derived>
+    constexpr char event_base<Derived>::tag;
+
+    /// @brief  The non-template part of @ref event_pool, manages the free blocks.
+    class event_pool_base
+    {
+    public:
+        /// @return The number of free events in the pool
+        /// @remark Thread and ISR context callable
+        std::size_t get_free_count() const;
+
+    protected:
+        using destructor = void (*)(event*);
+
+        event_pool_base(void *blocks, std::size_t block_size, std::size_t count, destructor dtor);
+
+        // takes a free block, or returns nullptr when the pool is exhausted
+        void *allocate();
+
+        // registers the constructed event in the pool, with one reference for the allocator
+        event *adopt(event *e)
+        {
+            e->pool_ = this;
+            e->refs_ = 1;
+            return e;
+        }
+
+    private:
+        friend void release(const event *e);
+
+        struct free_block
+        {
+            free_block *next;
+        };
+
+        void free(event *e);
+
+        free_block *free_list_;
+        const destructor destroy_;
+
+        // non-copyable
+        event_pool_base(const event_pool_base&) = delete;
+        event_pool_base& operator=(const event_pool_base&) = delete;
+    };
+
+    /// @brief  A fixed size pool of a single event type, the events are reference counted
+    ///         and return to the pool when the last reference is released.
+    /// @tparam E: the event type
+    /// @tparam COUNT: the number of events in the pool
+    template<class E, const std::size_t COUNT>
+    class event_pool : public event_pool_base
+    {
+        static_assert(std::is_base_of<event, E>::value, "The pool's type must be an event.");
+
+    public:
+        event_pool()
+            : event_pool_base(blocks_, sizeof(blocks_[0]), COUNT, &destroy)
+        {
+        }
+
+        /// @brief  Allocates and constructs an event.
+        /// @param  args: the arguments to pass to the event's constructor
+        /// @return The new event with a single reference held by the caller,
+        ///         or nullptr if the pool is exhausted
+        /// @remark Thread and ISR context callable
+        template<typename... Args>
+        E *allocate(Args&&... args)
+        {
+            void *p = event_pool_base::allocate();
+            if (p == nullptr)
+            {
+                return nullptr;
+            }
+            return static_cast<E*>(adopt(::new (p) E(std::forward<Args>(args)...)));
+        }
+
+    private:
+        static void destroy(event *e)
+        {
+            static_cast<E*>(e)->~E();
+        }
+
+        typename std::aligned_storage<(sizeof(E) > sizeof(void*)) ? sizeof(E) : sizeof(void*),
+                alignof(E)>::type blocks_[COUNT];
+    };
+
+    /// @brief  The non-template part of @ref active_object.
+    class active_object_base
+    {
+    public:
+        /// @brief  Posts an event to the back of the active object's queue.
+        /// @param  e: the event to post, a reference is taken for the queue
+        /// @param  waittime: duration to wait for the queue to have available space
+        /// @return true if successful, false if the queue is full
+        /// @remark Thread and ISR context callable (ISR only with no waittime)
+        bool post(const event *e, tick_timer::duration waittime = tick_timer::duration(0));
+
+        /// @brief  Posts an event to the front of the active object's queue,
+        ///         so it's dispatched before the already queued events.
+        /// @param  e: the event to post, a reference is taken for the queue
+        /// @param  waittime: duration to wait for the queue to have available space
+        /// @return true if successful, false if the queue is full
+        /// @remark Thread and ISR context callable (ISR only with no waittime)
+        bool post_urgent(const event *e, tick_timer::duration waittime = tick_timer::duration(0));
+
+    protected:
+        using event_queue = ishallow_copy_queue<const event*>;
+        using dispatch_function = void (*)(active_object_base*, const event*);
+
+        active_object_base(event_queue& queue, dispatch_function dispatch)
+            : queue_(queue), dispatch_(dispatch)
+        {
+        }
+
+        /// @brief  Stores the event in a deferred queue, for later processing.
+        /// @param  deferred: the queue of deferred events
+        /// @param  e: the event to defer, a reference is taken for the deferred queue
+        /// @return true if successful, false if the deferred queue is full
+        bool defer(event_queue& deferred, const event *e);
+
+        /// @brief  Moves the oldest deferred event to the front of the active object's queue.
+        /// @param  deferred: the queue of deferred events
+        /// @return true if an event was recalled, false if the deferred queue is empty
+        bool recall(event_queue& deferred);
+
+        /// @brief  Called with the events that the active object doesn't have a handler for.
+        void on_unhandled(const event&)
+        {
+        }
+
+        // the thread function
+        static void run(active_object_base *ao);
+
+    private:
+        event_queue& queue_;
+        const dispatch_function dispatch_;
+
+        // non-copyable
+        active_object_base(const active_object_base&) = delete;
+        active_object_base& operator=(const active_object_base&) = delete;
+    };
+
+    /// @brief  An active object owns a thread and an event queue, the thread dispatches
+    ///         the queued events one by one to the Derived class's handlers,
+    ///         which are selected at compile time by the event's type:
+    ///         void on(const E& e) is called for each E in Events, and
+    ///         on_unhandled(const event&) for all others.
+    /// @tparam Derived: the concrete active object class
+    /// @tparam QUEUE_DEPTH: the capacity of the event queue
+    /// @tparam STACK_SIZE: the stack size of the thread in bytes
+    /// @tparam Events: the event types that Derived handles
+    template<class Derived, const queue::size_type QUEUE_DEPTH, const std::size_t STACK_SIZE, class... Events>
+    class active_object : public active_object_base
+    {
+    public:
+        /// @brief  Starts the thread of the active object, events can be posted before.
+        /// @param  prio: the priority of the thread
+        /// @param  name: short label for identifying the thread
+        /// @remark Thread context callable
+        void start(thread::priority prio = thread::priority(), const char *name = thread::DEFAULT_NAME)
+        {
+            ::new (&thread_) thread_type(&active_object_base::run,
+                    static_cast<active_object_base*>(this), prio, name);
+        }
+
+        /// @return The thread of the active object (only valid after @ref start)
+        thread& get_thread()
+        {
+            return *reinterpret_cast<thread_type*>(&thread_);
+        }
+
+    protected:
+        active_object()
+            : active_object_base(queue_, &dispatch)
+        {
+        }
+
+    private:
+        using thread_type = static_thread<STACK_SIZE>;
+
+        template<class... Es>
+        struct dispatcher
+        {
+            static void call(Derived *d, const event *e)
+            {
+                d->on_unhandled(*e);
+            }
+        };
+
+        template<class E, class... Es>
+        struct dispatcher<E, Es...>
+        {
+            static void call(Derived *d, const event *e)
+            {
+                if (e->get_type() == E::type())
+                {
+                    d->on(*static_cast<const E*>(e));
+                }
+                else
+                {
+                    dispatcher<Es...>::call(d, e);
+                }
+            }
+        };
+
+        static void dispatch(active_object_base *ao, const event *e)
+        {
+            dispatcher<Events...>::call(static_cast<Derived*>(ao), e);
+        }
+
+        shallow_copy_queue<const event*, QUEUE_DEPTH> queue_;
+        typename std::aligned_storage<sizeof(thread_type), alignof(thread_type)>::type thread_;
+    };
+
+    /// @brief  The non-template part of @ref topic.
+    class topic_base
+    {
+    public:
+        /// @brief  Adds an active object to the subscribers.
+        /// @return true if successful, false if the subscriber list is full
+        /// @remark Thread context callable
+        bool subscribe(active_object_base& ao);
+
+        /// @brief  Removes an active object from the subscribers.
+        /// @remark Thread context callable
+        void unsubscribe(active_object_base& ao);
+
+    protected:
+        topic_base(active_object_base **subscribers, std::size_t max_count)
+            : subscribers_(subscribers), max_count_(max_count), count_(0)
+        {
+        }
+
+        std::size_t publish(const event *e);
+
+    private:
+        active_object_base **const subscribers_;
+        const std::size_t max_count_;
+        std::size_t count_;
+
+        // non-copyable
+        topic_base(const topic_base&) = delete;
+        topic_base& operator=(const topic_base&) = delete;
+    };
+
+    /// @brief  Delivers an event type to all subscribed active objects.
+    ///         A pooled event is shared by the subscribers, and freed when the last one
+    ///         finished processing it.
+    /// @tparam E: the published event type
+    /// @tparam MAX_SUBSCRIBERS: the maximal number of subscribers
+    template<class E, const std::size_t MAX_SUBSCRIBERS>
+    class topic : public topic_base
+    {
+    public:
+        topic()
+            : topic_base(subscribers_, MAX_SUBSCRIBERS)
+        {
+        }
+
+        /// @brief  Posts the event to all subscribers.
+        /// @param  e: the event to publish
+        /// @return The number of subscribers that received the event
+        /// @remark Thread and ISR context callable
+        std::size_t publish(const E *e)
+        {
+            return topic_base::publish(e);
+        }
+
+    private:
+        active_object_base *subscribers_[MAX_SUBSCRIBERS];
+    };
+}
+
+#endif // __FREERTOS_ACTIVE_OBJECT_H_
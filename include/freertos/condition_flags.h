@@ -26,6 +26,7 @@
 #ifndef __FREERTOS_CONDITION_FLAGS_H_
 #define __FREERTOS_CONDITION_FLAGS_H_
 
+#include "freertos/cpu.h"
 #include "freertos/tick_timer.h"
 
 namespace freertos
@@ -100,6 +101,8 @@ namespace freertos
 
         /// @brief  Sets the provided flags in the condition.
         /// @param  flags: the flags to activate
+        /// @note   In ISR context the operation is deferred to the timer service thread,
+        ///         use @ref direct_condition_flags to avoid this latency.
         /// @remark Thread and ISR context callable
         void set(cflag flags);
 
@@ -108,6 +111,16 @@ namespace freertos
         /// @remark Thread and ISR context callable
         void clear(cflag flags);
 
+        /// @brief  Context specific variants of @ref get, @ref set and @ref clear,
+        ///         which compile directly to the matching kernel call.
+        /// @remark Only callable from the context of the tag
+        cflag get(thread_context_t) const;
+        cflag get(isr_context_t) const;
+        void set(thread_context_t, cflag flags);
+        void set(isr_context_t, cflag flags);
+        void clear(thread_context_t, cflag flags);
+        void clear(isr_context_t, cflag flags);
+
         /// @brief  Blocks the current thread until any of the provided flags is raised.
         ///         When a flag unblocks the thread, it will be cleared.
         /// @param  flags: selection of flags to wait on
@@ -214,4 +227,10 @@ namespace freertos
     };
 }
 
+#if (configINLINE_WRAPPERS == 1)
+
+#include "freertos/impl/condition_flags.inl"
+
+#endif // (configINLINE_WRAPPERS == 1)
+
 #endif // __FREERTOS_CONDITION_FLAGS_H_
@@ -0,0 +1,621 @@
+/**
+ * @file      coroutine.h
+ * @brief     Single thread scheduler for C++20 stackless coroutines
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_COROUTINE_H_
+#define __FREERTOS_COROUTINE_H_
+
+#include "freertos/thread.h"
+#include "freertos/queue_set.h"
+#include "freertos/wide_condition_flags.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+
+namespace freertos
+{
+    class coroutine_scheduler_base;
+
+    /// @brief  The suspension record of a coroutine, it is part of the awaiter object,
+    ///         and therefore resides in the coroutine frame while it's suspended.
+    class coroutine_waiter
+    {
+    public:
+        /// @brief  Non-blocking attempt to complete the awaited operation.
+        using poll_function = bool (*)(coroutine_waiter*);
+
+        /// @return true if the awaited operation didn't complete within the timeout
+        bool timed_out() const
+        {
+            return timed_out_;
+        }
+
+    protected:
+        constexpr coroutine_waiter(poll_function poll, tick_timer::duration timeout)
+            : next_(nullptr), handle_(), poll_(poll), timeout_(timeout), deadline_(),
+        #if (configUSE_QUEUE_SETS == 1)
+              watch_(nullptr), source_(nullptr), member_(nullptr), watched_(false),
+        #endif
+              notified_(false), timed_out_(false)
+        {
+        }
+
+        // the awaited object wakes up the scheduler by itself, so it's only polled then
+        void enable_notification()
+        {
+            notified_ = true;
+        }
+
+        // the awaited queue or semaphore wakes up the scheduler through its queue set,
+        // without queue sets it is polled periodically
+        template<class T>
+        void enable_queue_set(T& object)
+        {
+        #if (configUSE_QUEUE_SETS == 1)
+            watch_ = &watch<T>;
+            source_ = &object;
+            member_ = queue_set::member_id(object);
+        #else
+            (void)object;
+        #endif
+        }
+
+        // the awaiter's fast path, completes the operation without suspension if possible
+        bool try_complete()
+        {
+            return (poll_ != nullptr) && poll_(this);
+        }
+
+        // registers the suspended coroutine in the scheduler
+        void suspend(coroutine_scheduler_base& sched, std::coroutine_handle<> h);
+
+    private:
+        friend class coroutine_scheduler_base;
+
+    #if (configUSE_QUEUE_SETS == 1)
+        using watch_function = bool (*)(queue_set& set, void *object, bool add);
+
+        template<class T>
+        static bool watch(queue_set& set, void *object, bool add)
+        {
+            T& member = *static_cast<T*>(object);
+            return add ? set.add(member) : set.remove(member);
+        }
+    #endif
+
+        // whether the scheduler has to poll the operation periodically
+        bool needs_polling() const;
+
+        coroutine_waiter *next_;
+        std::coroutine_handle<> handle_;
+        const poll_function poll_;
+        const tick_timer::duration timeout_;
+        tick_timer::time_point deadline_;
+    #if (configUSE_QUEUE_SETS == 1)
+        watch_function watch_;
+        void *source_;
+        // the object's identifier in the queue set's events
+        const void *member_;
+        bool watched_;
+    #endif
+        bool notified_;
+        bool timed_out_;
+    };
+
+    /// @brief  The return type of the coroutines that run on a @ref coroutine_scheduler.
+    ///         The first parameter of such coroutines must be the scheduler reference,
+    ///         the coroutine frame is allocated from that scheduler's frame pool,
+    ///         and its execution is started by the scheduler.
+    ///         The coroutine frame is freed when the coroutine returns.
+    class coroutine_task
+    {
+    public:
+        class promise_type
+        {
+        public:
+            template<typename... Args>
+            promise_type(coroutine_scheduler_base& sched, Args&...)
+                : sched_(&sched)
+            {
+            }
+
+            template<typename... Args>
+            static void *operator new(std::size_t size, coroutine_scheduler_base& sched, Args&...) noexcept;
+            static void operator delete(void *frame, std::size_t size) noexcept;
+
+            static coroutine_task get_return_object_on_allocation_failure() noexcept
+            {
+                return coroutine_task(false);
+            }
+            coroutine_task get_return_object() noexcept
+            {
+                return coroutine_task(true);
+            }
+
+            /// @brief  Hands over the new coroutine to the scheduler.
+            class start_awaiter : public coroutine_waiter
+            {
+            public:
+                explicit constexpr start_awaiter(coroutine_scheduler_base *sched)
+                    : coroutine_waiter(nullptr, tick_timer::duration(0)), sched_(sched)
+                {
+                }
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+                void await_suspend(std::coroutine_handle<> h) noexcept;
+                void await_resume() const noexcept
+                {
+                }
+
+            private:
+                coroutine_scheduler_base *const sched_;
+            };
+
+            start_awaiter initial_suspend() noexcept
+            {
+                return start_awaiter(sched_);
+            }
+            std::suspend_never final_suspend() noexcept
+            {
+                return {};
+            }
+            void return_void() noexcept
+            {
+            }
+            void unhandled_exception() noexcept
+            {
+                std::terminate();
+            }
+
+            coroutine_scheduler_base& get_scheduler() const
+            {
+                return *sched_;
+            }
+
+        private:
+            coroutine_scheduler_base *const sched_;
+        };
+
+        /// @return false if the coroutine couldn't be created due to frame pool exhaustion
+        bool valid() const
+        {
+            return valid_;
+        }
+
+    private:
+        explicit constexpr coroutine_task(bool valid)
+            : valid_(valid)
+        {
+        }
+
+        bool valid_;
+    };
+
+    using coroutine_handle = std::coroutine_handle<coroutine_task::promise_type>;
+
+    /// @brief  The non-template part of @ref coroutine_scheduler.
+    class coroutine_scheduler_base
+    {
+    public:
+        /// @brief  Executes the coroutines in the calling thread, this function doesn't return.
+        ///         When all coroutines are suspended, the thread blocks until an awaited
+        ///         object becomes available or the nearest timeout expires:
+        ///         queues and semaphores wake the thread through the scheduler's queue set
+        ///         (requires configUSE_QUEUE_SETS), and each of their events completes the
+        ///         longest waiting awaiter of the member that posted it, condition flags with a wait list
+        ///         (wide_condition_flags, direct_condition_flags) notify it directly,
+        ///         while the remaining objects (e.g. the kernel event group based condition_flags)
+        ///         are polled at the poll interval.
+        /// @remark Thread context callable
+        [[noreturn]] void run();
+
+        /// @brief  Wakes up the scheduler thread to poll the awaited operations immediately.
+        ///         Call this after releasing a polled resource that coroutines are waiting for
+        ///         to avoid the poll interval latency.
+        /// @remark Thread and ISR context callable
+        void wake();
+
+        /// @return The longest time the scheduler sleeps while coroutines await objects
+        ///         that cannot wake it up
+        tick_timer::duration get_poll_interval() const
+        {
+            return poll_interval_;
+        }
+
+        /// @return The number of coroutine frames that can be allocated
+        std::size_t get_free_frames() const;
+
+    protected:
+        coroutine_scheduler_base(void *frames, std::size_t frame_size, std::size_t frame_count,
+                unsigned char *events, std::size_t event_count, tick_timer::duration poll_interval);
+
+    private:
+        friend class coroutine_waiter;
+        friend class coroutine_task::promise_type;
+        friend class coroutine_task::promise_type::start_awaiter;
+
+        struct free_frame
+        {
+            free_frame *next;
+        };
+
+        static constexpr std::size_t FRAME_HEADER_SIZE = alignof(std::max_align_t);
+
+        void *allocate(std::size_t size);
+        static void deallocate(void *frame);
+
+        void schedule(coroutine_waiter *w, std::coroutine_handle<> h);
+        void add_waiter(coroutine_waiter *w);
+        void remove_waiter(coroutine_waiter **pw);
+        void wait_events(tick_timer::duration rel_time);
+    #if (configUSE_QUEUE_SETS == 1)
+        bool watch(coroutine_waiter *w);
+        void dispatch_events(coroutine_waiter **runnable);
+    #endif
+
+        free_frame *free_list_;
+        const std::size_t frame_size_;
+        const tick_timer::duration poll_interval_;
+    #if (configUSE_QUEUE_SETS == 1)
+        class event_set : public queue_set
+        {
+        public:
+            event_set(size_type size, unsigned char *elem_buffer)
+                : queue_set(size, elem_buffer)
+            {
+            }
+
+            // waits for an event without consuming it, the events are consumed
+            // one by one when their members are read
+            bool wait(tick_timer::duration rel_time) const
+            {
+                const void *member;
+                return peek_front(&member, rel_time);
+            }
+        };
+
+        event_set events_;
+        binary_semaphore wakeup_;
+    #else
+        thread *volatile owner_;
+    #endif
+        coroutine_waiter *ready_;
+        coroutine_waiter *waiters_;
+
+        // non-copyable
+        coroutine_scheduler_base(const coroutine_scheduler_base&) = delete;
+        coroutine_scheduler_base& operator=(const coroutine_scheduler_base&) = delete;
+    };
+
+    template<typename... Args>
+    void *coroutine_task::promise_type::operator new(std::size_t size, coroutine_scheduler_base& sched, Args&...) noexcept
+    {
+        return sched.allocate(size);
+    }
+
+    inline void coroutine_task::promise_type::operator delete(void *frame, std::size_t) noexcept
+    {
+        coroutine_scheduler_base::deallocate(frame);
+    }
+
+    /// @brief  Runs many stackless coroutines in a single thread, their frames are allocated
+    ///         from a static pool of fixed size blocks.
+    /// @tparam FRAME_SIZE: the maximal coroutine frame size in bytes
+    /// @tparam FRAMES: the maximal number of concurrently existing coroutines
+    /// @tparam EVENTS: the sum of the lengths of the queues and semaphores that are awaited
+    ///         at the same time, the length of the scheduler's queue set
+    template<const std::size_t FRAME_SIZE, const std::size_t FRAMES, const std::size_t EVENTS = FRAMES>
+    class coroutine_scheduler : public coroutine_scheduler_base
+    {
+    public:
+        /// @brief  Constructs the scheduler, the coroutines are executed when a thread calls @ref run.
+        /// @param  poll_interval: the longest time to sleep while coroutines await objects
+        ///         that cannot wake up the scheduler
+        coroutine_scheduler(tick_timer::duration poll_interval = tick_timer::duration(1))
+        #if (configUSE_QUEUE_SETS == 1)
+            : coroutine_scheduler_base(frames_, sizeof(frames_[0]), FRAMES,
+                    events_, EVENT_SLOTS, poll_interval)
+        #else
+            : coroutine_scheduler_base(frames_, sizeof(frames_[0]), FRAMES,
+                    nullptr, 0, poll_interval)
+        #endif
+        {
+        }
+
+    private:
+        static constexpr std::size_t BLOCK_SIZE = (FRAME_SIZE + 2 * alignof(std::max_align_t) - 1)
+                / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+        typename std::aligned_storage<BLOCK_SIZE, alignof(std::max_align_t)>::type frames_[FRAMES];
+    #if (configUSE_QUEUE_SETS == 1)
+        // one additional event is reserved for the wakeup of the scheduler
+        static constexpr std::size_t EVENT_SLOTS = EVENTS + 1;
+
+        unsigned char events_[EVENT_SLOTS * sizeof(void*)];
+    #endif
+    };
+
+    /// @brief  Awaiter that suspends the coroutine for a given duration.
+    class sleep_awaiter : public coroutine_waiter
+    {
+    public:
+        explicit constexpr sleep_awaiter(tick_timer::duration rel_time)
+            : coroutine_waiter(nullptr, rel_time)
+        {
+        }
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+        void await_suspend(coroutine_handle h)
+        {
+            suspend(h.promise().get_scheduler(), h);
+        }
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    /// @brief  Awaiter that completes when the poll operation succeeds, or when the timeout expires.
+    /// @tparam T: the type of the awaited object
+    template<typename T>
+    class poll_awaiter : public coroutine_waiter
+    {
+    public:
+        poll_awaiter(poll_function poll, T& object, tick_timer::duration timeout)
+            : coroutine_waiter(poll, timeout), object_(object)
+        {
+        }
+        bool await_ready() noexcept
+        {
+            return try_complete();
+        }
+        void await_suspend(coroutine_handle h)
+        {
+            suspend(h.promise().get_scheduler(), h);
+        }
+
+    protected:
+        T& object_;
+    };
+
+    /// @brief  Suspends the coroutine for the given duration.
+    /// @param  rel_time: the duration of the suspension
+    /// @return awaitable object
+    template<class Rep, class Period>
+    sleep_awaiter async_sleep_for(const std::chrono::duration<Rep, Period>& rel_time)
+    {
+        return sleep_awaiter(std::chrono::duration_cast<tick_timer::duration>(rel_time));
+    }
+
+    /// @brief  Awaits an element from the front of the queue.
+    /// @param  q: the queue to pop from
+    /// @param  value: the destination to copy the element to
+    /// @param  timeout: duration to wait for an element
+    /// @return awaitable object, resulting in true if the element was received, false if timed out
+    /// @note   While awaited, the queue is the member of the scheduler's queue set,
+    ///         so it must not be the member of another queue set.
+    template<class Queue>
+    auto async_pop_front(Queue& q, typename Queue::value_type *value,
+            tick_timer::duration timeout = infinity)
+    {
+        class awaiter : public poll_awaiter<Queue>
+        {
+        public:
+            awaiter(Queue& q, typename Queue::value_type *value, tick_timer::duration timeout)
+                : poll_awaiter<Queue>(&poll, q, timeout), value_(value)
+            {
+                this->enable_queue_set(q);
+            }
+            bool await_resume() const noexcept
+            {
+                return !this->timed_out();
+            }
+
+        private:
+            static bool poll(coroutine_waiter *w)
+            {
+                auto a = static_cast<awaiter*>(w);
+                return a->object_.pop_front(a->value_, tick_timer::duration(0));
+            }
+
+            typename Queue::value_type *const value_;
+        };
+        return awaiter(q, value, timeout);
+    }
+
+    /// @brief  Awaits the semaphore to become available, then takes it.
+    /// @param  sem: the semaphore to acquire
+    /// @param  timeout: duration to wait for the semaphore
+    /// @return awaitable object, resulting in true if the semaphore was taken, false if timed out
+    /// @note   While awaited, the semaphore is the member of the scheduler's queue set,
+    ///         so it must not be the member of another queue set.
+    template<class Semaphore>
+    auto async_acquire(Semaphore& sem, tick_timer::duration timeout = infinity)
+    {
+        class awaiter : public poll_awaiter<Semaphore>
+        {
+        public:
+            awaiter(Semaphore& sem, tick_timer::duration timeout)
+                : poll_awaiter<Semaphore>(&poll, sem, timeout)
+            {
+                this->enable_queue_set(sem);
+            }
+            bool await_resume() const noexcept
+            {
+                return !this->timed_out();
+            }
+
+        private:
+            static bool poll(coroutine_waiter *w)
+            {
+                return static_cast<awaiter*>(w)->object_.try_acquire();
+            }
+        };
+        return awaiter(sem, timeout);
+    }
+
+    /// @brief  Awaiter of condition flags that are polled periodically, consumes the raised flags.
+    /// @tparam Flags: the type of the awaited condition flags
+    /// @tparam Value: the type of the flags selection
+    template<class Flags, typename Value>
+    class polled_flags_awaiter : public poll_awaiter<Flags>
+    {
+    public:
+        polled_flags_awaiter(Flags& cond, Value flags, bool match_all, tick_timer::duration timeout)
+            : poll_awaiter<Flags>(&poll, cond, timeout), flags_(flags), match_all_(match_all), result_()
+        {
+        }
+        Value await_resume() const noexcept
+        {
+            return result_;
+        }
+
+    private:
+        static bool poll(coroutine_waiter *w)
+        {
+            auto a = static_cast<polled_flags_awaiter*>(w);
+            if (a->match_all_)
+            {
+                a->result_ = a->object_.wait_all_for(a->flags_, tick_timer::duration(0));
+            }
+            else
+            {
+                a->result_ = a->object_.wait_any_for(a->flags_, tick_timer::duration(0));
+            }
+            return a->result_ != Value();
+        }
+
+        const Value flags_;
+        const bool match_all_;
+        Value result_;
+    };
+
+#if (configUSE_TASK_NOTIFICATIONS == 1)
+
+    /// @brief  Awaiter of condition flags with a wait list, the awaiter is registered
+    ///         on the wait list, and the flags setter wakes up the scheduler directly.
+    /// @tparam Flags: the type of the awaited condition flags
+    template<class Flags>
+    class listed_flags_awaiter : public poll_awaiter<Flags>
+    {
+    public:
+        using value_type = typename Flags::value_type;
+
+        template<typename Value>
+        listed_flags_awaiter(Flags& cond, const Value& flags, bool match_all, tick_timer::duration timeout)
+            : poll_awaiter<Flags>(&poll, cond, timeout), flags_(flags), match_all_(match_all),
+              registered_(false), record_()
+        {
+            this->enable_notification();
+        }
+        bool await_ready()
+        {
+            record_.result = match_all_ ? this->object_.wait_all_for(flags_, tick_timer::duration(0))
+                                        : this->object_.wait_any_for(flags_, tick_timer::duration(0));
+            return !(record_.result == value_type());
+        }
+        bool await_suspend(coroutine_handle h)
+        {
+            auto& sched = h.promise().get_scheduler();
+            if (this->object_.start_wait(record_, flags_, true, match_all_, &notify, &sched))
+            {
+                // the flags have been raised in the meantime, no need to suspend
+                return false;
+            }
+            registered_ = true;
+            this->suspend(sched, h);
+            return true;
+        }
+        value_type await_resume() noexcept
+        {
+            // the flags might be raised concurrently with the timeout
+            if (registered_ && !this->object_.finish_wait(record_))
+            {
+                return value_type();
+            }
+            return record_.result;
+        }
+
+    private:
+        static bool poll(coroutine_waiter *w)
+        {
+            auto a = static_cast<listed_flags_awaiter*>(w);
+            return a->object_.is_satisfied(a->record_);
+        }
+
+        static void notify(void *sched)
+        {
+            static_cast<coroutine_scheduler_base*>(sched)->wake();
+        }
+
+        const value_type flags_;
+        const bool match_all_;
+        bool registered_;
+        typename Flags::wait_record record_;
+    };
+
+    // the condition flags with a wait list wake up the scheduler, the rest are polled
+    template<class Flags, typename Value>
+    using flags_awaiter = typename std::conditional<std::is_base_of<flags_wait_list, Flags>::value,
+            listed_flags_awaiter<Flags>, polled_flags_awaiter<Flags, Value>>::type;
+
+#else
+
+    template<class Flags, typename Value>
+    using flags_awaiter = polled_flags_awaiter<Flags, Value>;
+
+#endif // (configUSE_TASK_NOTIFICATIONS == 1)
+
+    /// @brief  Awaits any of the provided flags to be raised, and consumes them.
+    /// @param  cond: the condition flags to wait on
+    /// @param  flags: selection of flags to wait on
+    /// @param  timeout: duration to wait for the activation
+    /// @return awaitable object, resulting in the raised flag(s), or 0 if timed out
+    template<class Flags, typename Value>
+    flags_awaiter<Flags, Value> async_wait_any(Flags& cond, Value flags, tick_timer::duration timeout = infinity)
+    {
+        return flags_awaiter<Flags, Value>(cond, flags, false, timeout);
+    }
+
+    /// @brief  Awaits all of the provided flags to be raised, and consumes them.
+    /// @param  cond: the condition flags to wait on
+    /// @param  flags: selection of flags to wait on
+    /// @param  timeout: duration to wait for the activation
+    /// @return awaitable object, resulting in the raised flags, or 0 if timed out
+    template<class Flags, typename Value>
+    flags_awaiter<Flags, Value> async_wait_all(Flags& cond, Value flags, tick_timer::duration timeout = infinity)
+    {
+        return flags_awaiter<Flags, Value>(cond, flags, true, timeout);
+    }
+}
+
+#endif // defined(__cpp_impl_coroutine)
+
+#endif // __FREERTOS_COROUTINE_H_
@@ -27,14 +27,44 @@
 #define __FREERTOS_CPU_H_
 
 #include "freertos/stdlib.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef configCACHE_LINE_SIZE
+#define configCACHE_LINE_SIZE                   32
+#endif
 
 namespace freertos
 {
+    namespace native
+    {
+        #include "FreeRTOS.h"
+
+        #if (configNUMBER_OF_CORES > 1)
+            constexpr UBaseType_t NUMBER_OF_CORES = configNUMBER_OF_CORES;
+        #else
+            constexpr UBaseType_t NUMBER_OF_CORES = 1;
+        #endif
+
+        constexpr std::size_t CACHE_LINE_SIZE = configCACHE_LINE_SIZE;
+    }
+
+    // with configINLINE_WRAPPERS the hot path wrapper operations (see freertos/impl)
+    // are defined inline in the headers, instead of in their source files
+    #if (configINLINE_WRAPPERS == 1)
+        #define FREERTOS_WRAPPER_INLINE inline
+    #else
+        #define FREERTOS_WRAPPER_INLINE
+    #endif
+
     class cpu
     {
     public:
         /// @brief  A @ref BasicLockable class that prevents task and interrupt
         ///         context switches while locked.
+        /// @note   On SMP builds the kernel's critical section serializes all cores,
+        ///         consider a @ref spinlock to protect data that is shared by few parties.
         class critical_section
         {
         public:
@@ -45,17 +75,113 @@ namespace freertos
             ///         to preempt the current execution context.
             void unlock();
 
+        #if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+
+            /// @brief  The profiled call site is where the section is constructed,
+            ///         since lock() is usually called through lock_guard.
+            __attribute__((always_inline)) inline critical_section()
+                : site_(call_site())
+            {
+            }
+
+        private:
+            std::uintptr_t restore_ = 0;
+            const void *const site_;
+
+        #else
+
             constexpr critical_section()
             {
             }
 
         private:
             std::uintptr_t restore_ = 0;
+
+        #endif // (configUSE_CRITICAL_SECTION_PROFILER == 1)
         };
+
+        /// @brief  A @ref BasicLockable ticket spinlock that masks interrupts on the
+        ///         current core while locked, and busy-waits for the other cores
+        ///         in first-come first-served order. On single core builds the spinning
+        ///         is compiled out, only the interrupt masking remains.
+        /// @note   The lock doesn't nest, and must be held only for a few instructions,
+        ///         kernel API calls are not allowed while it's held.
+        class spinlock
+        {
+        public:
+            /// @brief  Masks the interrupts and acquires the lock.
+            /// @remark Thread and ISR context callable
+            void lock();
+
+            /// @brief  Releases the lock and restores the interrupt mask.
+            /// @remark Thread and ISR context callable
+            void unlock();
+
+            constexpr spinlock()
+            {
+            }
+
+        private:
+            std::atomic<std::uint16_t> next_ {0};
+            std::atomic<std::uint16_t> serving_ {0};
+            std::uintptr_t restore_ = 0;
+
+            // non-copyable
+            spinlock(const spinlock&) = delete;
+            spinlock& operator=(const spinlock&) = delete;
+        };
+
+    #if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+
+        /// @brief  Identifies the calling code for the critical section profiler.
+        ///         It is never inlined, so when it's called from an inlined function,
+        ///         the result is still the address within the function it's inlined to.
+        /// @return The return address of the call
+        /// @remark Thread and ISR context callable
+        static const void *call_site();
+
+    #endif // (configUSE_CRITICAL_SECTION_PROFILER == 1)
+    };
+
+    /// @brief  Tag type that selects the ISR variant of a context dependent call,
+    ///         which compiles directly to the kernel's FromISR API, skipping @ref this_cpu::uses_isr_api.
+    struct isr_context_t
+    {
+        explicit constexpr isr_context_t()
+        {
+        }
     };
 
+    /// @brief  Tag type that selects the thread variant of a context dependent call,
+    ///         which compiles directly to the kernel's thread API, skipping @ref this_cpu::uses_isr_api.
+    struct thread_context_t
+    {
+        explicit constexpr thread_context_t()
+        {
+        }
+    };
+
+    constexpr isr_context_t isr_context {};
+    constexpr thread_context_t thread_context {};
+
     namespace this_cpu
     {
+    #if defined(__ARM_ARCH_PROFILE) && (__ARM_ARCH_PROFILE == 'M')
+
+        /// @brief  Determines if the current execution context is inside
+        ///         an interrupt service routine.
+        /// @note   On Cortex-M the active exception number is read inline,
+        ///         the same way as xPortIsInsideInterrupt() does
+        /// @return true if the current execution context is ISR, false otherwise
+        inline bool is_in_isr()
+        {
+            std::uint32_t ipsr;
+            __asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+            return ipsr != 0;
+        }
+
+    #else
+
         /// @brief  Determines if the current execution context is inside
         ///         an interrupt service routine.
         /// @note   The underlying port function (@ref xPortIsInsideInterrupt)
@@ -64,7 +190,86 @@ namespace freertos
         ///         e.g. by checking if the current task's stack is being used
         /// @return true if the current execution context is ISR, false otherwise
         bool is_in_isr();
+
+    #endif
+
+    #if (configASSUME_THREAD_CONTEXT == 1)
+
+        /// @brief  Selects between the kernel's thread and ISR API in the wrappers'
+        ///         context detecting calls. The detection is disabled by configASSUME_THREAD_CONTEXT,
+        ///         so these calls compile to the thread variant, and ISRs must use
+        ///         the @ref isr_context variants instead. The critical sections
+        ///         and the context checks still rely on @ref is_in_isr.
+        /// @return false
+        constexpr bool uses_isr_api()
+        {
+            return false;
+        }
+
+    #else
+
+        /// @brief  Selects between the kernel's thread and ISR API in the wrappers'
+        ///         context detecting calls.
+        /// @return true if the current execution context is ISR, false otherwise
+        inline bool uses_isr_api()
+        {
+            return is_in_isr();
+        }
+
+    #endif
+
+        /// @brief  Determines the index of the core executing the call.
+        /// @note   In thread context the result is only stable while the thread
+        ///         cannot migrate (e.g. it's pinned, or interrupts are masked)
+        /// @return The current core's index, always 0 on single core builds
+        /// @remark Thread and ISR context callable
+        unsigned id();
     }
+
+    /// @brief  Holds a separate instance of an object for each core, with each instance
+    ///         occupying distinct cache lines, so that the cores don't false-share them.
+    ///         The cache line size is set by configCACHE_LINE_SIZE.
+    /// @tparam T: the type of the per-core object
+    template<typename T>
+    class per_core
+    {
+    public:
+        /// @return The number of per-core instances
+        static constexpr std::size_t size()
+        {
+            return native::NUMBER_OF_CORES;
+        }
+
+        /// @return The instance that belongs to the current core
+        /// @note   See @ref this_cpu::id for the migration constraints
+        T& local()
+        {
+            return slots_[this_cpu::id()].value;
+        }
+        const T& local() const
+        {
+            return slots_[this_cpu::id()].value;
+        }
+
+        /// @param  core: the index of the core
+        /// @return The instance that belongs to the selected core
+        T& operator[](std::size_t core)
+        {
+            return slots_[core].value;
+        }
+        const T& operator[](std::size_t core) const
+        {
+            return slots_[core].value;
+        }
+
+    private:
+        struct alignas(native::CACHE_LINE_SIZE) slot
+        {
+            T value {};
+        };
+
+        slot slots_[size()];
+    };
 }
 
 #endif // __FREERTOS_CPU_H_
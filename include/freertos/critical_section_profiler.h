@@ -0,0 +1,141 @@
+/**
+ * @file      critical_section_profiler.h
+ * @brief     Measurement of interrupt-disabled and scheduler-suspended durations per call site
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_CRITICAL_SECTION_PROFILER_H_
+#define __FREERTOS_CRITICAL_SECTION_PROFILER_H_
+
+#include "freertos/cpu.h"
+
+#if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+
+#ifndef configCRITICAL_SECTION_PROFILER_SITES
+#define configCRITICAL_SECTION_PROFILER_SITES   32
+#endif
+
+namespace freertos
+{
+    /// @brief  Measures the duration of the outermost critical sections with a cycle counter,
+    ///         and aggregates it per call site (identified by the code address where the
+    ///         critical_section object is constructed, or where the kernel enters its section).
+    ///         The profiling of cpu::critical_section and scheduler::critical_section is built in
+    ///         when configUSE_CRITICAL_SECTION_PROFILER is 1. The kernel's own critical sections
+    ///         are covered by linking with -Wl,--wrap=vPortEnterCritical,--wrap=vPortExitCritical
+    ///         and setting configCRITICAL_SECTION_PROFILER_WRAP_PORT to 1.
+    ///         The cycle counter is the Cortex-M DWT counter, or configPROFILER_CYCLE_COUNTER().
+    class critical_section_profiler
+    {
+    public:
+        static constexpr std::size_t HISTOGRAM_BINS = 8;
+
+        /// @brief  The statistics of a single call site.
+        struct site_statistics
+        {
+            /// @brief  The code address of the call site
+            const void *site;
+            std::uint32_t count;
+            /// @brief  The longest duration, in cycles
+            std::uint32_t max;
+            /// @brief  Sum of all durations, divide by count for the mean
+            std::uint64_t total;
+            /// @brief  Bin 0 counts the durations below 64 cycles, each further bin
+            ///         has 4 times the upper limit, the last bin counts all longer ones
+            std::uint32_t histogram[HISTOGRAM_BINS];
+        };
+
+        /// @return The profiler of the interrupt masking critical sections
+        static critical_section_profiler& interrupts();
+
+        /// @return The profiler of the scheduler suspending critical sections
+        static critical_section_profiler& scheduler_suspension();
+
+        /// @brief  Enables the cycle counter, call it once at startup.
+        static void start();
+
+        /// @brief  Marks the entry of a critical section, only the outermost section is measured.
+        /// @param  site: the call site of the section
+        /// @remark Thread and ISR context callable, from within the critical section
+        void enter(const void *site);
+
+        /// @brief  Marks the exit of a critical section.
+        /// @remark Thread and ISR context callable, from within the critical section
+        void exit();
+
+        /// @brief  Assigns a call site to the current outermost section, if it was entered
+        ///         by the kernel hook on behalf of a wrapper.
+        /// @param  site: the call site of the section
+        /// @remark Thread and ISR context callable, from within the critical section
+        void attribute(const void *site);
+
+        /// @brief  Lists the call sites with the longest critical sections.
+        /// @param  sites: the array to fill, ordered by the longest duration
+        /// @param  max_sites: the size of the array
+        /// @return The number of sites filled in
+        /// @remark Thread and ISR context callable
+        std::size_t get_worst(site_statistics *sites, std::size_t max_sites) const;
+
+        template<std::size_t N>
+        std::size_t get_worst(site_statistics (&sites)[N]) const
+        {
+            return get_worst(sites, N);
+        }
+
+        /// @return The number of measurements that didn't fit in the call site table
+        std::uint32_t get_untracked_count() const
+        {
+            return untracked_;
+        }
+
+        /// @brief  Clears all statistics.
+        /// @remark Thread and ISR context callable
+        void reset();
+
+        constexpr critical_section_profiler()
+        {
+        }
+
+    private:
+        struct core_state
+        {
+            std::uint32_t depth;
+            std::uint32_t start;
+            const void *site;
+        };
+
+        void record(const void *site, std::uint32_t cycles);
+
+        per_core<core_state> cores_;
+        site_statistics sites_[configCRITICAL_SECTION_PROFILER_SITES] {};
+        std::uint32_t untracked_ = 0;
+        mutable cpu::spinlock lock_;
+
+        // non-copyable
+        critical_section_profiler(const critical_section_profiler&) = delete;
+        critical_section_profiler& operator=(const critical_section_profiler&) = delete;
+    };
+}
+
+#endif // (configUSE_CRITICAL_SECTION_PROFILER == 1)
+
+#endif // __FREERTOS_CRITICAL_SECTION_PROFILER_H_
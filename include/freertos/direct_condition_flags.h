@@ -0,0 +1,56 @@
+/**
+ * @file      direct_condition_flags.h
+ * @brief     Condition flags that are signalled directly from ISR context
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_DIRECT_CONDITION_FLAGS_H_
+#define __FREERTOS_DIRECT_CONDITION_FLAGS_H_
+
+#include "freertos/condition_flags.h"
+#include "freertos/wide_condition_flags.h"
+
+namespace freertos
+{
+    #if (configUSE_TASK_NOTIFICATIONS == 1)
+
+        /// @brief  Drop-in replacement of @ref condition_flags, with the same API.
+        ///         The difference is in the ISR context behavior of @ref set:
+        ///         @ref condition_flags defers the setting to the timer service thread,
+        ///         while this class sets the flags and readies the waiting threads
+        ///         within the ISR, using task notifications. Therefore it doesn't
+        ///         require configUSE_TIMERS, and the wake-up latency doesn't depend
+        ///         on the load of the timer service thread.
+        class direct_condition_flags : public basic_condition_flags<cflag>
+        {
+        public:
+            /// @brief  Constructs a direct_condition_flags statically.
+            /// @remark Thread and ISR context callable
+            constexpr direct_condition_flags()
+            {
+            }
+        };
+
+    #endif // (configUSE_TASK_NOTIFICATIONS == 1)
+}
+
+#endif // __FREERTOS_DIRECT_CONDITION_FLAGS_H_
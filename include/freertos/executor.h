@@ -0,0 +1,499 @@
+/**
+ * @file      executor.h
+ * @brief     Static thread pool executor with priority lanes
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_EXECUTOR_H_
+#define __FREERTOS_EXECUTOR_H_
+
+#include "freertos/queue.h"
+#include "freertos/semaphore.h"
+#include "freertos/thread.h"
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace freertos
+{
+    /// @brief  A type-erased callable that is stored by value, without heap use.
+    ///         Since the jobs are passed through queues as shallow copies,
+    ///         the callable must be trivially copyable (e.g. a lambda capturing
+    ///         pointers and values), and it must fit into @ref STORAGE_SIZE.
+    class job
+    {
+    public:
+        static constexpr std::size_t STORAGE_SIZE = 4 * sizeof(void*);
+
+        constexpr job()
+            : invoke_(nullptr), storage_()
+        {
+        }
+
+        template<class F>
+        job(const F& func)
+            : invoke_(&call<F>)
+        {
+            static_assert(std::is_trivially_copyable<F>::value,
+                    "The callable must be trivially copyable.");
+            static_assert(sizeof(F) <= STORAGE_SIZE,
+                    "The callable doesn't fit into the job storage.");
+            static_assert(alignof(F) <= alignof(storage_type),
+                    "The callable's alignment isn't supported.");
+            ::new (&storage_) F(func);
+        }
+
+        /// @brief  Executes the stored callable.
+        inline void operator()()
+        {
+            invoke_(&storage_);
+        }
+
+        /// @brief  Checks if the job contains a callable.
+        explicit operator bool() const
+        {
+            return invoke_ != nullptr;
+        }
+
+    private:
+        using storage_type = typename std::aligned_storage<STORAGE_SIZE, alignof(void*)>::type;
+
+        template<class F>
+        static void call(void *storage)
+        {
+            (*static_cast<F*>(storage))();
+        }
+
+        void (*invoke_)(void*);
+        storage_type storage_;
+    };
+
+    /// @brief  Common part of @ref future, provides the completion signalling.
+    class future_base
+    {
+    public:
+        /// @brief  Checks if the future is waiting for a result.
+        /// @return true if a job has been submitted for this future, and it hasn't completed yet
+        /// @remark Thread and ISR context callable
+        bool is_pending() const;
+
+        /// @brief  Blocks the current thread until the result becomes available.
+        /// @remark Thread context callable
+        void wait();
+
+        /// @brief  Blocks the current thread until the result becomes available,
+        ///         or until the wait time expires.
+        /// @param  rel_time: duration to wait for the result
+        /// @return true if the result is available, false if timed out
+        /// @remark Thread context callable
+        template<class Rep, class Period>
+        bool wait_for(const std::chrono::duration<Rep, Period>& rel_time)
+        {
+            return wait(std::chrono::duration_cast<tick_timer::duration>(rel_time));
+        }
+
+    protected:
+        future_base()
+            : ready_(), pending_(false)
+        {
+        }
+
+        /// @brief  The future may not be destroyed while the job is still referring to it.
+        ~future_base();
+
+        bool wait(const tick_timer::duration& rel_time);
+        void make_pending();
+        void make_ready();
+
+        // asserts that the result is available
+        static void check_value(bool has_value);
+
+    private:
+        binary_semaphore ready_;
+        // only accessed in critical sections
+        bool pending_;
+
+        // non-copyable
+        future_base(const future_base&) = delete;
+        future_base& operator=(const future_base&) = delete;
+    };
+
+    /// @brief  Statically allocated storage for the result of an @ref executor job.
+    ///         Unlike std::future, this object is owned by the caller, and it must
+    ///         be provided when the job is submitted.
+    template<typename R>
+    class future : public future_base
+    {
+    public:
+        using value_type = R;
+
+        future()
+        {
+        }
+
+        ~future()
+        {
+            wait();
+            if (has_value_)
+            {
+                reinterpret_cast<value_type*>(&value_)->~value_type();
+            }
+        }
+
+        /// @brief  Checks if the future holds a result.
+        /// @return true if a submitted job has completed, false if no job was run for this future
+        ///         (e.g. the submission failed)
+        /// @remark Thread and ISR context callable
+        bool has_value() const
+        {
+            return has_value_ && !is_pending();
+        }
+
+        /// @brief  Waits for the result to become available, then returns it.
+        ///         It's an error to call this when no job was submitted successfully for this future.
+        /// @return Reference to the result of the job
+        /// @remark Thread context callable
+        value_type& get()
+        {
+            wait();
+            check_value(has_value_);
+            return *reinterpret_cast<value_type*>(&value_);
+        }
+
+    private:
+        template<std::size_t, std::size_t, std::size_t, std::size_t>
+        friend class executor;
+
+        template<class F>
+        void run(F& func)
+        {
+            if (has_value_)
+            {
+                reinterpret_cast<value_type*>(&value_)->~value_type();
+            }
+            ::new (&value_) value_type(func());
+            has_value_ = true;
+            make_ready();
+        }
+
+        // drops the result of a previous job, when the submission fails
+        void discard()
+        {
+            if (has_value_)
+            {
+                reinterpret_cast<value_type*>(&value_)->~value_type();
+                has_value_ = false;
+            }
+            make_ready();
+        }
+
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type value_;
+        bool has_value_ = false;
+    };
+
+    template<>
+    class future<void> : public future_base
+    {
+    public:
+        using value_type = void;
+
+        ~future()
+        {
+            wait();
+        }
+
+        /// @brief  Waits for the job to complete.
+        /// @remark Thread context callable
+        void get()
+        {
+            wait();
+        }
+
+    private:
+        template<std::size_t, std::size_t, std::size_t, std::size_t>
+        friend class executor;
+
+        template<class F>
+        void run(F& func)
+        {
+            func();
+            make_ready();
+        }
+
+        void discard()
+        {
+            make_ready();
+        }
+    };
+
+    /// @brief  A single priority lane of an @ref executor: a job queue,
+    ///         and the worker threads that serve it.
+    class executor_lane
+    {
+    public:
+        /// @brief  The clock that measures the jobs' execution times, the run time statistics counter
+        ///         is used when available, since most jobs complete within a tick.
+    #if (configGENERATE_RUN_TIME_STATS == 1)
+        using clock = runtime_clock;
+    #else
+        using clock = tick_timer;
+    #endif
+
+        /// @brief  Runtime statistics of a lane.
+        struct statistics
+        {
+            queue::size_type queued;        // number of jobs currently waiting in the queue
+            queue::size_type max_queued;    // the highest number of jobs waiting in the queue
+            std::uint32_t executed;         // number of completed jobs
+            clock::duration run_time;       // the sum of the jobs' execution times
+            clock::duration max_run_time;   // the longest execution time of a single job
+        };
+
+        /// @brief  Queues a job for execution by the lane's workers.
+        /// @param  j: the job to execute
+        /// @param  waittime: duration to wait for the queue to have available space
+        /// @return true if the job is queued, false if the queue is full
+        /// @remark Thread and ISR context callable (ISR only with no waittime)
+        bool post(const job& j, tick_timer::duration waittime = tick_timer::duration(0));
+
+        /// @brief  Reads the runtime statistics of the lane.
+        /// @return Copy of the current statistics
+        /// @remark Thread and ISR context callable
+        statistics get_statistics() const;
+
+        /// @brief  Resets the runtime statistics of the lane.
+        /// @remark Thread and ISR context callable
+        void reset_statistics();
+
+        /// @brief  Reads the priority of the lane's worker threads.
+        /// @return The lane's priority
+        thread::priority get_priority() const
+        {
+            return priority_;
+        }
+
+        /// @brief  Determines if the calling thread is one of the lane's workers.
+        ///         A worker that waits for other jobs of its own lane can deadlock the lane.
+        /// @return true if called from a job executed by this lane, false otherwise
+        /// @remark Thread context callable
+        bool is_current_worker() const
+        {
+            auto current = reinterpret_cast<std::uintptr_t>(thread::get_current());
+            return (current >= workers_begin_) && (current < workers_end_);
+        }
+
+    protected:
+        executor_lane()
+            : queue_(nullptr), priority_(), workers_begin_(), workers_end_(), stats_()
+        {
+        }
+
+        // the worker thread function
+        static void work(executor_lane *lane);
+
+        ishallow_copy_queue<job> *queue_;
+        thread::priority priority_;
+        // the address range of the worker threads' objects
+        std::uintptr_t workers_begin_;
+        std::uintptr_t workers_end_;
+
+    private:
+        statistics stats_;
+
+        // non-copyable
+        executor_lane(const executor_lane&) = delete;
+        executor_lane& operator=(const executor_lane&) = delete;
+    };
+
+    /// @brief  A fixed size pool of @ref static_thread workers, that execute
+    ///         jobs posted to them, consolidating rarely busy threads.
+    ///         The workers are organized into priority lanes, each lane has its own job queue,
+    ///         and its workers run at the lane's priority level. No heap is used.
+    /// @tparam WORKERS: the number of worker threads in each lane
+    /// @tparam STACK_SIZE: the stack size of each worker thread in bytes
+    /// @tparam QUEUE_DEPTH: the maximum number of queued jobs in each lane
+    /// @tparam LANES: the number of priority lanes
+    template<const std::size_t WORKERS, const std::size_t STACK_SIZE,
+             const std::size_t QUEUE_DEPTH, const std::size_t LANES = 1>
+    class executor
+    {
+        static_assert((WORKERS > 0) && (LANES > 0), "At least one worker is required.");
+
+    public:
+        using size_type = std::size_t;
+
+        /// @brief  The number of priority lanes.
+        static constexpr size_type lanes()
+        {
+            return LANES;
+        }
+
+        /// @brief  The number of worker threads per lane.
+        static constexpr size_type workers_per_lane()
+        {
+            return WORKERS;
+        }
+
+        /// @brief  Constructs the executor, starting all worker threads.
+        /// @param  priorities: the priorities of each lane, in the lanes' index order
+        /// @param  name:       short label for identifying the worker threads
+        /// @remark Thread context callable
+        executor(std::initializer_list<thread::priority> priorities,
+                const char *name = thread::DEFAULT_NAME)
+        {
+            size_type i = 0;
+            for (auto prio : priorities)
+            {
+                if (i < LANES)
+                {
+                    lanes_[i].start(prio, name);
+                }
+                i++;
+            }
+            // all lanes must have a priority assigned
+            for (; i < LANES; i++)
+            {
+                lanes_[i].start(thread::priority(), name);
+            }
+        }
+
+        /// @brief  Constructs a single lane executor, starting all worker threads.
+        /// @param  prio: the priority of the worker threads
+        /// @param  name: short label for identifying the worker threads
+        /// @remark Thread context callable
+        explicit executor(thread::priority prio = thread::priority(),
+                const char *name = thread::DEFAULT_NAME)
+            : executor({ prio }, name)
+        {
+        }
+
+        /// @brief  Queues a callable for execution in the selected lane.
+        /// @param  func: the trivially copyable callable to execute
+        /// @param  lane_index: the lane to execute the callable in
+        /// @param  waittime: duration to wait for the lane's queue to have available space
+        /// @return true if the callable is queued, false if the queue is full
+        /// @remark Thread and ISR context callable (ISR only with no waittime)
+        template<class F>
+        bool post(const F& func, size_type lane_index = 0,
+                tick_timer::duration waittime = tick_timer::duration(0))
+        {
+            return lane(lane_index).post(job(func), waittime);
+        }
+
+        /// @brief  Queues a callable for execution in the selected lane,
+        ///         its result is stored in the caller provided future.
+        /// @param  result: the future to store the result of the callable in,
+        ///         must remain valid until the job is complete
+        /// @param  func: the trivially copyable callable to execute
+        /// @param  lane_index: the lane to execute the callable in
+        /// @param  waittime: duration to wait for the lane's queue to have available space
+        /// @return true if the callable is queued, false if the queue is full
+        /// @remark Thread and ISR context callable (ISR only with no waittime)
+        template<class F>
+        bool submit(future<decltype(std::declval<F&>()())>& result, const F& func,
+                size_type lane_index = 0, tick_timer::duration waittime = tick_timer::duration(0))
+        {
+            using future_type = future<decltype(std::declval<F&>()())>;
+            struct future_job
+            {
+                future_type *result;
+                F func;
+
+                void operator()()
+                {
+                    result->run(func);
+                }
+            };
+
+            result.make_pending();
+            bool success = lane(lane_index).post(job(future_job { &result, func }), waittime);
+            if (!success)
+            {
+                result.discard();
+            }
+            return success;
+        }
+
+        /// @brief  Accesses a lane of the executor.
+        /// @param  lane_index: the lane's index
+        /// @return Reference to the selected lane
+        executor_lane& lane(size_type lane_index)
+        {
+            return lanes_[lane_index];
+        }
+
+        /// @brief  Reads the runtime statistics of a lane.
+        /// @param  lane_index: the lane's index
+        /// @return Copy of the lane's current statistics
+        /// @remark Thread and ISR context callable
+        executor_lane::statistics get_statistics(size_type lane_index) const
+        {
+            return lanes_[lane_index].get_statistics();
+        }
+
+    private:
+        using worker_type = static_thread<STACK_SIZE>;
+
+        class lane_type : public executor_lane
+        {
+        public:
+            lane_type()
+            {
+                queue_ = &jobs_;
+                workers_begin_ = reinterpret_cast<std::uintptr_t>(&workers_[0]);
+                workers_end_ = reinterpret_cast<std::uintptr_t>(&workers_[WORKERS]);
+            }
+
+            ~lane_type()
+            {
+                for (size_type i = 0; i < started_; i++)
+                {
+                    reinterpret_cast<worker_type*>(&workers_[i])->~worker_type();
+                }
+            }
+
+            void start(thread::priority prio, const char *name)
+            {
+                priority_ = prio;
+                for (; started_ < WORKERS; started_++)
+                {
+                    ::new (&workers_[started_]) worker_type(&executor_lane::work,
+                            static_cast<executor_lane*>(this), prio, name);
+                }
+            }
+
+        private:
+            shallow_copy_queue<job, QUEUE_DEPTH> jobs_;
+            typename std::aligned_storage<sizeof(worker_type), alignof(worker_type)>::type workers_[WORKERS];
+            size_type started_ = 0;
+        };
+
+        lane_type lanes_[LANES];
+
+        // non-copyable
+        executor(const executor&) = delete;
+        executor& operator=(const executor&) = delete;
+    };
+}
+
+#endif // __FREERTOS_EXECUTOR_H_
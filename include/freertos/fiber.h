@@ -0,0 +1,423 @@
+/**
+ * @file      fiber.h
+ * @brief     Cooperative stackful fibers multiplexed on a single thread
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_FIBER_H_
+#define __FREERTOS_FIBER_H_
+
+#include "freertos/thread.h"
+#include "freertos/stdlib.h"
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    // hand-written context switch for ARMv7-M (Cortex-M3/M4/M7),
+    // ARMv8-M is left out as the switch doesn't move the PSPLIM stack limit along with the stack
+    #define FIBER_CONTEXT_CORTEX_M  1
+#elif defined(__unix__) || defined(__APPLE__)
+    // ucontext based context switch for the POSIX port
+    #define FIBER_CONTEXT_UCONTEXT  1
+    #include <ucontext.h>
+#endif
+
+namespace freertos
+{
+    #if (configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0) && \
+        (defined(FIBER_CONTEXT_CORTEX_M) || defined(FIBER_CONTEXT_UCONTEXT))
+
+        class fiber_scheduler;
+
+        /// @brief  The saved execution context of a fiber.
+        struct fiber_context
+        {
+            #if defined(FIBER_CONTEXT_CORTEX_M)
+                void *sp;
+            #else
+                ucontext_t uc;
+            #endif
+        };
+
+        /// @brief  A cooperatively scheduled execution context with its own stack,
+        ///         that runs within the thread of a @ref fiber_scheduler.
+        ///         Fibers only switch when they yield, sleep, or block on fiber primitives.
+        class fiber
+        {
+        public:
+            using function = void (*)(void*);
+
+            /// @return true if the fiber function has returned
+            bool finished() const
+            {
+                return state_ == state::finished;
+            }
+
+        protected:
+            fiber(function func, void *param, void *stack, std::size_t stack_size)
+                : ctx_(), func_(func), param_(param), stack_(stack), stack_size_(stack_size),
+                  next_(nullptr), wake_time_(), state_(state::created)
+            {
+            }
+
+        private:
+            friend class fiber_scheduler;
+            friend class fiber_wait_queue;
+
+            enum class state : std::uint8_t
+            {
+                created,
+                ready,
+                blocked,
+                sleeping,
+                finished,
+            };
+
+            fiber_context ctx_;
+            const function func_;
+            void *const param_;
+            void *const stack_;
+            const std::size_t stack_size_;
+            fiber *next_;
+            tick_timer::time_point wake_time_;
+            state state_;
+
+            // non-copyable
+            fiber(const fiber&) = delete;
+            fiber& operator=(const fiber&) = delete;
+        };
+
+        /// @brief  A fiber with statically allocated stack.
+        /// @tparam STACK_SIZE_BYTES: the stack size of the fiber in bytes
+        template<const std::size_t STACK_SIZE_BYTES>
+        class static_fiber : public fiber
+        {
+        public:
+            static constexpr std::size_t STACK_SIZE = STACK_SIZE_BYTES;
+
+            /// @brief  Constructs a fiber, it starts executing when it's passed to
+            ///         @ref fiber_scheduler::start
+            /// @param  func:  the function to execute in the fiber
+            /// @param  param: opaque parameter to pass to the fiber function
+            static_fiber(function func, void *param)
+                : fiber(func, param, stack_, sizeof(stack_))
+            {
+            }
+
+        private:
+            alignas(8) unsigned char stack_[STACK_SIZE_BYTES];
+        };
+
+        /// @brief  FIFO list of fibers blocked on a condition, the building block of the
+        ///         fiber synchronization primitives.
+        /// @note   The primitives may only be used by the fibers of the same scheduler.
+        class fiber_wait_queue
+        {
+        public:
+            constexpr fiber_wait_queue()
+                : head_(nullptr), tail_(nullptr)
+            {
+            }
+
+            /// @return true if no fiber is waiting
+            bool empty() const
+            {
+                return head_ == nullptr;
+            }
+
+            /// @return the longest waiting fiber, the next one to be notified, or nullptr if none
+            fiber *front() const
+            {
+                return head_;
+            }
+
+            /// @brief  Blocks the current fiber until it's notified, other fibers continue running.
+            /// @remark Fiber context callable
+            void wait();
+
+            /// @brief  Makes the longest waiting fiber ready to run.
+            /// @return true if a fiber was woken
+            bool notify_one();
+
+            /// @brief  Makes all waiting fibers ready to run.
+            void notify_all();
+
+        private:
+            friend class fiber_scheduler;
+
+            void push(fiber *f);
+            fiber *pop();
+
+            fiber *head_;
+            fiber *tail_;
+        };
+
+        /// @brief  Executes fibers cooperatively in the calling thread.
+        class fiber_scheduler
+        {
+        public:
+            constexpr fiber_scheduler()
+                : host_(), current_(nullptr), ready_(), sleeping_(nullptr), live_(0)
+            {
+            }
+
+            /// @brief  Prepares the fiber for execution, and adds it to the ready fibers.
+            /// @param  f: the fiber to start, it may not be running already
+            /// @remark Thread and fiber context callable, from the scheduler's thread only
+            void start(fiber& f);
+
+            /// @brief  Executes the fibers until all of them have finished. While all fibers
+            ///         are sleeping, the thread is blocked until the earliest wakeup time.
+            /// @remark Thread context callable
+            void run();
+
+            /// @return The number of started fibers that haven't finished yet
+            std::size_t get_live_count() const
+            {
+                return live_;
+            }
+
+            /// @return The scheduler running in the current thread, or nullptr
+            /// @remark Thread and fiber context callable
+            static fiber_scheduler *get_current();
+
+            /// @return The currently executing fiber, or nullptr when called outside fibers
+            fiber *get_current_fiber() const
+            {
+                return current_;
+            }
+
+            /// @brief  Switches to the next ready fiber, if there is any.
+            /// @remark Fiber context callable
+            void yield();
+
+            /// @brief  Suspends the current fiber until the given tick count.
+            /// @remark Fiber context callable
+            void sleep_until(const tick_timer::time_point& abs_time);
+
+        private:
+            friend class fiber_wait_queue;
+
+            // the current fiber is already placed in a wait list, switch away from it
+            void suspend_current();
+            void make_ready(fiber *f);
+            void switch_to(fiber_context& from, fiber_context& to);
+            void wake_sleepers(const tick_timer::time_point& now);
+            [[noreturn]] static void entry();
+
+            fiber_context host_;
+            fiber *current_;
+            fiber_wait_queue ready_;
+            fiber *sleeping_;
+            std::size_t live_;
+
+            // non-copyable
+            fiber_scheduler(const fiber_scheduler&) = delete;
+            fiber_scheduler& operator=(const fiber_scheduler&) = delete;
+        };
+
+        namespace this_fiber
+        {
+            /// @brief  Switches to the next ready fiber of the scheduler.
+            /// @remark Fiber context callable
+            void yield();
+
+            /// @brief  Suspends the current fiber for the given duration, the other fibers keep running.
+            /// @remark Fiber context callable
+            void sleep_for(tick_timer::duration rel_time);
+
+            /// @brief  Suspends the current fiber for the given duration, the other fibers keep running.
+            /// @param  rel_time: duration to suspend the current fiber
+            /// @remark Fiber context callable
+            template<class Rep, class Period>
+            inline void sleep_for(const std::chrono::duration<Rep, Period>& rel_time)
+            {
+                // workaround to prevent this function calling itself
+                const auto ticks_sleep_for = static_cast<void (*)(tick_timer::duration)>(&sleep_for);
+                ticks_sleep_for(std::chrono::duration_cast<tick_timer::duration>(rel_time));
+            }
+        }
+
+        /// @brief  A @ref Lockable mutex for fibers, blocking yields to the other fibers
+        ///         instead of blocking the thread.
+        class fiber_mutex
+        {
+        public:
+            constexpr fiber_mutex()
+                : owner_(nullptr), waiters_()
+            {
+            }
+
+            /// @brief  Locks the mutex, the current fiber is blocked until it's available.
+            /// @remark Fiber context callable
+            void lock();
+
+            /// @brief  Locks the mutex if it's available.
+            /// @return true if the mutex is locked, false if it's owned by another fiber
+            /// @remark Fiber context callable
+            bool try_lock();
+
+            /// @brief  Unlocks the mutex, passing its ownership to the longest waiting fiber.
+            /// @remark Fiber context callable
+            void unlock();
+
+        private:
+            fiber *owner_;
+            fiber_wait_queue waiters_;
+
+            // non-copyable
+            fiber_mutex(const fiber_mutex&) = delete;
+            fiber_mutex& operator=(const fiber_mutex&) = delete;
+        };
+
+        /// @brief  A condition variable for fibers, used with @ref fiber_mutex.
+        class fiber_condition_variable
+        {
+        public:
+            constexpr fiber_condition_variable()
+                : waiters_()
+            {
+            }
+
+            /// @brief  Releases the lock and blocks the current fiber until notified,
+            ///         then reacquires the lock.
+            /// @param  lock: the locked mutex
+            /// @remark Fiber context callable
+            void wait(unique_lock<fiber_mutex>& lock);
+
+            /// @brief  Blocks the current fiber until the predicate is satisfied.
+            /// @param  lock: the locked mutex
+            /// @param  stop_waiting: the predicate to check after each notification
+            /// @remark Fiber context callable
+            template<class Predicate>
+            void wait(unique_lock<fiber_mutex>& lock, Predicate stop_waiting)
+            {
+                while (!stop_waiting())
+                {
+                    wait(lock);
+                }
+            }
+
+            /// @brief  Wakes the longest waiting fiber.
+            void notify_one()
+            {
+                (void)waiters_.notify_one();
+            }
+
+            /// @brief  Wakes all waiting fibers.
+            void notify_all()
+            {
+                waiters_.notify_all();
+            }
+
+        private:
+            fiber_wait_queue waiters_;
+
+            // non-copyable
+            fiber_condition_variable(const fiber_condition_variable&) = delete;
+            fiber_condition_variable& operator=(const fiber_condition_variable&) = delete;
+        };
+
+        /// @brief  A bounded FIFO channel between fibers, the sender blocks while
+        ///         the channel is full, the receiver while it's empty.
+        /// @tparam T: the type of the transferred elements
+        /// @tparam MAX_SIZE: the capacity of the channel
+        template<typename T, const std::size_t MAX_SIZE>
+        class fiber_channel
+        {
+        public:
+            fiber_channel()
+                : head_(0), count_(0), senders_(), receivers_()
+            {
+            }
+
+            /// @return The number of elements in the channel
+            std::size_t size() const
+            {
+                return count_;
+            }
+
+            /// @brief  Pushes an element to the channel if it isn't full.
+            /// @return true if successful, false if the channel is full
+            /// @remark Fiber context callable
+            bool try_send(const T& value)
+            {
+                if (count_ == MAX_SIZE)
+                {
+                    return false;
+                }
+                buffer_[(head_ + count_) % MAX_SIZE] = value;
+                count_++;
+                (void)receivers_.notify_one();
+                return true;
+            }
+
+            /// @brief  Pushes an element to the channel, blocking the fiber while it's full.
+            /// @remark Fiber context callable
+            void send(const T& value)
+            {
+                while (!try_send(value))
+                {
+                    senders_.wait();
+                }
+            }
+
+            /// @brief  Removes the oldest element from the channel if it isn't empty.
+            /// @return true if successful, false if the channel is empty
+            /// @remark Fiber context callable
+            bool try_receive(T *value)
+            {
+                if (count_ == 0)
+                {
+                    return false;
+                }
+                *value = buffer_[head_];
+                head_ = (head_ + 1) % MAX_SIZE;
+                count_--;
+                (void)senders_.notify_one();
+                return true;
+            }
+
+            /// @brief  Removes the oldest element from the channel, blocking the fiber while it's empty.
+            /// @remark Fiber context callable
+            void receive(T *value)
+            {
+                while (!try_receive(value))
+                {
+                    receivers_.wait();
+                }
+            }
+
+        private:
+            T buffer_[MAX_SIZE];
+            std::size_t head_;
+            std::size_t count_;
+            fiber_wait_queue senders_;
+            fiber_wait_queue receivers_;
+
+            // non-copyable
+            fiber_channel(const fiber_channel&) = delete;
+            fiber_channel& operator=(const fiber_channel&) = delete;
+        };
+
+    #endif // (configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0) && (fiber context switch available)
+}
+
+#endif // __FREERTOS_FIBER_H_
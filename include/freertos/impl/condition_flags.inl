@@ -0,0 +1,138 @@
+/**
+ * @file      impl/condition_flags.inl
+ * @brief     FreeRTOS condition_flags inlineable operations
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_IMPL_CONDITION_FLAGS_INL_
+#define __FREERTOS_IMPL_CONDITION_FLAGS_INL_
+
+#include "freertos/condition_flags.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+        #include "event_groups.h"
+    }
+
+    FREERTOS_WRAPPER_INLINE cflag condition_flags::get() const
+    {
+        if (!this_cpu::uses_isr_api())
+        {
+            return get(thread_context);
+        }
+        else
+        {
+            return get(isr_context);
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE cflag condition_flags::get(thread_context_t) const
+    {
+        using namespace native;
+
+        return xEventGroupGetBits(handle());
+    }
+
+    FREERTOS_WRAPPER_INLINE cflag condition_flags::get(isr_context_t) const
+    {
+        using namespace native;
+
+        return xEventGroupGetBitsFromISR(handle());
+    }
+
+    FREERTOS_WRAPPER_INLINE void condition_flags::set(cflag flags)
+    {
+        if (!this_cpu::uses_isr_api())
+        {
+            set(thread_context, flags);
+        }
+        else
+        {
+            set(isr_context, flags);
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE void condition_flags::set(thread_context_t, cflag flags)
+    {
+        using namespace native;
+
+        (void)xEventGroupSetBits(handle(), flags);
+    }
+
+    FREERTOS_WRAPPER_INLINE void condition_flags::set(isr_context_t, cflag flags)
+    {
+        using namespace native;
+
+        #if (configUSE_TIMERS == 1)
+
+            BaseType_t needs_yield = false;
+            (void)xEventGroupSetBitsFromISR(handle(), flags, &needs_yield);
+            portYIELD_FROM_ISR(needs_yield);
+
+        #else
+
+            (void)flags;
+            configASSERT(false);
+
+        #endif // (configUSE_TIMERS == 1)
+    }
+
+    FREERTOS_WRAPPER_INLINE void condition_flags::clear(cflag flags)
+    {
+        if (!this_cpu::uses_isr_api())
+        {
+            clear(thread_context, flags);
+        }
+        else
+        {
+            clear(isr_context, flags);
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE void condition_flags::clear(thread_context_t, cflag flags)
+    {
+        using namespace native;
+
+        (void)xEventGroupClearBits(handle(), flags);
+    }
+
+    FREERTOS_WRAPPER_INLINE void condition_flags::clear(isr_context_t, cflag flags)
+    {
+        using namespace native;
+
+        #if (configUSE_TIMERS == 1)
+
+            (void)xEventGroupClearBitsFromISR(handle(), flags);
+
+        #else
+
+            (void)flags;
+            configASSERT(false);
+
+        #endif // (configUSE_TIMERS == 1)
+    }
+}
+
+#endif // __FREERTOS_IMPL_CONDITION_FLAGS_INL_
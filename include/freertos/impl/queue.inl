@@ -0,0 +1,252 @@
+/**
+ * @file      impl/queue.inl
+ * @brief     FreeRTOS queue API abstraction, inlineable operations
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_IMPL_QUEUE_INL_
+#define __FREERTOS_IMPL_QUEUE_INL_
+
+#include "freertos/queue.h"
+#include "freertos/trace_recorder.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "queue.h"
+    }
+
+    FREERTOS_WRAPPER_INLINE queue::size_type queue::size() const
+    {
+        using namespace native;
+
+        if (!this_cpu::uses_isr_api())
+        {
+            return uxQueueMessagesWaiting(handle());
+        }
+        else
+        {
+            return uxQueueMessagesWaitingFromISR(handle());
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::full() const
+    {
+        using namespace native;
+
+        if (!this_cpu::uses_isr_api())
+        {
+            return uxQueueMessagesWaiting(handle()) == 0;
+        }
+        else
+        {
+            return xQueueIsQueueFullFromISR(handle());
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::empty() const
+    {
+        using namespace native;
+
+        if (!this_cpu::uses_isr_api())
+        {
+            return uxQueueSpacesAvailable(handle()) == 0;
+        }
+        else
+        {
+            return xQueueIsQueueEmptyFromISR(handle());
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::push_front(void *data, tick_timer::duration waittime)
+    {
+        using namespace native;
+
+        if (!this_cpu::uses_isr_api())
+        {
+            return push_front(thread_context, data, waittime);
+        }
+        else
+        {
+            // cannot wait in ISR
+            configASSERT(to_ticks(waittime) == 0);
+
+            return push_front(isr_context, data);
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::push_front(thread_context_t, void *data, tick_timer::duration waittime)
+    {
+        using namespace native;
+
+        trace_recorder::api_call(trace_recorder::api::queue_push_front, this);
+
+        return xQueueSendToFront(handle(), data, to_ticks(waittime));
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::push_front(isr_context_t, void *data)
+    {
+        using namespace native;
+
+        trace_recorder::api_call(trace_recorder::api::queue_push_front, this);
+
+        BaseType_t needs_yield = false;
+        bool success = xQueueSendToFrontFromISR(handle(), data, &needs_yield);
+        portYIELD_FROM_ISR(needs_yield);
+        return success;
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::push_back(void *data, tick_timer::duration waittime)
+    {
+        using namespace native;
+
+        if (!this_cpu::uses_isr_api())
+        {
+            return push_back(thread_context, data, waittime);
+        }
+        else
+        {
+            // cannot wait in ISR
+            configASSERT(to_ticks(waittime) == 0);
+
+            return push_back(isr_context, data);
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::push_back(thread_context_t, void *data, tick_timer::duration waittime)
+    {
+        using namespace native;
+
+        trace_recorder::api_call(trace_recorder::api::queue_push_back, this);
+
+        return xQueueSendToBack(handle(), data, to_ticks(waittime));
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::push_back(isr_context_t, void *data)
+    {
+        using namespace native;
+
+        trace_recorder::api_call(trace_recorder::api::queue_push_back, this);
+
+        BaseType_t needs_yield = false;
+        bool success = xQueueSendToBackFromISR(handle(), data, &needs_yield);
+        portYIELD_FROM_ISR(needs_yield);
+        return success;
+    }
+
+    FREERTOS_WRAPPER_INLINE void queue::replace(void *data)
+    {
+        if (!this_cpu::uses_isr_api())
+        {
+            replace(thread_context, data);
+        }
+        else
+        {
+            replace(isr_context, data);
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE void queue::replace(thread_context_t, void *data)
+    {
+        using namespace native;
+
+        bool success = xQueueOverwrite(handle(), data);
+        configASSERT(success);
+    }
+
+    FREERTOS_WRAPPER_INLINE void queue::replace(isr_context_t, void *data)
+    {
+        using namespace native;
+
+        BaseType_t needs_yield = false;
+        bool success = xQueueOverwriteFromISR(handle(), data, &needs_yield);
+        configASSERT(success);
+        portYIELD_FROM_ISR(needs_yield);
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::peek_front(void *data, tick_timer::duration waittime) const
+    {
+        if (!this_cpu::uses_isr_api())
+        {
+            return peek_front(thread_context, data, waittime);
+        }
+        else
+        {
+            return peek_front(isr_context, data);
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::peek_front(thread_context_t, void *data, tick_timer::duration waittime) const
+    {
+        using namespace native;
+
+        return xQueuePeek(handle(), data, to_ticks(waittime));
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::peek_front(isr_context_t, void *data) const
+    {
+        using namespace native;
+
+        return xQueuePeekFromISR(handle(), data);
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::pop_front(void *data, tick_timer::duration waittime)
+    {
+        using namespace native;
+
+        if (!this_cpu::uses_isr_api())
+        {
+            return pop_front(thread_context, data, waittime);
+        }
+        else
+        {
+            // cannot wait in ISR
+            configASSERT(to_ticks(waittime) == 0);
+
+            return pop_front(isr_context, data);
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::pop_front(thread_context_t, void *data, tick_timer::duration waittime)
+    {
+        using namespace native;
+
+        trace_recorder::api_call(trace_recorder::api::queue_pop_front, this);
+
+        return xQueueReceive(handle(), data, to_ticks(waittime));
+    }
+
+    FREERTOS_WRAPPER_INLINE bool queue::pop_front(isr_context_t, void *data)
+    {
+        using namespace native;
+
+        trace_recorder::api_call(trace_recorder::api::queue_pop_front, this);
+
+        BaseType_t needs_yield = false;
+        bool success = xQueueReceiveFromISR(handle(), data, &needs_yield);
+        portYIELD_FROM_ISR(needs_yield);
+        return success;
+    }
+}
+
+#endif // __FREERTOS_IMPL_QUEUE_INL_
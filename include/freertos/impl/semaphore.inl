@@ -0,0 +1,124 @@
+/**
+ * @file      impl/semaphore.inl
+ * @brief     FreeRTOS semaphore API abstraction, inlineable operations
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_IMPL_SEMAPHORE_INL_
+#define __FREERTOS_IMPL_SEMAPHORE_INL_
+
+#include "freertos/semaphore.h"
+#include "freertos/trace_recorder.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "semphr.h"
+    }
+
+    FREERTOS_WRAPPER_INLINE bool semaphore::take(tick_timer::duration timeout)
+    {
+        using namespace native;
+
+        if (!this_cpu::uses_isr_api())
+        {
+            return take(thread_context, timeout);
+        }
+        else
+        {
+            // cannot wait in ISR
+            configASSERT(to_ticks(timeout) == 0);
+
+            return take(isr_context);
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE bool semaphore::take(thread_context_t, tick_timer::duration timeout)
+    {
+        using namespace native;
+
+        trace_recorder::api_call(trace_recorder::api::semaphore_acquire, this);
+
+        return xSemaphoreTake(handle(), to_ticks(timeout));
+    }
+
+    FREERTOS_WRAPPER_INLINE bool semaphore::take(isr_context_t)
+    {
+        using namespace native;
+
+        trace_recorder::api_call(trace_recorder::api::semaphore_acquire, this);
+
+        BaseType_t needs_yield = false;
+        bool success = xSemaphoreTakeFromISR(handle(), &needs_yield);
+        portYIELD_FROM_ISR(needs_yield);
+        return success;
+    }
+
+    FREERTOS_WRAPPER_INLINE bool semaphore::give(count_type update)
+    {
+        if (!this_cpu::uses_isr_api())
+        {
+            return give(thread_context, update);
+        }
+        else
+        {
+            return give(isr_context, update);
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE bool semaphore::give(thread_context_t, count_type update)
+    {
+        using namespace native;
+
+        trace_recorder::api_call(trace_recorder::api::semaphore_release, this);
+
+        // the API only allows giving a single count
+        bool success = true;
+        while (success && (update > 0))
+        {
+            success = xSemaphoreGive(handle());
+            update--;
+        }
+        return success;
+    }
+
+    FREERTOS_WRAPPER_INLINE bool semaphore::give(isr_context_t, count_type update)
+    {
+        using namespace native;
+
+        trace_recorder::api_call(trace_recorder::api::semaphore_release, this);
+
+        // the API only allows giving a single count
+        BaseType_t needs_yield = false;
+        bool success = true;
+        while (success && (update > 0))
+        {
+            success = xSemaphoreGiveFromISR(handle(), &needs_yield);
+            update--;
+        }
+        portYIELD_FROM_ISR(needs_yield);
+        return success;
+    }
+}
+
+#endif // __FREERTOS_IMPL_SEMAPHORE_INL_
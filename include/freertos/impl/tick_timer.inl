@@ -0,0 +1,76 @@
+/**
+ * @file      impl/tick_timer.inl
+ * @brief     FreeRTOS tick timer related API abstraction, inlineable operations
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_IMPL_TICK_TIMER_INL_
+#define __FREERTOS_IMPL_TICK_TIMER_INL_
+
+#include "freertos/tick_timer.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+
+    FREERTOS_WRAPPER_INLINE tick_timer::time_point tick_timer::now()
+    {
+        if (!this_cpu::uses_isr_api())
+        {
+            return now(thread_context);
+        }
+        else
+        {
+            return now(isr_context);
+        }
+    }
+
+    FREERTOS_WRAPPER_INLINE tick_timer::time_point tick_timer::now(thread_context_t)
+    {
+        using namespace native;
+
+        return time_point(duration(xTaskGetTickCount()));
+    }
+
+    FREERTOS_WRAPPER_INLINE tick_timer::time_point tick_timer::now(isr_context_t)
+    {
+        using namespace native;
+
+        return time_point(duration(xTaskGetTickCountFromISR()));
+    }
+
+    #if (configGENERATE_RUN_TIME_STATS == 1)
+
+        FREERTOS_WRAPPER_INLINE runtime_clock::time_point runtime_clock::now()
+        {
+            using namespace native;
+
+            return time_point(duration(portGET_RUN_TIME_COUNTER_VALUE()));
+        }
+
+    #endif // (configGENERATE_RUN_TIME_STATS == 1)
+}
+
+#endif // __FREERTOS_IMPL_TICK_TIMER_INL_
@@ -0,0 +1,118 @@
+/**
+ * @file      interrupt_simulator.h
+ * @brief     Simulated interrupt controller for host ports (e.g. the POSIX port)
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_INTERRUPT_SIMULATOR_H_
+#define __FREERTOS_INTERRUPT_SIMULATOR_H_
+
+#include "freertos/cpu.h"
+
+#ifndef configINTERRUPT_SIMULATOR_LINES
+#define configINTERRUPT_SIMULATOR_LINES         16
+#endif
+
+namespace freertos
+{
+    /// @brief  Static class that simulates an interrupt controller on host ports, so the wrappers'
+    ///         ISR paths (FromISR calls) can be exercised and measured.
+    ///         The handlers run in the context of a signal delivered to the running thread,
+    ///         the same way as the POSIX port's tick, and @ref this_cpu::is_in_isr reports true within them.
+    ///         Pending lines are dispatched in priority order, raising a higher priority line
+    ///         from a handler preempts it (nesting). Since the port runs the kernel's FromISR calls with
+    ///         the signals masked, raises from other contexts only preempt between handlers.
+    ///         Implemented in src/helpers/interrupt_simulator_posix.cpp.
+    class interrupt_simulator
+    {
+    public:
+        using handler = void (*)(void *arg);
+        using line_type = unsigned;
+        using priority_type = unsigned;
+
+        /// @brief  Number of simulated interrupt lines.
+        static constexpr line_type LINES = configINTERRUPT_SIMULATOR_LINES;
+
+        /// @brief  Dispatch statistics of an interrupt line.
+        struct line_statistics
+        {
+            /// @brief  Number of raise calls
+            std::uint32_t raised;
+            /// @brief  Number of handler executions, raises of an already pending line coalesce
+            std::uint32_t dispatched;
+            /// @brief  Largest and total raise to handler entry latency [ns]
+            std::uint64_t max_latency_ns;
+            std::uint64_t total_latency_ns;
+        };
+
+        /// @brief  Installs the simulated interrupt signal handler. Host threads that aren't
+        ///         kernel threads must block the signal (see configINTERRUPT_SIMULATOR_SIGNAL).
+        static void start();
+
+        /// @brief  Connects a handler to an interrupt line.
+        /// @param  line: the interrupt line's index
+        /// @param  func: the interrupt handler
+        /// @param  arg: the handler's argument
+        /// @param  priority: the line's priority, higher value is more urgent
+        /// @return true if the line was free, false otherwise
+        static bool attach(line_type line, handler func, void *arg, priority_type priority = 0);
+
+        /// @brief  Disconnects the handler of an interrupt line, stopping its storm.
+        /// @param  line: the interrupt line's index
+        static void detach(line_type line);
+
+        /// @brief  Sets the interrupt line pending, the handler is executed when the line's
+        ///         priority is higher than the running handler's (if any).
+        /// @param  line: the interrupt line's index
+        /// @remark Thread, ISR and host thread context callable
+        static void raise(line_type line);
+
+        /// @brief  Raises an interrupt line periodically from a dedicated host thread.
+        /// @param  line: the interrupt line's index
+        /// @param  rate_Hz: the rate of the raises
+        /// @return true if the storm is started, false if the line has no handler or is already storming
+        static bool start_storm(line_type line, std::uint32_t rate_Hz);
+
+        /// @brief  Stops the storm of an interrupt line.
+        /// @param  line: the interrupt line's index
+        static void stop_storm(line_type line);
+
+        /// @brief  Reads the number of nested handlers executing on the calling thread.
+        /// @return 0 outside of simulated interrupts, the nesting depth otherwise
+        /// @remark Thread and ISR context callable
+        static unsigned get_nesting();
+
+        /// @brief  Reads the dispatch statistics of an interrupt line.
+        /// @param  line: the interrupt line's index
+        /// @return The line's statistics
+        static line_statistics get_statistics(line_type line);
+
+        /// @brief  Clears the dispatch statistics of an interrupt line.
+        /// @param  line: the interrupt line's index
+        static void reset_statistics(line_type line);
+
+    private:
+        interrupt_simulator();
+    };
+}
+
+#endif // __FREERTOS_INTERRUPT_SIMULATOR_H_
@@ -0,0 +1,161 @@
+/**
+ * @file      latency_probe.h
+ * @brief     Wake-up latency measurement from signalling to the woken thread running
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_LATENCY_PROBE_H_
+#define __FREERTOS_LATENCY_PROBE_H_
+
+#include "freertos/thread.h"
+
+namespace freertos
+{
+    #if (configGENERATE_RUN_TIME_STATS == 1)
+
+        /// @brief  The non-template part of @ref latency_probe.
+        class latency_probe_base
+        {
+        public:
+            using duration = runtime_clock::duration;
+
+            /// @brief  Aggregated latency statistics of the probe.
+            struct statistics
+            {
+                /// @brief  Number of measured wake-ups
+                std::size_t count;
+                /// @brief  Number of signals that were raised again before the thread woke up
+                std::size_t coalesced;
+                duration min;
+                duration max;
+                /// @brief  Sum of all latencies, divide by count for the mean
+                std::uint64_t total;
+            };
+
+            /// @brief  Timestamps the signal side, call it right before signalling
+            ///         (e.g. notifier::signal(), semaphore::release(), queue::push_back()).
+            ///         Further signals before the wake-up are counted as coalesced,
+            ///         the latency is measured from the first one.
+            /// @remark Thread and ISR context callable
+            void mark_signal();
+
+            /// @brief  Timestamps the wake side, call it right after the waiting call returns
+            ///         in the woken thread. Wake-ups without a preceding signal are ignored.
+            /// @remark Thread context callable
+            void mark_wake();
+
+            /// @brief  Signals through the probe: timestamps, then executes the signalling function.
+            /// @param  signal: the signalling call, e.g. [&]{ sem.release(); }
+            /// @remark Thread and ISR context callable
+            template<class Signal>
+            void signal(Signal signal)
+            {
+                mark_signal();
+                signal();
+            }
+
+            /// @return The label of the probe (the signalling primitive)
+            const char *get_name() const
+            {
+                return name_;
+            }
+
+            /// @return The thread that the wake-ups were measured in (the last one if there were more)
+            thread *get_thread() const
+            {
+                return thread_;
+            }
+
+            /// @return The aggregated statistics of the probe
+            /// @remark Thread and ISR context callable
+            statistics get_statistics() const;
+
+            /// @brief  Reads the latency histogram. Bin 0 counts the latencies below 1 counter period,
+            ///         bin i counts the latencies in [2^(i-1), 2^i) counter periods,
+            ///         and the last bin counts all longer ones.
+            /// @param  bins: the array to fill with the bin counts
+            /// @param  max_bins: the size of the array
+            /// @return The number of bins filled in
+            /// @remark Thread and ISR context callable
+            std::size_t get_histogram(std::size_t *bins, std::size_t max_bins) const;
+
+            /// @brief  Clears the statistics and the histogram.
+            /// @remark Thread and ISR context callable
+            void reset();
+
+            /// @brief  Access to all probes, for runtime querying.
+            /// @return The first constructed probe, or nullptr if there's none
+            static latency_probe_base *first();
+
+            /// @return The next probe after this one, or nullptr if this is the last
+            latency_probe_base *next() const
+            {
+                return next_;
+            }
+
+        protected:
+            latency_probe_base(const char *name, std::size_t *bins, std::size_t bin_count);
+            ~latency_probe_base();
+
+        private:
+            void record(duration latency);
+
+            const char *const name_;
+            std::size_t *const bins_;
+            const std::size_t bin_count_;
+            latency_probe_base *next_;
+            thread *thread_;
+            runtime_clock::time_point signal_time_;
+            bool pending_;
+            statistics stats_;
+
+            // non-copyable
+            latency_probe_base(const latency_probe_base&) = delete;
+            latency_probe_base& operator=(const latency_probe_base&) = delete;
+        };
+
+        /// @brief  Measures the latency from a signal (in a thread or ISR) until the woken thread runs,
+        ///         using the run time statistics counter (see @ref runtime_clock) as time reference,
+        ///         and aggregates it in a logarithmic histogram. Use a separate probe
+        ///         for each signalling primitive and waiting thread pair.
+        /// @tparam BINS: the number of histogram bins
+        template<const std::size_t BINS = 16>
+        class latency_probe : public latency_probe_base
+        {
+            static_assert(BINS > 1, "The histogram needs at least two bins.");
+
+        public:
+            /// @brief  Constructs a probe and registers it for runtime querying.
+            /// @param  name: label of the probe, e.g. the signalling primitive's name
+            explicit latency_probe(const char *name)
+                : latency_probe_base(name, bins_, BINS), bins_()
+            {
+            }
+
+        private:
+            std::size_t bins_[BINS];
+        };
+
+    #endif // (configGENERATE_RUN_TIME_STATS == 1)
+}
+
+#endif // __FREERTOS_LATENCY_PROBE_H_
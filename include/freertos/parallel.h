@@ -0,0 +1,282 @@
+/**
+ * @file      parallel.h
+ * @brief     Fork-join parallel algorithms executed on an executor's workers
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_PARALLEL_H_
+#define __FREERTOS_PARALLEL_H_
+
+#include "freertos/executor.h"
+#include <algorithm>
+#include <atomic>
+
+namespace freertos
+{
+    #if (configUSE_TASK_NOTIFICATIONS == 1)
+
+        /// @brief  Completion tracking of a fork-join operation. The creator thread
+        ///         is the first participant, each forked helper adds another one.
+        ///         The creator thread blocks in @ref join until all participants have left.
+        class fork_join
+        {
+        public:
+            /// @brief  Constructs the fork-join operation with the current thread as participant.
+            /// @remark Thread context callable
+            fork_join();
+
+            /// @brief  Registers a new participant, must be called before the helper is started.
+            inline void fork()
+            {
+                pending_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /// @brief  Signals that a participant has completed its work.
+            ///         The object must not be accessed by the participant afterwards.
+            void leave();
+
+            /// @brief  Completes the creator thread's participation,
+            ///         and waits until all other participants have left.
+            /// @remark Thread context callable (only by the creator thread)
+            void join();
+
+        private:
+            thread *const owner_;
+            std::atomic<std::size_t> pending_;
+
+            // non-copyable
+            fork_join(const fork_join&) = delete;
+            fork_join& operator=(const fork_join&) = delete;
+        };
+
+        /// @brief  Posts helper jobs that call ctx->run(participant_index) on the executor.
+        ///         The participant index 0 is reserved for the calling thread.
+        ///         No helpers are posted when called from a worker of the same lane,
+        ///         since the queued helpers could wait for the caller's worker indefinitely.
+        /// @return The number of helpers that are successfully posted
+        template<class Executor, class Context>
+        std::size_t fork_helpers(Executor& ex, std::size_t lane, Context *ctx, std::size_t helpers)
+        {
+            if (ex.lane(lane).is_current_worker())
+            {
+                // the calling thread processes the whole work alone
+                return 0;
+            }
+
+            std::size_t posted = 0;
+            for (std::size_t i = 1; i <= helpers; i++)
+            {
+                ctx->group.fork();
+                if (ex.post([ctx, i]()
+                    {
+                        ctx->run(i);
+                        ctx->group.leave();
+                    }, lane))
+                {
+                    posted++;
+                }
+                else
+                {
+                    // the queue is full, the remaining work is picked up by the other participants
+                    ctx->group.leave();
+                    break;
+                }
+            }
+            return posted;
+        }
+
+        /// @brief  Calls @ref fn for all index subranges of [first, last), in parallel.
+        ///         The subranges are at most @ref grain long, and they are handed out
+        ///         on demand, so the participants that progress faster process more chunks.
+        ///         The calling thread participates in the work, and this call returns
+        ///         when all chunks have been processed. When called from a worker of the
+        ///         selected lane, the calling thread processes all chunks alone.
+        /// @param  ex:    the executor whose workers help with the work
+        /// @param  first: the first index of the range
+        /// @param  last:  the end (one past the last index) of the range
+        /// @param  grain: the maximum number of indexes processed in a single call of @ref fn
+        /// @param  fn:    the callable to execute as fn(chunk_first, chunk_last)
+        /// @param  lane:  the executor lane to use
+        /// @remark Thread context callable
+        template<class Executor, typename Index, class Function>
+        void parallel_for(Executor& ex, Index first, Index last, std::size_t grain, Function fn,
+                std::size_t lane = 0)
+        {
+            if (!(first < last))
+            {
+                return;
+            }
+            grain = std::max<std::size_t>(grain, 1);
+
+            struct context
+            {
+                Function& fn;
+                const Index first;
+                const std::size_t count;
+                const std::size_t grain;
+                std::atomic<std::size_t> next;
+                fork_join group;
+
+                void run(std::size_t)
+                {
+                    for (;;)
+                    {
+                        std::size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+                        if (begin >= count)
+                        {
+                            break;
+                        }
+                        std::size_t end = std::min(begin + grain, count);
+                        fn(first + static_cast<Index>(begin), first + static_cast<Index>(end));
+                    }
+                }
+            } ctx { fn, first, static_cast<std::size_t>(last - first), grain, { 0 }, {} };
+
+            const std::size_t chunks = (ctx.count + grain - 1) / grain;
+            (void)fork_helpers(ex, lane, &ctx,
+                    std::min<std::size_t>(Executor::workers_per_lane(), chunks - 1));
+
+            ctx.run(0);
+            ctx.group.join();
+        }
+
+        /// @brief  Reduces the index range [first, last) in parallel.
+        ///         Each participant accumulates its own partial result chunk by chunk,
+        ///         starting from @ref identity, then the partial results are combined
+        ///         in the calling thread, in a deterministic order. When called from a worker
+        ///         of the selected lane, the calling thread processes all chunks alone.
+        /// @param  ex:       the executor whose workers help with the work
+        /// @param  first:    the first index of the range
+        /// @param  last:     the end (one past the last index) of the range
+        /// @param  grain:    the maximum number of indexes processed in a single call of @ref fn
+        /// @param  identity: the identity value of the reduction
+        /// @param  fn:       the callable to execute as acc = fn(chunk_first, chunk_last, acc)
+        /// @param  reduce:   the callable that combines two partial results as reduce(a, b)
+        /// @param  lane:     the executor lane to use
+        /// @return The result of the reduction
+        /// @remark Thread context callable
+        template<class Executor, typename Index, typename T, class Function, class Reduction>
+        T parallel_reduce(Executor& ex, Index first, Index last, std::size_t grain,
+                const T& identity, Function fn, Reduction reduce, std::size_t lane = 0)
+        {
+            if (!(first < last))
+            {
+                return identity;
+            }
+            grain = std::max<std::size_t>(grain, 1);
+
+            constexpr std::size_t PARTICIPANTS = Executor::workers_per_lane() + 1;
+            using partial_storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+            struct context
+            {
+                Function& fn;
+                const Index first;
+                const std::size_t count;
+                const std::size_t grain;
+                std::atomic<std::size_t> next;
+                fork_join group;
+                partial_storage partials[PARTICIPANTS];
+
+                T& partial(std::size_t participant)
+                {
+                    return *reinterpret_cast<T*>(&partials[participant]);
+                }
+
+                void run(std::size_t participant)
+                {
+                    T& acc = partial(participant);
+                    for (;;)
+                    {
+                        std::size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+                        if (begin >= count)
+                        {
+                            break;
+                        }
+                        std::size_t end = std::min(begin + grain, count);
+                        acc = fn(first + static_cast<Index>(begin), first + static_cast<Index>(end), acc);
+                    }
+                }
+            } ctx { fn, first, static_cast<std::size_t>(last - first), grain, { 0 }, {}, {} };
+
+            for (std::size_t i = 0; i < PARTICIPANTS; i++)
+            {
+                ::new (&ctx.partials[i]) T(identity);
+            }
+
+            const std::size_t chunks = (ctx.count + grain - 1) / grain;
+            (void)fork_helpers(ex, lane, &ctx,
+                    std::min<std::size_t>(PARTICIPANTS - 1, chunks - 1));
+
+            ctx.run(0);
+            ctx.group.join();
+
+            T result = identity;
+            for (std::size_t i = 0; i < PARTICIPANTS; i++)
+            {
+                result = reduce(result, ctx.partial(i));
+                ctx.partial(i).~T();
+            }
+            return result;
+        }
+
+        /// @brief  Helper of @ref parallel_invoke, executes a single callable.
+        template<class Executor, class Function>
+        int fork_invoke(Executor& ex, std::size_t lane, fork_join *group, Function *fn)
+        {
+            group->fork();
+            if (ex.lane(lane).is_current_worker() || !ex.post([group, fn]()
+                {
+                    (*fn)();
+                    group->leave();
+                }, lane))
+            {
+                // no room in the queue, or called from the lane's own worker: execute in place
+                (*fn)();
+                group->leave();
+            }
+            return 0;
+        }
+
+        /// @brief  Executes all callables in parallel, the first one is executed by the
+        ///         calling thread. The call returns when all callables have returned.
+        ///         When called from a worker of the executor's first lane, all callables
+        ///         are executed by the calling thread.
+        /// @param  ex:    the executor whose workers execute the rest of the callables
+        /// @param  first: the callable to execute in the calling thread
+        /// @param  rest:  the callables to execute by the executor's workers
+        /// @remark Thread context callable
+        template<class Executor, class Function, class... Functions>
+        void parallel_invoke(Executor& ex, Function first, Functions... rest)
+        {
+            fork_join group;
+            int forks[] = { 0, fork_invoke(ex, 0, &group, &rest)... };
+            (void)forks;
+
+            first();
+            group.join();
+        }
+
+    #endif // (configUSE_TASK_NOTIFICATIONS == 1)
+}
+
+#endif // __FREERTOS_PARALLEL_H_
@@ -0,0 +1,153 @@
+/**
+ * @file      periodic_thread.h
+ * @brief     Fixed rate thread with execution time statistics
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_PERIODIC_THREAD_H_
+#define __FREERTOS_PERIODIC_THREAD_H_
+
+#include "freertos/thread.h"
+
+namespace freertos
+{
+    /// @brief  The non-template part of @ref periodic_thread.
+    class periodic_thread_base
+    {
+    public:
+        using step_function = void (*)(void*);
+
+        /// @brief  The clock that the execution times are measured with.
+        #if (configGENERATE_RUN_TIME_STATS == 1)
+            using clock = runtime_clock;
+        #else
+            using clock = tick_timer;
+        #endif
+
+        /// @brief  Selects what happens when a cycle's execution doesn't complete within the period.
+        enum class overrun_policy
+        {
+            catch_up, ///< the missed cycles are executed back-to-back
+            skip,     ///< the missed cycles are skipped, the schedule continues with the next period
+        };
+
+        /// @brief  Timing statistics of the periodic execution.
+        struct statistics
+        {
+            /// @brief  Number of executed cycles
+            std::uint32_t cycles;
+            /// @brief  Number of cycles that didn't complete within the period
+            std::uint32_t overruns;
+            /// @brief  Number of cycles skipped due to overruns (with @ref overrun_policy::skip)
+            std::uint32_t skipped;
+            /// @brief  Execution time of the step function
+            clock::duration last_exec_time;
+            clock::duration max_exec_time;
+            /// @brief  Time from the scheduled release until the step function's completion
+            tick_timer::duration last_response_time;
+            tick_timer::duration max_response_time;
+            /// @brief  Largest deviation of the time between two consecutive cycle starts from the period
+            clock::duration max_jitter;
+        };
+
+        /// @return The period of the execution
+        tick_timer::duration get_period() const
+        {
+            return period_;
+        }
+
+        /// @return The overrun handling policy
+        overrun_policy get_overrun_policy() const
+        {
+            return policy_;
+        }
+
+        /// @brief  Reads the current timing statistics.
+        /// @return A consistent copy of the statistics
+        /// @remark Thread and ISR context callable
+        statistics get_statistics() const;
+
+        /// @brief  Clears the timing statistics.
+        /// @remark Thread and ISR context callable
+        void reset_statistics();
+
+    protected:
+        periodic_thread_base(step_function step, void *param,
+                tick_timer::duration period, overrun_policy policy)
+            : step_(step), param_(param), period_(period), policy_(policy), stats_()
+        {
+        }
+
+        // the thread function
+        static void run(periodic_thread_base *p);
+
+    private:
+        void record(const statistics& cycle);
+
+        const step_function step_;
+        void *const param_;
+        const tick_timer::duration period_;
+        const overrun_policy policy_;
+        statistics stats_;
+
+        // non-copyable
+        periodic_thread_base(const periodic_thread_base&) = delete;
+        periodic_thread_base& operator=(const periodic_thread_base&) = delete;
+    };
+
+    /// @brief  A statically allocated thread that calls a step function at a fixed rate.
+    ///         The release times are absolute multiples of the period, so the schedule
+    ///         doesn't drift with the execution time of the step function.
+    /// @tparam STACK_SIZE_BYTES: the stack size of the thread in bytes
+    template<const std::size_t STACK_SIZE_BYTES>
+    class periodic_thread : public periodic_thread_base
+    {
+    public:
+        /// @brief  Constructs and starts the periodic thread, the first cycle is executed immediately.
+        /// @param  step:   the function to call in each cycle
+        /// @param  param:  opaque parameter to pass to the step function
+        /// @param  period: the cycle time
+        /// @param  prio:   thread priority level
+        /// @param  policy: the overrun handling policy
+        /// @param  name:   short label for identifying the thread
+        /// @remark Thread context callable
+        periodic_thread(step_function step, void *param, tick_timer::duration period,
+                thread::priority prio = thread::priority(),
+                overrun_policy policy = overrun_policy::catch_up,
+                const char *name = thread::DEFAULT_NAME)
+            : periodic_thread_base(step, param, period, policy),
+              thread_(&periodic_thread_base::run, static_cast<periodic_thread_base*>(this), prio, name)
+        {
+        }
+
+        /// @return The thread executing the cycles
+        thread& get_thread()
+        {
+            return thread_;
+        }
+
+    private:
+        static_thread<STACK_SIZE_BYTES> thread_;
+    };
+}
+
+#endif // __FREERTOS_PERIODIC_THREAD_H_
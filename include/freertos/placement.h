@@ -0,0 +1,114 @@
+/**
+ * @file      placement.h
+ * @brief     Memory region placement of kernel objects
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_PLACEMENT_H_
+#define __FREERTOS_PLACEMENT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief  Places the following object definition in the named linker section,
+///         e.g. FREERTOS_PLACE_IN(".dtcm") static freertos::thread_stack<4096> stack;
+///         The section must be defined in the linker script. Objects in sections
+///         that aren't zero-initialized by the startup code must be constructed
+///         (which the kernel object constructors do).
+#ifndef FREERTOS_PLACE_IN
+#if defined(__GNUC__) || defined(__clang__)
+#define FREERTOS_PLACE_IN(SECTION)      __attribute__((section(SECTION)))
+#else
+#define FREERTOS_PLACE_IN(SECTION)
+#endif
+#endif
+
+namespace freertos
+{
+    /// @brief  A named address range of the memory map, typically defined by linker symbols.
+    struct memory_region
+    {
+        const char *name;
+        const void *begin;
+        const void *end;
+
+        /// @brief  Determines if the object lies entirely inside the region.
+        /// @param  address: the start address of the object
+        /// @param  size:    the size of the object
+        /// @return true if the object is inside the region
+        bool contains(const void *address, std::size_t size = 1) const
+        {
+            auto a = reinterpret_cast<std::uintptr_t>(address);
+            return (a >= reinterpret_cast<std::uintptr_t>(begin)) &&
+                   ((a + size) <= reinterpret_cast<std::uintptr_t>(end));
+        }
+    };
+
+    /// @brief  An object to include in the placement report.
+    struct placement_record
+    {
+        const char *name;
+        const void *address;
+        std::size_t size;
+    };
+
+    /// @brief  Finds the region that the object lies in.
+    /// @param  address: the start address of the object
+    /// @param  size:    the size of the object
+    /// @param  regions: the memory regions to search in
+    /// @param  count:   the number of regions
+    /// @return The region containing the object, or nullptr if none contains it entirely
+    const memory_region *find_memory_region(const void *address, std::size_t size,
+            const memory_region *regions, std::size_t count);
+
+    template<const std::size_t COUNT>
+    const memory_region *find_memory_region(const void *address, std::size_t size,
+            const memory_region (&regions)[COUNT])
+    {
+        return find_memory_region(address, size, regions, COUNT);
+    }
+
+    /// @brief  Reports which memory region each of the objects is placed in.
+    /// @param  records: the objects to report on
+    /// @param  record_count: the number of objects
+    /// @param  regions: the memory regions of the target
+    /// @param  region_count: the number of regions
+    /// @param  print: called for each object, with nullptr region if it's outside all regions
+    /// @return The number of objects that are outside all regions
+    std::size_t report_placement(const placement_record *records, std::size_t record_count,
+            const memory_region *regions, std::size_t region_count,
+            void (*print)(const placement_record& record, const memory_region *region));
+
+    template<const std::size_t RECORD_COUNT, const std::size_t REGION_COUNT>
+    std::size_t report_placement(const placement_record (&records)[RECORD_COUNT],
+            const memory_region (&regions)[REGION_COUNT],
+            void (*print)(const placement_record& record, const memory_region *region))
+    {
+        return report_placement(records, RECORD_COUNT, regions, REGION_COUNT, print);
+    }
+}
+
+/// @brief  Creates a @ref placement_record of a named object, e.g. FREERTOS_PLACEMENT_RECORD(stack)
+#define FREERTOS_PLACEMENT_RECORD(OBJECT) \
+    freertos::placement_record { #OBJECT, &(OBJECT), sizeof(OBJECT) }
+
+#endif // __FREERTOS_PLACEMENT_H_
@@ -26,6 +26,7 @@
 #ifndef __FREERTOS_QUEUE_H_
 #define __FREERTOS_QUEUE_H_
 
+#include "freertos/cpu.h"
 #include "freertos/tick_timer.h"
 
 namespace freertos
@@ -82,6 +83,18 @@ namespace freertos
         bool peek_front(void *data, tick_timer::duration waittime) const;
         bool pop_front(void *data, tick_timer::duration waittime);
 
+        // context specific variants, which skip the context detection
+        bool push_front(thread_context_t, void *data, tick_timer::duration waittime);
+        bool push_front(isr_context_t, void *data);
+        bool push_back(thread_context_t, void *data, tick_timer::duration waittime);
+        bool push_back(isr_context_t, void *data);
+        void replace(thread_context_t, void *data);
+        void replace(isr_context_t, void *data);
+        bool peek_front(thread_context_t, void *data, tick_timer::duration waittime) const;
+        bool peek_front(isr_context_t, void *data) const;
+        bool pop_front(thread_context_t, void *data, tick_timer::duration waittime);
+        bool pop_front(isr_context_t, void *data);
+
         // empty constructor is used by semaphores, since the underlying API create calls differ
         queue()
         {
@@ -91,6 +104,8 @@ namespace freertos
         queue(size_type size, size_type elem_size, unsigned char *elem_buffer);
 
     private:
+        friend class queue_set;
+
         // non-copyable
         queue(const queue&) = delete;
         queue& operator=(const queue&) = delete;
@@ -160,6 +175,102 @@ namespace freertos
             return queue::pop_front(reinterpret_cast<void*>(value), waittime);
         }
 
+        /// @brief  Pushes a new value to the front of the queue, from thread context.
+        /// @param  value: the new value to copy
+        /// @param  waittime: duration to wait for the queue to have available space
+        /// @return true if successful, false if the queue is full
+        /// @remark Thread context callable
+        bool push_front(thread_context_t ctx, const value_type &value,
+                tick_timer::duration waittime = tick_timer::duration(0))
+        {
+            return queue::push_front(ctx, reinterpret_cast<void*>(const_cast<value_type*>(&value)), waittime);
+        }
+
+        /// @brief  Pushes a new value to the front of the queue, from ISR context.
+        /// @param  value: the new value to copy
+        /// @return true if successful, false if the queue is full
+        /// @remark ISR context callable
+        bool push_front(isr_context_t ctx, const value_type &value)
+        {
+            return queue::push_front(ctx, reinterpret_cast<void*>(const_cast<value_type*>(&value)));
+        }
+
+        /// @brief  Pushes a new value to the back of the queue, from thread context.
+        /// @param  value: the new value to copy
+        /// @param  waittime: duration to wait for the queue to have available space
+        /// @return true if successful, false if the queue is full
+        /// @remark Thread context callable
+        bool push_back(thread_context_t ctx, const value_type &value,
+                tick_timer::duration waittime = tick_timer::duration(0))
+        {
+            return queue::push_back(ctx, reinterpret_cast<void*>(const_cast<value_type*>(&value)), waittime);
+        }
+
+        /// @brief  Pushes a new value to the back of the queue, from ISR context.
+        /// @param  value: the new value to copy
+        /// @return true if successful, false if the queue is full
+        /// @remark ISR context callable
+        bool push_back(isr_context_t ctx, const value_type &value)
+        {
+            return queue::push_back(ctx, reinterpret_cast<void*>(const_cast<value_type*>(&value)));
+        }
+
+        /// @brief  Replaces the current queue element value to a new one, from thread context.
+        /// @param  value: the new value to copy
+        /// @remark Thread context callable
+        void replace(thread_context_t ctx, const value_type &value)
+        {
+            queue::replace(ctx, reinterpret_cast<void*>(const_cast<value_type*>(&value)));
+        }
+
+        /// @brief  Replaces the current queue element value to a new one, from ISR context.
+        /// @param  value: the new value to copy
+        /// @remark ISR context callable
+        void replace(isr_context_t ctx, const value_type &value)
+        {
+            queue::replace(ctx, reinterpret_cast<void*>(const_cast<value_type*>(&value)));
+        }
+
+        /// @brief  Copies the front value of the queue without consuming it, from thread context.
+        /// @param  value: the destination pointer to copy to
+        /// @param  waittime: duration to wait for the queue to have an available element
+        /// @return true if successful, false if the queue is empty
+        /// @remark Thread context callable
+        bool peek_front(thread_context_t ctx, value_type *value,
+                tick_timer::duration waittime = tick_timer::duration(0)) const
+        {
+            return queue::peek_front(ctx, reinterpret_cast<void*>(value), waittime);
+        }
+
+        /// @brief  Copies the front value of the queue without consuming it, from ISR context.
+        /// @param  value: the destination pointer to copy to
+        /// @return true if successful, false if the queue is empty
+        /// @remark ISR context callable
+        bool peek_front(isr_context_t ctx, value_type *value) const
+        {
+            return queue::peek_front(ctx, reinterpret_cast<void*>(value));
+        }
+
+        /// @brief  Copies the front value of the queue and removes it from the queue, from thread context.
+        /// @param  value: the destination pointer to copy to
+        /// @param  waittime: duration to wait for the queue to have an available element
+        /// @return true if successful, false if the queue is empty
+        /// @remark Thread context callable
+        bool pop_front(thread_context_t ctx, value_type *value,
+                tick_timer::duration waittime = tick_timer::duration(0))
+        {
+            return queue::pop_front(ctx, reinterpret_cast<void*>(value), waittime);
+        }
+
+        /// @brief  Copies the front value of the queue and removes it from the queue, from ISR context.
+        /// @param  value: the destination pointer to copy to
+        /// @return true if successful, false if the queue is empty
+        /// @remark ISR context callable
+        bool pop_front(isr_context_t ctx, value_type *value)
+        {
+            return queue::pop_front(ctx, reinterpret_cast<void*>(value));
+        }
+
     protected:
         ishallow_copy_queue(size_type size, size_type elem_size, unsigned char *elem_buffer)
             : queue(size, elem_size, elem_buffer)
@@ -190,6 +301,46 @@ namespace freertos
     private:
         unsigned char elem_buffer_[max_size() * sizeof(value_type)];
     };
+
+    /// @brief  Element storage for a @ref placed_queue, define it separately from the queue
+    ///         to control its placement (e.g. with FREERTOS_PLACE_IN).
+    template<typename T, const queue::size_type MAX_SIZE>
+    struct queue_storage
+    {
+        using value_type = T;
+
+        static constexpr queue::size_type max_size()
+        {
+            return MAX_SIZE;
+        }
+
+        unsigned char elem_buffer[MAX_SIZE * sizeof(T)];
+    };
+
+    /// @brief  A shallow-copy queue whose element storage is provided by the user as a separate object,
+    ///         so the control block (the queue object itself) and the elements
+    ///         can be placed in different memory regions.
+    template<typename T>
+    class placed_queue : public ishallow_copy_queue<T>
+    {
+    public:
+        using value_type = T;
+        using size_type = queue::size_type;
+
+        /// @brief  Constructs a shallow-copy queue on the provided storage.
+        /// @param  storage: the element storage of the queue, which must outlive the queue
+        template<const queue::size_type MAX_SIZE>
+        explicit placed_queue(queue_storage<T, MAX_SIZE>& storage)
+            : ishallow_copy_queue<value_type>(MAX_SIZE, sizeof(value_type), storage.elem_buffer)
+        {
+        }
+    };
 }
 
+#if (configINLINE_WRAPPERS == 1)
+
+#include "freertos/impl/queue.inl"
+
+#endif // (configINLINE_WRAPPERS == 1)
+
 #endif // __FREERTOS_QUEUE_H_
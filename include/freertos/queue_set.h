@@ -0,0 +1,149 @@
+/**
+ * @file      queue_set.h
+ * @brief     Wrapper for FreeRTOS queue sets
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_QUEUE_SET_H_
+#define __FREERTOS_QUEUE_SET_H_
+
+#include "freertos/queue.h"
+#include "freertos/semaphore.h"
+
+namespace freertos
+{
+    #if (configUSE_QUEUE_SETS == 1)
+
+        /// @brief  A set of queues and semaphores, which allows a thread to block
+        ///         until any of its members becomes available. Each element that is pushed
+        ///         to a member queue (or each semaphore release) posts an event to the set,
+        ///         therefore the set's length must be at least the sum of its members' lengths.
+        /// @note   Mutexes cannot be members of a queue set, and a queue can only be
+        ///         the member of one set at a time.
+        class queue_set : protected queue
+        {
+        public:
+            /// @brief  Adds a queue to the set.
+            /// @param  q: the queue to add, which must be empty
+            /// @return true if added, false if the queue isn't empty or is already the member of a set
+            /// @remark Thread context callable
+            bool add(queue& q);
+
+            /// @brief  Adds a semaphore to the set.
+            /// @param  sem: the semaphore to add, which must be unavailable
+            /// @return true if added, false if the semaphore is available or is already the member of a set
+            /// @remark Thread context callable
+            bool add(semaphore& sem);
+
+            /// @brief  Removes a queue from the set.
+            /// @param  q: the queue to remove, which must be empty
+            /// @return true if removed, false if the queue isn't empty or isn't the member of this set
+            /// @remark Thread context callable
+            bool remove(queue& q);
+
+            /// @brief  Removes a semaphore from the set.
+            /// @param  sem: the semaphore to remove, which must be unavailable
+            /// @return true if removed, false if the semaphore is available or isn't the member of this set
+            /// @remark Thread context callable
+            bool remove(semaphore& sem);
+
+            /// @brief  Waits for an event of the set's members, and consumes it.
+            ///         The member that posted the event must be read afterwards.
+            /// @param  rel_time: duration to wait for an event
+            /// @return true if a member posted an event, false if timed out
+            /// @remark Thread context callable
+            template<class Rep, class Period>
+            inline bool select_for(const std::chrono::duration<Rep, Period>& rel_time)
+            {
+                return select(std::chrono::duration_cast<tick_timer::duration>(rel_time));
+            }
+
+            /// @brief  Consumes a pending event of the set's members, if there is any.
+            /// @return true if a member posted an event, false otherwise
+            /// @remark Thread and ISR context callable
+            bool try_select();
+
+            /// @brief  Waits for an event of the set's members, and consumes it.
+            ///         The returned member must be read afterwards.
+            /// @param  rel_time: duration to wait for an event
+            /// @return The @ref member_id of the member that posted the event, or nullptr if timed out
+            /// @remark Thread context callable
+            template<class Rep, class Period>
+            inline const void *select_member_for(const std::chrono::duration<Rep, Period>& rel_time)
+            {
+                return select_member(std::chrono::duration_cast<tick_timer::duration>(rel_time));
+            }
+
+            /// @brief  Consumes a pending event of the set's members, if there is any.
+            ///         The returned member must be read afterwards.
+            /// @return The @ref member_id of the member that posted the event, or nullptr if there is none
+            /// @remark Thread and ISR context callable
+            const void *try_select_member();
+
+            /// @brief  Identifies a queue in the selected events.
+            /// @param  q: the member queue
+            /// @return The identifier that the set's events carry for the queue
+            static const void *member_id(const queue& q);
+
+            /// @brief  Identifies a semaphore in the selected events.
+            /// @param  sem: the member semaphore
+            /// @return The identifier that the set's events carry for the semaphore
+            static const void *member_id(const semaphore& sem);
+
+        protected:
+            bool select(tick_timer::duration waittime);
+            const void *select_member(tick_timer::duration waittime);
+
+            // used to create static_queue_set
+            queue_set(size_type size, unsigned char *elem_buffer);
+
+        private:
+            bool add(queue *q);
+            bool remove(queue *q);
+        };
+
+        /// @brief  A queue set with statically allocated event storage.
+        /// @tparam MAX_SIZE: the length of the set, the sum of the members' lengths
+        template<const queue::size_type MAX_SIZE>
+        class static_queue_set : public queue_set
+        {
+        public:
+            /// @brief  The length of the set.
+            static constexpr size_type max_size()
+            {
+                return MAX_SIZE;
+            }
+
+            /// @brief  Constructs an empty queue set statically.
+            static_queue_set()
+                : queue_set(max_size(), elem_buffer_)
+            {
+            }
+
+        private:
+            unsigned char elem_buffer_[max_size() * sizeof(void*)];
+        };
+
+    #endif // (configUSE_QUEUE_SETS == 1)
+}
+
+#endif // __FREERTOS_QUEUE_SET_H_
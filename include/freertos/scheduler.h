@@ -57,6 +57,149 @@ namespace freertos
         /// @remark Thread context callable
         static size_t get_threads_count();
 
+        #if (configUSE_TRACE_FACILITY == 1)
+
+            /// @brief  The status of a single thread.
+            struct thread_info
+            {
+                thread *handle;
+                const char *name;
+                thread::id id;
+                thread::state state;
+                /// @brief  The current priority, which is raised by priority inheritance
+                thread::priority priority;
+                /// @brief  The priority assigned to the thread
+                thread::priority base_priority;
+                /// @brief  Minimum of the free stack space so far, in bytes
+                std::size_t stack_free;
+            #if (configGENERATE_RUN_TIME_STATS == 1)
+                /// @brief  Total execution time of the thread
+                runtime_clock::duration run_time;
+            #endif
+            };
+
+            /// @brief  Collects the status of all threads, without allocating memory.
+            /// @param  threads: the array to fill with the per-thread status
+            /// @param  max_threads: the size of the array
+            /// @return The number of threads filled in, 0 if the array is too small
+            /// @note   The scheduler is only suspended while the kernel collects its records,
+            ///         they are converted afterwards. The kernel's records are collected
+            ///         in the same array, so the usable capacity is slightly reduced if those are larger
+            /// @remark Thread context callable
+            static std::size_t snapshot(thread_info *threads, std::size_t max_threads);
+
+            template<std::size_t N>
+            static std::size_t snapshot(thread_info (&threads)[N])
+            {
+                return snapshot(threads, N);
+            }
+
+            /// @brief  A difference of a thread's status between two snapshots.
+            struct thread_change
+            {
+                enum class kind
+                {
+                    created,
+                    deleted,
+                    changed,
+                };
+
+                kind what;
+                /// @brief  The thread's status in the newer snapshot, or in the older one if it's deleted
+                const thread_info *info;
+                /// @brief  The thread's status in the older snapshot, nullptr if it's created
+                const thread_info *previous;
+            #if (configGENERATE_RUN_TIME_STATS == 1)
+                /// @brief  Execution time between the snapshots
+                runtime_clock::duration run_time_delta;
+            #endif
+            };
+
+            /// @brief  Compares two snapshots, listing the created and deleted threads,
+            ///         and the ones whose status changed.
+            /// @param  before: the older snapshot
+            /// @param  before_count: the number of threads in the older snapshot
+            /// @param  after: the newer snapshot
+            /// @param  after_count: the number of threads in the newer snapshot
+            /// @param  changes: the array to fill with the differences (referencing the snapshots)
+            /// @param  max_changes: the size of the array
+            /// @return The number of differences filled in
+            /// @remark Thread and ISR context callable
+            static std::size_t snapshot_diff(const thread_info *before, std::size_t before_count,
+                    const thread_info *after, std::size_t after_count,
+                    thread_change *changes, std::size_t max_changes);
+
+        #endif // (configUSE_TRACE_FACILITY == 1)
+
+        #if (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1)
+
+            /// @brief  Execution statistics of a single thread.
+            struct thread_usage
+            {
+                thread *handle;
+                const char *name;
+                thread::priority priority;
+                /// @brief  Total execution time of the thread
+                runtime_clock::duration run_time;
+                /// @brief  Execution time since the previous snapshot
+                runtime_clock::duration run_time_delta;
+                /// @brief  Number of context switches to the thread (0 without configCONTEXT_SWITCH_COUNTER_INDEX)
+                std::size_t context_switches;
+                /// @brief  Minimum of the free stack space so far, in bytes
+                std::size_t stack_free;
+                /// @brief  CPU usage since the previous snapshot, in 0.1% units of all cores' capacity
+                std::uint16_t usage_permille;
+            };
+
+            /// @brief  Execution statistics of the whole system.
+            struct cpu_usage
+            {
+                /// @brief  Total run time counter, the time reference of the snapshot
+                runtime_clock::duration total_time;
+                /// @brief  Total time spent in the idle thread(s)
+                runtime_clock::duration idle_time;
+                /// @brief  Elapsed time since the previous snapshot
+                runtime_clock::duration elapsed;
+                /// @brief  Idle time since the previous snapshot
+                runtime_clock::duration idle_delta;
+                /// @brief  Number of threads in the snapshot
+                std::size_t threads_count;
+            };
+
+            /// @brief  Collects the execution statistics of all threads, without allocating memory.
+            ///         The usage is calculated relative to the previous snapshot,
+            ///         so alternating between two arrays gives a continuous view.
+            /// @param  threads: the array to fill with the per-thread statistics
+            /// @param  max_threads: the size of the array
+            /// @param  summary: the system statistics, on input it holds the previous snapshot's
+            ///         (zero-initialize it before the first call)
+            /// @param  previous: the previous snapshot's per-thread statistics (can be nullptr)
+            /// @param  previous_count: the number of threads in the previous snapshot
+            /// @return The number of threads filled in, 0 if the array is too small
+            /// @note   The kernel's thread status records are collected in the same array,
+            ///         so the usable capacity is slightly reduced if those are larger
+            /// @remark Thread context callable
+            static std::size_t cpu_usage_snapshot(thread_usage *threads, std::size_t max_threads,
+                    cpu_usage& summary,
+                    const thread_usage *previous = nullptr, std::size_t previous_count = 0);
+
+            /// @brief  Collects the execution statistics of all threads, without allocating memory.
+            /// @param  threads: the array to fill with the per-thread statistics
+            /// @param  summary: the system statistics, on input it holds the previous snapshot's
+            /// @param  previous: the previous snapshot's per-thread statistics
+            /// @param  previous_count: the number of threads in the previous snapshot
+            /// @return The number of threads filled in, 0 if the array is too small
+            /// @remark Thread context callable
+            template<std::size_t N>
+            static std::size_t cpu_usage_snapshot(thread_usage (&threads)[N],
+                    cpu_usage& summary,
+                    const thread_usage *previous = nullptr, std::size_t previous_count = 0)
+            {
+                return cpu_usage_snapshot(threads, N, summary, previous, previous_count);
+            }
+
+        #endif // (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1)
+
         /// @brief  @ref Lockable critical section that manipulates the scheduler's state.
         class critical_section
         {
@@ -71,9 +214,25 @@ namespace freertos
             /// @remark Thread context callable
             void unlock();
 
+        #if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+
+            /// @brief  The profiled call site is where the section is constructed,
+            ///         since lock() is usually called through lock_guard.
+            __attribute__((always_inline)) inline critical_section()
+                : site_(cpu::call_site())
+            {
+            }
+
+        private:
+            const void *const site_;
+
+        #else
+
             constexpr critical_section()
             {
             }
+
+        #endif // (configUSE_CRITICAL_SECTION_PROFILER == 1)
         };
 
     private:
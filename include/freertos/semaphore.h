@@ -83,6 +83,38 @@ namespace freertos
             (void)give(update);
         }
 
+        /// @brief  Tries to take the semaphore if it is available, from thread context.
+        /// @return true if successful, false if the semaphore is unavailable
+        /// @remark Thread context callable
+        inline bool try_acquire(thread_context_t ctx)
+        {
+            return take(ctx, tick_timer::duration(0));
+        }
+
+        /// @brief  Tries to take the semaphore if it is available, from ISR context.
+        /// @return true if successful, false if the semaphore is unavailable
+        /// @remark ISR context callable
+        inline bool try_acquire(isr_context_t ctx)
+        {
+            return take(ctx);
+        }
+
+        /// @brief  Makes the semaphore available a given number of times, from thread context.
+        /// @param  update: the number of available signals to send
+        /// @remark Thread context callable
+        inline void release(thread_context_t ctx, count_type update = 1)
+        {
+            (void)give(ctx, update);
+        }
+
+        /// @brief  Makes the semaphore available a given number of times, from ISR context.
+        /// @param  update: the number of available signals to send
+        /// @remark ISR context callable
+        inline void release(isr_context_t ctx, count_type update = 1)
+        {
+            (void)give(ctx, update);
+        }
+
         /// @brief  Function to observe the semaphore's current acquirable count.
         /// @return The semaphore's acquirable count
         /// @remark Thread and ISR context callable
@@ -96,6 +128,12 @@ namespace freertos
         bool take(tick_timer::duration timeout);
         bool give(count_type update);
 
+        // context specific variants, which skip the context detection
+        bool take(thread_context_t, tick_timer::duration timeout);
+        bool take(isr_context_t);
+        bool give(thread_context_t, count_type update);
+        bool give(isr_context_t, count_type update);
+
         // empty constructor is used by mutexes, since the underlying API create calls differ
         semaphore()
         {
@@ -110,6 +148,9 @@ namespace freertos
             semaphore(count_type max, count_type desired);
 
         #endif // (configUSE_COUNTING_SEMAPHORES == 1)
+
+    private:
+        friend class queue_set;
     };
 
     #if (configUSE_COUNTING_SEMAPHORES == 1)
@@ -151,4 +192,10 @@ namespace freertos
     };
 }
 
+#if (configINLINE_WRAPPERS == 1)
+
+#include "freertos/impl/semaphore.inl"
+
+#endif // (configINLINE_WRAPPERS == 1)
+
 #endif // __FREERTOS_SEMAPHORE_H_
@@ -0,0 +1,181 @@
+/**
+ * @file      stack_monitor.h
+ * @brief     Stack high-water mark monitoring and stack size recommendations
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_STACK_MONITOR_H_
+#define __FREERTOS_STACK_MONITOR_H_
+
+#include "freertos/thread.h"
+#include <type_traits>
+
+namespace freertos
+{
+    #if (configUSE_TRACE_FACILITY == 1) && (INCLUDE_uxTaskGetStackHighWaterMark == 1)
+
+        /// @brief  The non-template part of @ref stack_monitor.
+        class stack_monitor_base
+        {
+        public:
+            /// @brief  The stack usage of a single thread.
+            struct stack_usage
+            {
+                thread *handle;
+                /// @brief  Copy of the thread's name, valid after the thread is deleted
+                char name[thread::NAME_MAX_SIZE + 1];
+                /// @brief  Minimum of the free stack space so far, in bytes
+                std::size_t min_free;
+                /// @brief  The amount of stack that could be removed while keeping the margin, in bytes
+                std::size_t reclaimable;
+                /// @brief  The free stack space is below the margin, the thread is approaching overflow
+                bool at_risk;
+            };
+
+            /// @brief  Discovers all threads, and samples the stack high-water mark of each.
+            ///         Threads that no longer exist are dropped from the monitor.
+            /// @return The number of monitored threads, 0 if the scan failed
+            /// @note   If there are more threads than the monitor's capacity, the scan fails
+            /// @remark Thread context callable
+            std::size_t scan();
+
+            /// @brief  Low overhead sampling, meant to be called from the idle hook
+            ///         (vApplicationIdleHook). Each call samples a single monitored thread,
+            ///         and every full round ends with a @ref scan, so new threads are discovered.
+            /// @note   A thread that is deleted is only dropped by the next scan,
+            ///         call @ref forget before deleting threads that are monitored this way
+            /// @remark Thread context callable
+            void poll();
+
+            /// @brief  Stops monitoring the thread, until the next scan finds it.
+            /// @param  t: the thread to drop
+            /// @remark Thread and ISR context callable
+            void forget(const thread *t);
+
+            /// @brief  Creates the stack usage report of the monitored threads.
+            /// @param  usage: the array to fill
+            /// @param  max_count: the size of the array
+            /// @return The number of threads filled in
+            /// @remark Thread and ISR context callable
+            std::size_t report(stack_usage *usage, std::size_t max_count) const;
+
+            template<std::size_t N>
+            std::size_t report(stack_usage (&usage)[N]) const
+            {
+                return report(usage, N);
+            }
+
+            /// @brief  Copies the sampled minimal free stack sizes of a thread.
+            /// @param  t: the thread to query
+            /// @param  history: the array to fill with the samples in bytes, oldest first
+            /// @param  max_count: the size of the array
+            /// @return The number of samples filled in
+            /// @remark Thread and ISR context callable
+            std::size_t get_history(const thread *t, std::size_t *history, std::size_t max_count) const;
+
+            /// @return true if any of the monitored threads is approaching stack overflow
+            /// @remark Thread and ISR context callable
+            bool any_at_risk() const;
+
+            /// @return The safety margin of free stack space in bytes
+            std::size_t get_margin() const
+            {
+                return margin_;
+            }
+
+            /// @brief  Calculates the stack size of a thread that keeps exactly the margin free,
+            ///         tightening over-provisioned stacks and growing the ones at risk.
+            /// @param  stacksize: the current stack size of the thread in bytes
+            /// @param  usage: the thread's entry from the report
+            /// @return The recommended stack size in bytes
+            std::size_t recommend_stack_size(std::size_t stacksize, const stack_usage& usage) const;
+
+        protected:
+            // an upper bound of the kernel's thread status record size, verified in the source
+            static constexpr std::size_t STATUS_RECORD_SIZE = 16 * sizeof(void*);
+
+            struct entry
+            {
+                thread *handle;
+                char name[thread::NAME_MAX_SIZE + 1];
+                std::size_t min_free;
+                std::size_t samples;
+                bool seen;
+            };
+
+            stack_monitor_base(entry *entries, std::size_t max_threads,
+                    std::size_t *history, std::size_t depth,
+                    void *scratch, std::size_t margin)
+                : entries_(entries), history_(history), scratch_(scratch),
+                  max_threads_(max_threads), depth_(depth), margin_(margin),
+                  count_(0), cursor_(0)
+            {
+            }
+
+        private:
+            entry *find(const thread *t) const;
+            void record(entry *e, std::size_t min_free);
+            void remove(std::size_t index);
+
+            entry *const entries_;
+            std::size_t *const history_;
+            void *const scratch_;
+            const std::size_t max_threads_;
+            const std::size_t depth_;
+            const std::size_t margin_;
+            std::size_t count_;
+            std::size_t cursor_;
+
+            // non-copyable
+            stack_monitor_base(const stack_monitor_base&) = delete;
+            stack_monitor_base& operator=(const stack_monitor_base&) = delete;
+        };
+
+        /// @brief  Samples the stack high-water mark of all threads, keeps their minimal free stack history,
+        ///         flags the threads approaching overflow, and recommends tightened stack sizes.
+        /// @tparam MAX_THREADS: the maximal number of monitored threads
+        /// @tparam HISTORY: the number of samples kept per thread
+        template<const std::size_t MAX_THREADS, const std::size_t HISTORY = 8>
+        class stack_monitor : public stack_monitor_base
+        {
+            static_assert(HISTORY > 0, "At least one sample must be kept.");
+
+        public:
+            /// @brief  Constructs the stack monitor.
+            /// @param  margin: the free stack space in bytes that is kept by the recommendations,
+            ///         threads with less free space are flagged as at risk
+            explicit stack_monitor(std::size_t margin = 64)
+                : stack_monitor_base(entries_, MAX_THREADS, history_[0], HISTORY, &scratch_, margin),
+                  entries_(), history_()
+            {
+            }
+
+        private:
+            entry entries_[MAX_THREADS];
+            std::size_t history_[MAX_THREADS][HISTORY];
+            typename std::aligned_storage<MAX_THREADS * STATUS_RECORD_SIZE, alignof(std::uint64_t)>::type scratch_;
+        };
+
+    #endif // (configUSE_TRACE_FACILITY == 1) && (INCLUDE_uxTaskGetStackHighWaterMark == 1)
+}
+
+#endif // __FREERTOS_STACK_MONITOR_H_
@@ -27,6 +27,7 @@
 #define __FREERTOS_THREAD_H_
 
 #include "freertos/tick_timer.h"
+#include "freertos/cpu.h"
 
 namespace freertos
 {
@@ -38,9 +39,24 @@ namespace freertos
         // these macros may use native type casts, so need some redirection
         constexpr UBaseType_t TOP_PRIORITY = configMAX_PRIORITIES - 1;
         constexpr uint32_t MIN_STACK_SIZE = configMINIMAL_STACK_SIZE;
+        constexpr std::size_t BYTE_ALIGNMENT = portBYTE_ALIGNMENT;
     }
 
-    class condition_flags;
+    #if (configUSE_TASK_NOTIFICATIONS == 1) && !defined(configWAKEUP_NOTIFICATION_INDEX)
+
+        #if (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
+
+            // the task notification (index) that the library's notification based waiting uses,
+            // the last one is taken, as the default thread::notifier uses the first one
+            #define configWAKEUP_NOTIFICATION_INDEX (configTASK_NOTIFICATION_ARRAY_ENTRIES - 1)
+
+        #else
+
+            #error "Increase configTASK_NOTIFICATION_ARRAY_ENTRIES, or define configWAKEUP_NOTIFICATION_INDEX 0 to share the notification with thread::notifier."
+
+        #endif
+
+    #endif
 
     using notify_value = std::uint32_t;
 
@@ -83,12 +99,11 @@ namespace freertos
 
         #endif // (configUSE_TRACE_FACILITY == 1)
 
-        /// @brief  Number of concurrent threads supported.
-        /// @return Fixed to 0 since FreeRTOS doesn't have such limitation by design,
-        ///         only resource constraints apply
+        /// @brief  Number of concurrent threads supported by the hardware.
+        /// @return The number of cores the kernel schedules threads on
         static constexpr unsigned int hardware_concurrency()
         {
-            return 0;
+            return native::NUMBER_OF_CORES;
         }
 
         /// @brief  Signals to the thread's observer that it's being terminated,
@@ -100,14 +115,78 @@ namespace freertos
         #ifdef configTHREAD_EXIT_CONDITION_INDEX
 
         private:
-            condition_flags *get_exit_condition() const;
-            void set_exit_condition(condition_flags *cond);
+            struct join_record;
+
+            join_record *get_join_record() const;
+            static std::uint32_t join_threads(thread *const *threads, std::size_t count,
+                    bool join_all, const tick_timer::duration& rel_time);
 
         public:
             /// @brief  Waits for the thread to finish execution.
             /// @note   May only be called when the thread is joinable, and not from the owned thread's context
             void join();
 
+            /// @brief  Waits for the thread to finish execution, or the timeout to expire.
+            /// @param  rel_time: duration to wait for the thread's exit
+            /// @return true if the thread has exited, false if timed out
+            /// @note   May only be called when the thread is joinable, and not from the owned thread's context
+            bool join_for(const tick_timer::duration& rel_time);
+
+            /// @brief  Waits for the thread to finish execution, or the timeout to expire.
+            /// @param  rel_time: duration to wait for the thread's exit
+            /// @return true if the thread has exited, false if timed out
+            template<class Rep, class Period>
+            bool join_for(const std::chrono::duration<Rep, Period>& rel_time)
+            {
+                return join_for(std::chrono::duration_cast<tick_timer::duration>(rel_time));
+            }
+
+            /// @brief  Waits for any of the threads to finish execution, with a single blocking call.
+            /// @param  threads: the threads to wait for (at most 32), the ones that have
+            ///         already exited (and aren't deleted yet) count as exited immediately
+            /// @param  count: the number of threads
+            /// @param  rel_time: duration to wait for a thread's exit
+            /// @return The index of an exited thread, or count if timed out
+            /// @remark Thread context callable
+            static std::size_t join_any(thread *const *threads, std::size_t count,
+                    const tick_timer::duration& rel_time = infinity);
+
+            /// @brief  Waits for any of the threads to finish execution, with a single blocking call.
+            /// @param  threads: the threads to wait for (at most 32), the ones that have
+            ///         already exited (and aren't deleted yet) count as exited immediately
+            /// @param  rel_time: duration to wait for a thread's exit
+            /// @return The index of an exited thread, or N if timed out
+            /// @remark Thread context callable
+            template<std::size_t N>
+            static std::size_t join_any(thread *const (&threads)[N],
+                    const tick_timer::duration& rel_time = infinity)
+            {
+                return join_any(threads, N, rel_time);
+            }
+
+            /// @brief  Waits for all of the threads to finish execution, with a single blocking call.
+            /// @param  threads: the threads to wait for (at most 32), the ones that have
+            ///         already exited (and aren't deleted yet) count as exited immediately
+            /// @param  count: the number of threads
+            /// @param  rel_time: duration to wait for the threads' exit
+            /// @return true if all threads have exited, false if timed out
+            /// @remark Thread context callable
+            static bool join_all(thread *const *threads, std::size_t count,
+                    const tick_timer::duration& rel_time = infinity);
+
+            /// @brief  Waits for all of the threads to finish execution, with a single blocking call.
+            /// @param  threads: the threads to wait for (at most 32), the ones that have
+            ///         already exited (and aren't deleted yet) count as exited immediately
+            /// @param  rel_time: duration to wait for the threads' exit
+            /// @return true if all threads have exited, false if timed out
+            /// @remark Thread context callable
+            template<std::size_t N>
+            static bool join_all(thread *const (&threads)[N],
+                    const tick_timer::duration& rel_time = infinity)
+            {
+                return join_all(threads, N, rel_time);
+            }
+
             /// @brief  Checks if the thread is joinable (potentially executing).
             /// @return true if the thread is valid and hasn't been joined, false otherwise
             /// @remark Thread and ISR context callable
@@ -151,6 +230,25 @@ namespace freertos
         /// @remark Thread context callable
         state get_state() const;
 
+        #if (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1)
+
+            /// @brief  Reads the total time the thread has been executing for.
+            /// @return The accumulated execution time of the thread
+            /// @remark Thread context callable
+            runtime_clock::duration get_cpu_time() const;
+
+        #endif // (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1)
+
+        #ifdef configCONTEXT_SWITCH_COUNTER_INDEX
+
+            /// @brief  Reads the number of times the thread was switched in by the scheduler.
+            /// @note   Requires traceTASK_SWITCHED_IN to call @ref vTaskSwitchedInHook
+            /// @return The thread's context switch count
+            /// @remark Thread context callable
+            std::size_t get_context_switches() const;
+
+        #endif // configCONTEXT_SWITCH_COUNTER_INDEX
+
         /// @brief  Returns the currently executing thread.
         /// @return Pointer to the currently executing thread
         /// @remark Thread context callable (obviously)
@@ -200,6 +298,20 @@ namespace freertos
         /// @remark Thread context callable
         void set_priority(priority prio);
 
+        /// @brief  Bit mask of the cores a thread may run on, bit 0 corresponding to core 0.
+        using affinity_mask = native::UBaseType_t;
+
+        /// @return The mask of cores the thread is allowed to run on
+        /// @remark Thread context callable
+        affinity_mask get_affinity() const;
+
+        /// @brief  Restricts the thread to run on the selected cores only.
+        ///         On single core builds the mask must contain core 0, and the call has no effect,
+        ///         on SMP builds without configUSE_CORE_AFFINITY the call has no effect.
+        /// @param  cores: mask of the cores the thread is allowed to run on
+        /// @remark Thread context callable
+        void set_affinity(affinity_mask cores);
+
         // use make_thread() instead
         void* operator new(size_t size) = delete;
         void* operator new[](size_t size) = delete;
@@ -268,6 +380,18 @@ namespace freertos
                     last_value_ = clear(~0);
                 }
 
+                // context specific variants, which skip the context detection
+                void signal(thread_context_t);
+                void signal(isr_context_t);
+                void increment(thread_context_t);
+                void increment(isr_context_t);
+                void set_flags(thread_context_t, notify_value flags);
+                void set_flags(isr_context_t, notify_value flags);
+                bool try_set_value(thread_context_t, notify_value new_value);
+                bool try_set_value(isr_context_t, notify_value new_value);
+                void set_value(thread_context_t, notify_value new_value);
+                void set_value(isr_context_t, notify_value new_value);
+
             private:
                 thread *const thread_;
                 notify_value last_value_ = 0;
@@ -284,14 +408,53 @@ namespace freertos
                 }
 
                 bool notify(unsigned action, notify_value value);
+                bool notify(thread_context_t, unsigned action, notify_value value);
+                bool notify(isr_context_t, unsigned action, notify_value value);
                 notify_value clear(notify_value flags);
             };
 
+            /// @brief  Creates a notifier for the notification that is dedicated to
+            ///         the library's notification based blocking (see configWAKEUP_NOTIFICATION_INDEX).
+            /// @return Notifier that can wake the thread from @ref this_thread::wait_wakeup_for
+            notifier get_wakeup_notifier();
+
         #endif // (configUSE_TASK_NOTIFICATIONS == 1)
 
         static constexpr const char* DEFAULT_NAME = "anonym";
         static constexpr size_t DEFAULT_STACK_SIZE = native::MIN_STACK_SIZE * sizeof(native::StackType_t);
 
+        #ifdef configTHREAD_ALLOCATOR_INDEX
+
+            /// @brief  The function that returns a thread's memory block to its allocator.
+            using deallocator = void (*)(void *allocator, void *block, std::size_t size);
+
+            /// @brief  Calculates the size of the single memory block that holds a thread and its stack.
+            /// @param  stacksize: size of the thread's stack in bytes
+            /// @return The required block size in bytes
+            static constexpr std::size_t allocation_size(std::size_t stacksize)
+            {
+                return BLOCK_HEADER_SIZE + align(sizeof(native::StaticTask_t))
+                        + align(stacksize);
+            }
+
+            /// @brief  Creates a thread in a single memory block, which is returned to
+            ///         the allocator when the thread is deleted. Use make_thread(allocator, ...) instead.
+            static thread *construct(void *block, std::size_t size,
+                    deallocator dealloc, void *allocator,
+                    function func, void *param, std::size_t stacksize,
+                    priority prio, const char *name);
+
+        private:
+            static constexpr std::size_t align(std::size_t size)
+            {
+                return (size + native::BYTE_ALIGNMENT - 1) / native::BYTE_ALIGNMENT * native::BYTE_ALIGNMENT;
+            }
+            static constexpr std::size_t BLOCK_HEADER_SIZE = (5 * sizeof(void*) + native::BYTE_ALIGNMENT - 1)
+                    / native::BYTE_ALIGNMENT * native::BYTE_ALIGNMENT;
+
+        public:
+        #endif // configTHREAD_ALLOCATOR_INDEX
+
     protected:
         thread(native::StackType_t *pstack, std::uint32_t stack_size,
                 function func, void *param,
@@ -376,6 +539,57 @@ namespace freertos
 
     #endif // (configSUPPORT_DYNAMIC_ALLOCATION == 1)
 
+    #ifdef configTHREAD_ALLOCATOR_INDEX
+
+        template<class Allocator>
+        void deallocate_thread_block(void *allocator, void *block, std::size_t size)
+        {
+            static_cast<Allocator*>(allocator)->deallocate(block, size);
+        }
+
+        /// @brief  Creates a new thread in a single memory block (control block and stack together)
+        ///         obtained from the allocator, and returns the block to it when the thread is deleted.
+        ///         The thread becomes ready to execute within this call, meaning that it might
+        ///         have started running by the time this call returns.
+        /// @param  alloc:     the allocator, providing void* allocate(std::size_t size)
+        ///                    and void deallocate(void *block, std::size_t size)
+        /// @param  func:      the function to execute in the thread context
+        /// @param  param:     opaque parameter to pass to the thread function
+        /// @param  stacksize: size of the thread's stack in bytes
+        /// @param  prio:      thread priority level
+        /// @param  name:      short label for identifying the thread
+        /// @return pointer to the newly created thread, or nullptr if allocation failed
+        /// @note   The block is freed from the idle thread (or the deleting thread's context)
+        ///         after the kernel has cleaned up the thread, so the allocator must be thread-safe.
+        template<class Allocator>
+        thread* make_thread(Allocator& alloc, thread::function func, void *param,
+                size_t stacksize        = thread::DEFAULT_STACK_SIZE,
+                thread::priority prio   = thread::priority(),
+                const char *name        = thread::DEFAULT_NAME)
+        {
+            const std::size_t size = thread::allocation_size(stacksize);
+            void *block = alloc.allocate(size);
+            if (block == nullptr)
+            {
+                return nullptr;
+            }
+            return thread::construct(block, size, &deallocate_thread_block<Allocator>,
+                    static_cast<void*>(&alloc), func, param, stacksize, prio, name);
+        }
+
+        template<class Allocator, typename T>
+        thread* make_thread(Allocator& alloc, void (*func)(T*), T* arg,
+                size_t stacksize        = thread::DEFAULT_STACK_SIZE,
+                thread::priority prio   = thread::priority(),
+                const char *name        = thread::DEFAULT_NAME)
+        {
+            return make_thread(alloc, reinterpret_cast<thread::function>(func),
+                    reinterpret_cast<void*>(arg),
+                    stacksize, prio, name);
+        }
+
+    #endif // configTHREAD_ALLOCATOR_INDEX
+
     /// @brief  A thread with statically allocated stack.
     template <const std::size_t STACK_SIZE_BYTES>
     class static_thread : public thread
@@ -438,6 +652,57 @@ namespace freertos
         native::StackType_t stack_[STACK_SIZE_BYTES / sizeof(native::StackType_t)];
     };
 
+    /// @brief  Stack storage for a @ref placed_thread, define it separately from the thread
+    ///         to control its placement (e.g. with FREERTOS_PLACE_IN).
+    template <const std::size_t STACK_SIZE_BYTES>
+    struct thread_stack
+    {
+        static constexpr std::size_t STACK_SIZE = STACK_SIZE_BYTES;
+
+        native::StackType_t words[STACK_SIZE_BYTES / sizeof(native::StackType_t)];
+    };
+
+    /// @brief  A thread whose stack is provided by the user as a separate object,
+    ///         so the control block (the thread object itself) and the stack
+    ///         can be placed in different memory regions.
+    class placed_thread : public thread
+    {
+    public:
+        /// @brief  Constructs a thread on the provided stack. The thread becomes ready to execute
+        ///         within this call, meaning that it might have started running
+        ///         by the time this call returns.
+        /// @param  stack:     the stack storage of the thread, which must outlive the thread
+        /// @param  func:      the function to execute in the thread context
+        /// @param  param:     opaque parameter to pass to the thread function
+        /// @param  prio:      thread priority level
+        /// @param  name:      short label for identifying the thread
+        template <const std::size_t STACK_SIZE_BYTES>
+        placed_thread(thread_stack<STACK_SIZE_BYTES>& stack, function func, void *param,
+                priority prio = priority(), const char *name = DEFAULT_NAME)
+            : thread(stack.words, sizeof(stack.words) / sizeof(stack.words[0]),
+                    func, param, prio, name)
+        {
+        }
+
+        template <const std::size_t STACK_SIZE_BYTES, typename T>
+        placed_thread(thread_stack<STACK_SIZE_BYTES>& stack, void (*func)(T*), T* arg,
+                priority prio = priority(), const char *name = DEFAULT_NAME)
+            : placed_thread(stack, reinterpret_cast<function>(func),
+                    reinterpret_cast<void*>(arg),
+                    prio, name)
+        {
+        }
+
+        template <const std::size_t STACK_SIZE_BYTES, class T>
+        placed_thread(thread_stack<STACK_SIZE_BYTES>& stack, T& obj, void (T::*member_func)(),
+                priority prio = priority(), const char *name = DEFAULT_NAME)
+            : placed_thread(stack, reinterpret_cast<function>(member_func),
+                    reinterpret_cast<void*>(&obj),
+                    prio, name)
+        {
+        }
+    };
+
 
     /// @brief  Namespace offering control on the current thread of execution.
     namespace this_thread
@@ -450,6 +715,14 @@ namespace freertos
         /// @return The current thread's unique identifier
         thread::id get_id();
 
+        #if (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1)
+
+            /// @brief  Reads the total time the current thread has been executing for.
+            /// @return The accumulated execution time of the current thread
+            runtime_clock::duration get_cpu_time();
+
+        #endif // (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1)
+
         void sleep_for(tick_timer::duration rel_time);
 
         /// @brief  Blocks the current thread's execution for a given duration.
@@ -462,7 +735,31 @@ namespace freertos
             ticks_sleep_for(std::chrono::duration_cast<tick_timer::duration>(rel_time));
         }
 
+        /// @brief  Blocks the current thread's execution until the given tick count.
+        ///         The deadline is absolute, so periodic wakeups calculated as
+        ///         a multiple of the period don't accumulate drift.
+        /// @param  abs_time: deadline to block the current thread,
+        ///         the call returns immediately if it has already passed
+        void sleep_until(const tick_timer::time_point& abs_time);
+
+        /// @brief  Blocks the current thread's execution until the given tick count.
+        ///         The deadline is rounded up to a whole tick, and it's kept absolute.
+        /// @param  abs_time: deadline to block the current thread
+        template<class Duration>
+        inline void sleep_until(const std::chrono::time_point<tick_timer, Duration>& abs_time)
+        {
+            auto ticks = std::chrono::time_point_cast<tick_timer::duration>(abs_time);
+            if (ticks < abs_time)
+            {
+                ticks += tick_timer::duration(1);
+            }
+            // workaround to prevent this function calling itself
+            const auto ticks_sleep_until = static_cast<void (*)(const tick_timer::time_point&)>(&sleep_until);
+            ticks_sleep_until(ticks);
+        }
+
         /// @brief  Blocks the current thread's execution until the given deadline.
+        ///         Other clocks' deadlines are converted to a relative delay.
         /// @param  abs_time: deadline to block the current thread
         template<class Clock, class Duration>
         inline void sleep_until(const std::chrono::time_point<Clock, Duration>& abs_time)
@@ -495,6 +792,11 @@ namespace freertos
             notify_value try_acquire_notification_for(const tick_timer::duration& rel_time,
                     bool acquire_single = false);
 
+            /// @brief  Wait for a @ref thread::get_wakeup_notifier signal to the current thread.
+            /// @param  rel_time: maximum duration to wait for the signal
+            /// @return true if a signal was received, false if timed out
+            bool wait_wakeup_for(const tick_timer::duration& rel_time);
+
             #if (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
 
                 /// @brief  Wait for a notifier to signal the current thread.
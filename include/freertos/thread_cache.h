@@ -0,0 +1,142 @@
+/**
+ * @file      thread_cache.h
+ * @brief     Cache of recyclable dynamically allocated threads
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_THREAD_CACHE_H_
+#define __FREERTOS_THREAD_CACHE_H_
+
+#include "freertos/thread.h"
+
+namespace freertos
+{
+    #if (configSUPPORT_DYNAMIC_ALLOCATION == 1) && (configUSE_TASK_NOTIFICATIONS == 1)
+
+        /// @brief  The non-template part of @ref thread_cache.
+        class thread_cache_base
+        {
+        public:
+            /// @brief  Usage statistics of the cache.
+            struct statistics
+            {
+                /// @brief  Number of threads created
+                std::size_t created;
+                /// @brief  Number of spawns served by a parked thread
+                std::size_t reused;
+                /// @brief  Number of spawns that failed due to no available thread
+                std::size_t failed;
+            };
+
+            /// @brief  Executes the function in a parked thread that has at least the requested
+            ///         stack size, or creates a new thread if there is none.
+            /// @param  func:      the function to execute
+            /// @param  param:     opaque parameter to pass to the function
+            /// @param  stacksize: the minimal stack size of the thread in bytes
+            /// @param  prio:      thread priority level
+            /// @param  name:      short label for identifying the thread (only used when it's created)
+            /// @return The thread executing the function, or nullptr if no thread is available
+            /// @note   The function's thread must not be joined or deleted, when the function
+            ///         returns the thread parks in the cache instead of terminating.
+            /// @remark Thread context callable
+            thread *spawn(thread::function func, void *param,
+                    std::size_t stacksize   = thread::DEFAULT_STACK_SIZE,
+                    thread::priority prio   = thread::priority(),
+                    const char *name        = thread::DEFAULT_NAME);
+
+            template<typename T>
+            thread *spawn(void (*func)(T*), T *arg,
+                    std::size_t stacksize   = thread::DEFAULT_STACK_SIZE,
+                    thread::priority prio   = thread::priority(),
+                    const char *name        = thread::DEFAULT_NAME)
+            {
+                return spawn(reinterpret_cast<thread::function>(func),
+                        reinterpret_cast<void*>(arg), stacksize, prio, name);
+            }
+
+            /// @brief  Deletes parked threads, freeing their memory.
+            /// @param  keep: the number of parked threads to keep
+            /// @return The number of deleted threads
+            /// @remark Thread context callable
+            std::size_t trim(std::size_t keep = 0);
+
+            /// @return The number of threads that are waiting for work
+            /// @remark Thread and ISR context callable
+            std::size_t get_parked_count() const;
+
+            /// @return The usage statistics of the cache
+            /// @remark Thread and ISR context callable
+            statistics get_statistics() const;
+
+        protected:
+            struct entry
+            {
+                thread *handle;
+                std::size_t stacksize;
+                thread::function func;
+                void *param;
+                bool busy;
+            };
+
+            thread_cache_base(entry *entries, std::size_t count)
+                : entries_(entries), count_(count), stats_()
+            {
+            }
+
+            ~thread_cache_base()
+            {
+                (void)trim(0);
+            }
+
+        private:
+            static void work(entry *e);
+
+            entry *const entries_;
+            const std::size_t count_;
+            statistics stats_;
+
+            // non-copyable
+            thread_cache_base(const thread_cache_base&) = delete;
+            thread_cache_base& operator=(const thread_cache_base&) = delete;
+        };
+
+        /// @brief  Recycles dynamically allocated threads: a thread whose function returned
+        ///         is parked instead of deleted, and a later @ref spawn reuses it,
+        ///         avoiding the heap churn and the creation cost of short-lived threads.
+        /// @tparam MAX_THREADS: the maximal number of threads that the cache manages
+        template<const std::size_t MAX_THREADS>
+        class thread_cache : public thread_cache_base
+        {
+        public:
+            thread_cache()
+                : thread_cache_base(entries_, MAX_THREADS), entries_()
+            {
+            }
+
+        private:
+            entry entries_[MAX_THREADS];
+        };
+
+    #endif // (configSUPPORT_DYNAMIC_ALLOCATION == 1) && (configUSE_TASK_NOTIFICATIONS == 1)
+}
+
+#endif // __FREERTOS_THREAD_CACHE_H_
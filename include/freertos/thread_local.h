@@ -0,0 +1,212 @@
+/**
+ * @file      thread_local.h
+ * @brief     Typed thread-local storage slots built on the FreeRTOS TLS pointers
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_THREAD_LOCAL_H_
+#define __FREERTOS_THREAD_LOCAL_H_
+
+#include "freertos/thread.h"
+
+namespace freertos
+{
+    #if (configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0)
+
+        /// @brief  Allocator of the thread local storage pointer slots, that is
+        ///         the non-template part of @ref thread_local_ptr.
+        ///         The slots used by this library (e.g. configTHREAD_EXIT_CONDITION_INDEX)
+        ///         are never handed out.
+        class thread_local_storage
+        {
+        public:
+            using index_type = native::BaseType_t;
+            using destructor = void (*)(void*);
+
+            static constexpr index_type SLOTS = configNUM_THREAD_LOCAL_STORAGE_POINTERS;
+            static constexpr index_type INVALID_INDEX = -1;
+
+            /// @brief  Allocates a free slot.
+            /// @param  dtor: the function to call on the slot's non-null value
+            ///         when a thread exits (can be nullptr)
+            /// @return The allocated slot's index, or INVALID_INDEX if all slots are in use
+            /// @remark Thread context callable
+            static index_type allocate(destructor dtor = nullptr);
+
+            /// @brief  Allocates a specific slot.
+            /// @param  index: the slot to allocate
+            /// @param  dtor: the function to call on the slot's non-null value
+            ///         when a thread exits (can be nullptr)
+            /// @return true if the slot was free and is now allocated, false otherwise
+            /// @remark Thread context callable
+            static bool allocate(index_type index, destructor dtor = nullptr);
+
+            /// @brief  Frees a previously allocated slot. The values stored by
+            ///         the threads are not destroyed.
+            /// @param  index: the slot to free
+            /// @remark Thread context callable
+            static void release(index_type index);
+
+            /// @brief  Reads the current thread's value in the slot.
+            /// @remark Thread context callable
+            static void *get(index_type index);
+
+            /// @brief  Reads a thread's value in the slot.
+            /// @remark Thread context callable
+            static void *get(const thread& t, index_type index);
+
+            /// @brief  Sets the current thread's value in the slot.
+            /// @remark Thread context callable
+            static void set(index_type index, void *value);
+
+            /// @brief  Sets a thread's value in the slot.
+            /// @remark Thread context callable
+            static void set(thread& t, index_type index, void *value);
+
+            /// @brief  Calls the slot destructors on the current thread's values,
+            ///         called when a thread function returns.
+            static void destroy_all();
+
+        private:
+            thread_local_storage();
+        };
+
+        /// @brief  A typed thread local pointer, each thread having its own value,
+        ///         stored in a FreeRTOS thread local storage pointer slot.
+        ///         The slot is allocated at construction, and freed at destruction,
+        ///         the access is a constant-time array lookup in the thread's control block.
+        /// @tparam T: the pointed type
+        /// @note   The destructor callback is called when the thread function returns,
+        ///         threads that are deleted externally don't invoke it.
+        template<typename T>
+        class thread_local_ptr
+        {
+        public:
+            using index_type = thread_local_storage::index_type;
+            using destructor = void (*)(T*);
+
+            /// @brief  Constructs the pointer in the first free slot.
+            /// @param  dtor: the function to call on the threads' non-null values
+            ///         when they exit (can be nullptr)
+            /// @remark Thread context callable
+            explicit thread_local_ptr(destructor dtor = nullptr)
+                : index_(thread_local_storage::allocate(reinterpret_cast<thread_local_storage::destructor>(dtor)))
+            {
+            }
+
+            /// @brief  Constructs the pointer in a fixed slot.
+            /// @param  index: the slot to use, it must be free
+            /// @param  dtor: the function to call on the threads' non-null values
+            ///         when they exit (can be nullptr)
+            /// @remark Thread context callable
+            thread_local_ptr(index_type index, destructor dtor)
+                : index_(thread_local_storage::allocate(index,
+                        reinterpret_cast<thread_local_storage::destructor>(dtor)) ? index : INVALID_INDEX)
+            {
+            }
+
+            /// @brief  Frees the slot. The values of the threads aren't destroyed.
+            ~thread_local_ptr()
+            {
+                if (valid())
+                {
+                    thread_local_storage::release(index_);
+                }
+            }
+
+            /// @return true if a slot was successfully allocated for the pointer
+            bool valid() const
+            {
+                return index_ != INVALID_INDEX;
+            }
+
+            /// @return The slot index of the pointer
+            index_type index() const
+            {
+                return index_;
+            }
+
+            /// @return The current thread's pointer value
+            /// @remark Thread context callable
+            T *get() const
+            {
+                return static_cast<T*>(thread_local_storage::get(index_));
+            }
+
+            /// @return The selected thread's pointer value
+            /// @remark Thread context callable
+            T *get(const thread& t) const
+            {
+                return static_cast<T*>(thread_local_storage::get(t, index_));
+            }
+
+            /// @brief  Sets the current thread's pointer value.
+            /// @remark Thread context callable
+            void set(T *value)
+            {
+                thread_local_storage::set(index_, static_cast<void*>(value));
+            }
+
+            /// @brief  Sets the selected thread's pointer value.
+            /// @remark Thread context callable
+            void set(thread& t, T *value)
+            {
+                thread_local_storage::set(t, index_, static_cast<void*>(value));
+            }
+
+            /// @brief  Clears the current thread's pointer value, without destroying it.
+            /// @return The previous pointer value
+            /// @remark Thread context callable
+            T *release()
+            {
+                T *value = get();
+                set(nullptr);
+                return value;
+            }
+
+            T *operator->() const
+            {
+                return get();
+            }
+            T& operator*() const
+            {
+                return *get();
+            }
+            explicit operator bool() const
+            {
+                return get() != nullptr;
+            }
+
+        private:
+            static constexpr index_type INVALID_INDEX = thread_local_storage::INVALID_INDEX;
+
+            const index_type index_;
+
+            // non-copyable
+            thread_local_ptr(const thread_local_ptr&) = delete;
+            thread_local_ptr& operator=(const thread_local_ptr&) = delete;
+        };
+
+    #endif // (configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0)
+}
+
+#endif // __FREERTOS_THREAD_LOCAL_H_
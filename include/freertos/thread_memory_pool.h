@@ -0,0 +1,115 @@
+/**
+ * @file      thread_memory_pool.h
+ * @brief     Fixed block pool for single allocation threads
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_THREAD_MEMORY_POOL_H_
+#define __FREERTOS_THREAD_MEMORY_POOL_H_
+
+#include "freertos/thread.h"
+#include <type_traits>
+
+#ifdef configTHREAD_ALLOCATOR_INDEX
+
+namespace freertos
+{
+    /// @brief  The non-template part of @ref thread_memory_pool, manages the free blocks.
+    class thread_memory_pool_base
+    {
+    public:
+        /// @brief  Takes a free block from the pool.
+        /// @param  size: the requested size in bytes
+        /// @return The free block, or nullptr if the pool is exhausted or the block size is too small
+        /// @remark Thread and ISR context callable
+        void *allocate(std::size_t size);
+
+        /// @brief  Returns a block to the pool.
+        /// @param  block: the block previously obtained by allocate()
+        /// @param  size: the size of the block
+        /// @remark Thread and ISR context callable
+        void deallocate(void *block, std::size_t size);
+
+        /// @return The number of free blocks in the pool
+        /// @remark Thread and ISR context callable
+        std::size_t get_free_count() const;
+
+        /// @return The size of a single block in bytes
+        std::size_t get_block_size() const
+        {
+            return block_size_;
+        }
+
+    protected:
+        thread_memory_pool_base(void *blocks, std::size_t block_size, std::size_t count);
+
+    private:
+        struct free_block
+        {
+            free_block *next;
+        };
+
+        free_block *free_list_;
+        const std::size_t block_size_;
+
+        // non-copyable
+        thread_memory_pool_base(const thread_memory_pool_base&) = delete;
+        thread_memory_pool_base& operator=(const thread_memory_pool_base&) = delete;
+    };
+
+    /// @brief  A fixed number of memory blocks, each holding a thread's control block and stack,
+    ///         to be used with make_thread(allocator, ...). Threads created from the pool
+    ///         return their block automatically when they are deleted.
+    /// @tparam STACK_SIZE: the stack size of each thread in bytes
+    /// @tparam COUNT: the number of threads the pool can hold at the same time
+    template<const std::size_t STACK_SIZE, const std::size_t COUNT>
+    class thread_memory_pool : public thread_memory_pool_base
+    {
+    public:
+        static constexpr std::size_t BLOCK_SIZE = thread::allocation_size(STACK_SIZE);
+
+        thread_memory_pool()
+            : thread_memory_pool_base(blocks_, BLOCK_SIZE, COUNT)
+        {
+        }
+
+        /// @brief  Creates a new thread from the pool's memory.
+        /// @param  func:  the function to execute in the thread context
+        /// @param  param: opaque parameter to pass to the thread function
+        /// @param  prio:  thread priority level
+        /// @param  name:  short label for identifying the thread
+        /// @return pointer to the newly created thread, or nullptr if the pool is exhausted
+        thread *make_thread(thread::function func, void *param,
+                thread::priority prio   = thread::priority(),
+                const char *name        = thread::DEFAULT_NAME)
+        {
+            return freertos::make_thread(*this, func, param, STACK_SIZE, prio, name);
+        }
+
+    private:
+        typename std::aligned_storage<BLOCK_SIZE, native::BYTE_ALIGNMENT>::type blocks_[COUNT];
+    };
+}
+
+#endif // configTHREAD_ALLOCATOR_INDEX
+
+#endif // __FREERTOS_THREAD_MEMORY_POOL_H_
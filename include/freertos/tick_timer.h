@@ -29,6 +29,7 @@
 #include <cstdint>
 #include <cstddef>
 #include <chrono>
+#include "freertos/cpu.h"
 
 namespace freertos
 {
@@ -55,8 +56,55 @@ namespace freertos
         /// @return The current tick count as time_point
         /// @remark Thread and ISR context callable
         static time_point now();
+
+        /// @brief  Wraps the current OS tick count into a clock time point, from thread context.
+        /// @return The current tick count as time_point
+        /// @remark Thread context callable
+        static time_point now(thread_context_t);
+
+        /// @brief  Wraps the current OS tick count into a clock time point, from ISR context.
+        /// @return The current tick count as time_point
+        /// @remark ISR context callable
+        static time_point now(isr_context_t);
     };
 
+    #if (configGENERATE_RUN_TIME_STATS == 1)
+
+        #ifndef configRUN_TIME_COUNTER_RATE_HZ
+        #define configRUN_TIME_COUNTER_RATE_HZ          (configTICK_RATE_HZ * 100)
+        #endif
+
+        namespace native
+        {
+            #ifdef configRUN_TIME_COUNTER_TYPE
+                using run_time_counter = configRUN_TIME_COUNTER_TYPE;
+            #else
+                using run_time_counter = uint32_t;
+            #endif
+
+            constexpr run_time_counter run_time_rate_Hz = configRUN_TIME_COUNTER_RATE_HZ;
+        }
+
+        /// @brief  A @ref TrivialClock class that wraps the run time statistics counter
+        ///         (see configGENERATE_RUN_TIME_STATS), with the counter frequency
+        ///         set by configRUN_TIME_COUNTER_RATE_HZ.
+        class runtime_clock
+        {
+        public:
+            using rep                       = native::run_time_counter;
+            using period                    = std::ratio<1, native::run_time_rate_Hz>;
+            using duration                  = std::chrono::duration<rep, period>;
+            using time_point                = std::chrono::time_point<runtime_clock>;
+            static constexpr bool is_steady = true;
+
+            /// @brief  Wraps the current run time counter into a clock time point.
+            /// @return The current run time counter as time_point
+            /// @remark Thread and ISR context callable
+            static time_point now();
+        };
+
+    #endif // (configGENERATE_RUN_TIME_STATS == 1)
+
     /// @brief  Converts a duration to the underlying tick count.
     /// @param  rel_time: time duration
     /// @return Tick count
@@ -79,4 +127,10 @@ namespace freertos
     constexpr tick_timer::duration infinity { native::infinite_delay };
 }
 
+#if (configINLINE_WRAPPERS == 1)
+
+#include "freertos/impl/tick_timer.inl"
+
+#endif // (configINLINE_WRAPPERS == 1)
+
 #endif // __FREERTOS_TICK_TIMER_H_
@@ -0,0 +1,96 @@
+/**
+ * @file      trace_hooks.h
+ * @brief     FreeRTOS trace macro definitions for the trace recorder
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_TRACE_HOOKS_H_
+#define __FREERTOS_TRACE_HOOKS_H_
+
+/* This header is included at the end of FreeRTOSConfig.h (and compiled as C by the kernel sources),
+ * it redirects the kernel's trace macros to the trace recorder (see freertos/trace_recorder.h).
+ * The hooks receive the kernel's own object pointers, which are the same as the C++ objects' addresses.
+ * traceTASK_SWITCHED_IN() is taken over (a previous definition, e.g. the context switch counter's
+ * vTaskSwitchedInHook(), is replaced), the recorder also counts the context switches
+ * when configCONTEXT_SWITCH_COUNTER_INDEX is defined. */
+#if (configUSE_TRACE_RECORDER == 1)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void vTraceTaskSwitchedIn(void *pxTCB);
+void vTraceTaskSwitchedOut(void *pxTCB);
+void vTraceTaskCreate(void *pxTCB);
+void vTraceTaskDelete(void *pxTCB);
+void vTraceTaskReady(void *pxTCB);
+void vTraceTaskDelay(void);
+void vTraceTaskNotify(void *pxTCB);
+void vTraceTaskNotifyWait(void);
+void vTraceQueueBlocking(unsigned char ucEvent, void *pxQueue);
+void vTraceQueueEvent(unsigned char ucEvent, void *pxQueue);
+void vTraceIsrEnter(unsigned short usIrq);
+void vTraceIsrExit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* the values match freertos::trace_recorder::event */
+#define TRACE_EVENT_BLOCK_RECEIVE   8
+#define TRACE_EVENT_BLOCK_SEND      9
+#define TRACE_EVENT_BLOCK_PEEK      10
+#define TRACE_EVENT_QUEUE_SEND      11
+#define TRACE_EVENT_QUEUE_RECEIVE   12
+
+#undef traceTASK_SWITCHED_IN
+#define traceTASK_SWITCHED_IN()                     vTraceTaskSwitchedIn((void*)pxCurrentTCB)
+#define traceTASK_SWITCHED_OUT()                    vTraceTaskSwitchedOut((void*)pxCurrentTCB)
+#define traceTASK_CREATE(pxNewTCB)                  vTraceTaskCreate((void*)(pxNewTCB))
+#define traceTASK_DELETE(pxTCB)                     vTraceTaskDelete((void*)(pxTCB))
+#define traceMOVED_TASK_TO_READY_STATE(pxTCB)       vTraceTaskReady((void*)(pxTCB))
+#define traceTASK_DELAY()                           vTraceTaskDelay()
+#define traceTASK_DELAY_UNTIL(xTimeToWake)          vTraceTaskDelay()
+
+/* the notification macros have gained an index parameter in FreeRTOS 10.4 */
+#define traceTASK_NOTIFY(...)                       vTraceTaskNotify((void*)pxTCB)
+#define traceTASK_NOTIFY_FROM_ISR(...)              vTraceTaskNotify((void*)pxTCB)
+#define traceTASK_NOTIFY_GIVE_FROM_ISR(...)         vTraceTaskNotify((void*)pxTCB)
+#define traceTASK_NOTIFY_WAIT_BLOCK(...)            vTraceTaskNotifyWait()
+#define traceTASK_NOTIFY_TAKE_BLOCK(...)            vTraceTaskNotifyWait()
+
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue)     vTraceQueueBlocking(TRACE_EVENT_BLOCK_RECEIVE, (void*)(pxQueue))
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue)        vTraceQueueBlocking(TRACE_EVENT_BLOCK_SEND, (void*)(pxQueue))
+#define traceBLOCKING_ON_QUEUE_PEEK(pxQueue)        vTraceQueueBlocking(TRACE_EVENT_BLOCK_PEEK, (void*)(pxQueue))
+#define traceQUEUE_SEND(pxQueue)                    vTraceQueueEvent(TRACE_EVENT_QUEUE_SEND, (void*)(pxQueue))
+#define traceQUEUE_SEND_FROM_ISR(pxQueue)           vTraceQueueEvent(TRACE_EVENT_QUEUE_SEND, (void*)(pxQueue))
+#define traceQUEUE_RECEIVE(pxQueue)                 vTraceQueueEvent(TRACE_EVENT_QUEUE_RECEIVE, (void*)(pxQueue))
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue)        vTraceQueueEvent(TRACE_EVENT_QUEUE_RECEIVE, (void*)(pxQueue))
+
+/* only some ports provide these, otherwise call vTraceIsrEnter() and vTraceIsrExit() in the ISRs */
+#define traceISR_ENTER()                            vTraceIsrEnter(0)
+#define traceISR_EXIT()                             vTraceIsrExit()
+#define traceISR_EXIT_TO_SCHEDULER()                vTraceIsrExit()
+
+#endif /* (configUSE_TRACE_RECORDER == 1) */
+
+#endif /* __FREERTOS_TRACE_HOOKS_H_ */
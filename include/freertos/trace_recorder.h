@@ -0,0 +1,224 @@
+/**
+ * @file      trace_recorder.h
+ * @brief     Binary scheduler trace recorder
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_TRACE_RECORDER_H_
+#define __FREERTOS_TRACE_RECORDER_H_
+
+#include "freertos/cpu.h"
+
+namespace freertos
+{
+    /// @brief  Static class that records the scheduling events (context switches, blocking and
+    ///         unblocking per object, ISR entries) and the wrapper API calls as compact binary events
+    ///         into a lock-free RAM ring. The kernel's trace macros are redirected to the recorder
+    ///         by including freertos/trace_hooks.h at the end of FreeRTOSConfig.h.
+    ///         The binary output is converted to Chrome trace JSON by tools/trace2chrome.py.
+    class trace_recorder
+    {
+    public:
+        /// @brief  The wrapper API calls that are recorded.
+        enum class api : std::uint16_t
+        {
+            queue_push_front = 0,
+            queue_push_back,
+            queue_pop_front,
+            semaphore_acquire,
+            semaphore_release,
+            thread_notify,
+        };
+
+        /// @brief  Records a wrapper API call, compiled out when the recorder is disabled.
+        /// @param  id: the called API
+        /// @param  object: the object whose method is called
+        /// @remark Thread and ISR context callable
+        static void api_call(api id, const void *object)
+        {
+        #if (configUSE_TRACE_RECORDER == 1)
+            record(event::api_call, object, static_cast<std::uint16_t>(id));
+        #else
+            (void)id;
+            (void)object;
+        #endif
+        }
+
+    #if (configUSE_TRACE_RECORDER == 1)
+
+        /// @brief  The types of recorded events.
+        enum class event : std::uint8_t
+        {
+            none = 0,
+            task_switched_in,
+            task_switched_out,
+            task_create,
+            task_delete,
+            task_ready,
+            task_delay,
+            task_notify_wait,
+            block_receive,
+            block_send,
+            block_peek,
+            queue_send,
+            queue_receive,
+            task_notify,
+            isr_enter,
+            isr_exit,
+            api_call,
+            user,
+            /// @brief  Names the object, followed by name_chars events holding the info (length) characters
+            name,
+            name_chars,
+        };
+
+        /// @brief  A single recorded event.
+        struct trace_event
+        {
+            /// @brief  Lower 32 bits of the timestamp counter
+            std::uint32_t timestamp;
+            event type;
+            std::uint8_t core;
+            /// @brief  Event specific value (e.g. IRQ number, API identifier)
+            std::uint16_t info;
+            /// @brief  The address of the subject thread or kernel object
+            std::uintptr_t object;
+        };
+
+        /// @brief  The header of the binary trace output.
+        struct trace_header
+        {
+            char magic[4];
+            std::uint8_t version;
+            std::uint8_t event_size;
+            std::uint8_t pointer_size;
+            std::uint8_t cores;
+            std::uint32_t timestamp_rate_Hz;
+            std::uint32_t dropped;
+        };
+
+        /// @brief  Recording modes.
+        enum class mode
+        {
+            /// @brief  The oldest events are overwritten, the ring holds the latest history
+            ring,
+            /// @brief  The newest events are dropped when the ring is full,
+            ///         the events are consumed by @ref read (e.g. streamed to a file)
+            streaming,
+        };
+
+        /// @brief  Starts (or continues) recording in the selected mode. Recording starts
+        ///         in ring mode at power-up, so thread creations are captured.
+        /// @param  m: the recording mode
+        /// @remark Thread and ISR context callable
+        static void start(mode m = mode::ring);
+
+        /// @brief  Stops recording, so the ring contents can be read consistently.
+        /// @remark Thread and ISR context callable
+        static void stop();
+
+        /// @return true if events are currently recorded
+        static bool is_recording();
+
+        /// @brief  Discards all recorded events.
+        /// @remark Thread and ISR context callable
+        static void clear();
+
+        /// @brief  Records an event.
+        /// @param  type: the event type
+        /// @param  object: the subject of the event
+        /// @param  info: event specific value
+        /// @remark Thread and ISR context callable
+        static void record(event type, const void *object, std::uint16_t info = 0);
+
+        /// @brief  Records an application defined event.
+        /// @param  id: application defined identifier
+        /// @param  object: the subject of the event
+        /// @remark Thread and ISR context callable
+        static void user_event(std::uint16_t id, const void *object = nullptr)
+        {
+            record(event::user, object, id);
+        }
+
+        /// @brief  Assigns a name to an object (e.g. a queue) in the trace.
+        ///         Threads are named automatically when they are created.
+        /// @param  object: the object to name
+        /// @param  name: the name of the object (truncated to 64 characters)
+        /// @remark Thread and ISR context callable
+        static void name(const void *object, const char *name);
+
+        /// @brief  Records an ISR entry, call it at the start of the ISR.
+        /// @param  irq: the interrupt's number
+        /// @remark ISR context callable
+        static void isr_enter(std::uint16_t irq)
+        {
+            record(event::isr_enter, nullptr, irq);
+        }
+
+        /// @brief  Records an ISR exit, call it at the end of the ISR.
+        /// @remark ISR context callable
+        static void isr_exit()
+        {
+            record(event::isr_exit, nullptr);
+        }
+
+        /// @brief  Consumes the recorded events, oldest first. Only a single reader is allowed.
+        /// @param  events: the array to fill
+        /// @param  max_events: the size of the array
+        /// @return The number of events filled in
+        /// @remark Thread and ISR context callable
+        static std::size_t read(trace_event *events, std::size_t max_events);
+
+        /// @return The number of events lost to overwriting or to a full ring
+        static std::size_t get_dropped();
+
+        /// @return The header of the binary trace output
+        static trace_header get_header();
+
+        /// @brief  Writes the header and consumes all recorded events into the binary trace output.
+        /// @param  write: the output function, returns false on failure
+        /// @param  context: opaque parameter to pass to the output function
+        /// @return The number of events written
+        /// @remark Thread context callable
+        static std::size_t write(bool (*write)(void *context, const void *data, std::size_t size),
+                void *context);
+
+    private:
+        static void record_block(const trace_event *events, std::size_t count);
+
+    #endif // (configUSE_TRACE_RECORDER == 1)
+
+    private:
+        trace_recorder();
+    };
+
+    #if (configUSE_TRACE_RECORDER == 1)
+
+        /// @brief  Streams the recorded events to a FILE*, for ports with file system access
+        ///         (e.g. the POSIX port). Run it as a low priority thread's function with the file
+        ///         as parameter, it never returns. Implemented in src/helpers/trace_stream_file.cpp.
+        void trace_stream_to_file(void *file);
+
+    #endif // (configUSE_TRACE_RECORDER == 1)
+}
+
+#endif // __FREERTOS_TRACE_RECORDER_H_
@@ -0,0 +1,418 @@
+/**
+ * @file      wide_condition_flags.h
+ * @brief     Notification based condition flags of arbitrary width
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_WIDE_CONDITION_FLAGS_H_
+#define __FREERTOS_WIDE_CONDITION_FLAGS_H_
+
+#include "freertos/cpu.h"
+#include "freertos/thread.h"
+#include <bitset>
+
+namespace freertos
+{
+    #if (configUSE_TASK_NOTIFICATIONS == 1)
+
+        /// @brief  Base class that keeps track of the threads waiting on a flags condition.
+        ///         The waiting threads are blocked on their task notification
+        ///         (see configWAKEUP_NOTIFICATION_INDEX), and they are woken up
+        ///         directly by the setting context, without any deferred processing.
+        class flags_wait_list
+        {
+        public:
+            /// @brief  Function to call when a non-blocking wait is satisfied, possibly from ISR context.
+            using notify_function = void (*)(void *context);
+
+        protected:
+            struct waiter
+            {
+                waiter *next;
+                thread *owner;
+                notify_function notify;
+                void *context;
+                bool exclusive;
+                bool match_all;
+                bool satisfied;
+            };
+
+            constexpr flags_wait_list()
+            {
+            }
+
+            /// @brief  The destructor may only be called once no threads are waiting.
+            ~flags_wait_list();
+
+            // the following calls may only be made while the critical section is locked
+            void enqueue(waiter *w);
+            void enqueue(waiter *w, notify_function notify, void *context);
+            void dequeue(waiter *w);
+            static void wake(waiter *w);
+
+            // blocks the calling thread until it is woken up or the time expires
+            bool suspend(waiter *w, const tick_timer::duration& rel_time);
+
+            waiter *head_ = nullptr;
+
+        private:
+            void append(waiter *w);
+
+            // non-copyable
+            flags_wait_list(const flags_wait_list&) = delete;
+            flags_wait_list& operator=(const flags_wait_list&) = delete;
+        };
+
+        /// @brief  Condition flags implementation that is generic over the flags' value type.
+        ///         Unlike @ref condition_flags, this class doesn't use a kernel event group,
+        ///         the flags are stored in the object, and the waiting threads are notified
+        ///         directly by @ref set, even when it is called from ISR context.
+        /// @tparam T: a bitmask type supporting &, |, ~ and == operators
+        template<typename T>
+        class basic_condition_flags : protected flags_wait_list
+        {
+        public:
+            using value_type = T;
+
+            /// @brief  Constructs the condition_flags with all flags cleared.
+            constexpr basic_condition_flags()
+                : flags_()
+            {
+            }
+
+            /// @brief  The state of a single wait on the flags, used by the non-blocking
+            ///         waiting interface (see @ref start_wait).
+            struct wait_record : public waiter
+            {
+                value_type mask;
+                value_type result;
+            };
+
+            /// @brief  Reads the current flags status.
+            /// @return The currently active flags
+            /// @remark Thread and ISR context callable
+            value_type get() const
+            {
+                cpu::critical_section cs;
+                const lock_guard<decltype(cs)> lock(cs);
+
+                return flags_;
+            }
+
+            /// @brief  Sets the provided flags in the condition, and wakes up
+            ///         all waiting threads whose condition became fulfilled.
+            /// @param  flags: the flags to activate
+            /// @remark Thread and ISR context callable
+            void set(const value_type& flags)
+            {
+                cpu::critical_section cs;
+                const lock_guard<decltype(cs)> lock(cs);
+
+                flags_ |= flags;
+
+                // consumed flags are only cleared after all waiters have been evaluated,
+                // so the same flag can wake multiple waiters (matching event group behavior)
+                value_type consumed = value_type();
+                waiter **pw = &head_;
+                while (*pw != nullptr)
+                {
+                    auto *w = static_cast<wait_record*>(*pw);
+                    if (is_match(flags_, w->mask, w->match_all))
+                    {
+                        w->result = flags_ & w->mask;
+                        if (w->exclusive)
+                        {
+                            consumed |= w->mask;
+                        }
+                        *pw = w->next;
+                        wake(w);
+                    }
+                    else
+                    {
+                        pw = &w->next;
+                    }
+                }
+                flags_ &= ~consumed;
+            }
+
+            /// @brief  Removes the provided flags from the condition.
+            /// @param  flags: the flags to deactivate
+            /// @remark Thread and ISR context callable
+            void clear(const value_type& flags)
+            {
+                cpu::critical_section cs;
+                const lock_guard<decltype(cs)> lock(cs);
+
+                flags_ &= ~flags;
+            }
+
+            /// @brief  Blocks the current thread until any of the provided flags is raised.
+            ///         When a flag unblocks the thread, it will be cleared.
+            /// @param  flags: selection of flags to wait on
+            /// @param  rel_time: duration to wait for the activation
+            /// @return the raised flag(s) that caused the activation, or empty if timed out
+            /// @remark Thread context callable
+            template<class Rep, class Period>
+            value_type wait_any_for(const value_type& flags, const std::chrono::duration<Rep, Period>& rel_time)
+            {
+                return wait(flags, std::chrono::duration_cast<tick_timer::duration>(rel_time), true, false);
+            }
+
+            /// @brief  Blocks the current thread until any of the provided flags is raised.
+            ///         When a flag unblocks the thread, it will be cleared.
+            /// @param  flags: selection of flags to wait on
+            /// @param  abs_time: deadline to wait for the activation
+            /// @return the raised flag(s) that caused the activation, or empty if timed out
+            /// @remark Thread context callable
+            template<class Clock, class Duration>
+            value_type wait_any_until(const value_type& flags, const std::chrono::time_point<Clock, Duration>& abs_time)
+            {
+                return wait_any_for(flags, abs_time - Clock::now());
+            }
+
+            /// @brief  Blocks the current thread until all of the provided flags are raised.
+            ///         When the thread is unblocked, the required flags will be cleared.
+            /// @param  flags: combination of flags to wait on
+            /// @param  rel_time: duration to wait for the activation
+            /// @return the raised flag(s) that caused the activation, or empty if timed out
+            /// @remark Thread context callable
+            template<class Rep, class Period>
+            value_type wait_all_for(const value_type& flags, const std::chrono::duration<Rep, Period>& rel_time)
+            {
+                return wait(flags, std::chrono::duration_cast<tick_timer::duration>(rel_time), true, true);
+            }
+
+            /// @brief  Blocks the current thread until all of the provided flags are raised.
+            ///         When the thread is unblocked, the required flags will be cleared.
+            /// @param  flags: combination of flags to wait on
+            /// @param  abs_time: deadline to wait for the activation
+            /// @return the raised flag(s) that caused the activation, or empty if timed out
+            /// @remark Thread context callable
+            template<class Clock, class Duration>
+            value_type wait_all_until(const value_type& flags, const std::chrono::time_point<Clock, Duration>& abs_time)
+            {
+                return wait_all_for(flags, abs_time - Clock::now());
+            }
+
+            /// @brief  Blocks the current thread until any of the provided flags is raised.
+            ///         Doesn't modify the flags upon activation.
+            /// @param  flags: selection of flags to wait on
+            /// @param  rel_time: duration to wait for the activation
+            /// @return the raised flag(s) that caused the activation, or empty if timed out
+            /// @remark Thread context callable
+            template<class Rep, class Period>
+            value_type shared_wait_any_for(const value_type& flags, const std::chrono::duration<Rep, Period>& rel_time)
+            {
+                return wait(flags, std::chrono::duration_cast<tick_timer::duration>(rel_time), false, false);
+            }
+
+            /// @brief  Blocks the current thread until any of the provided flags is raised.
+            ///         Doesn't modify the flags upon activation.
+            /// @param  flags: selection of flags to wait on
+            /// @param  abs_time: deadline to wait for the activation
+            /// @return the raised flag(s) that caused the activation, or empty if timed out
+            /// @remark Thread context callable
+            template<class Clock, class Duration>
+            value_type shared_wait_any_until(const value_type& flags, const std::chrono::time_point<Clock, Duration>& abs_time)
+            {
+                return shared_wait_any_for(flags, abs_time - Clock::now());
+            }
+
+            /// @brief  Blocks the current thread until all of the provided flags are raised.
+            ///         Doesn't modify the flags upon activation.
+            /// @param  flags: combination of flags to wait on
+            /// @param  rel_time: duration to wait for the activation
+            /// @return the raised flag(s) that caused the activation, or empty if timed out
+            /// @remark Thread context callable
+            template<class Rep, class Period>
+            value_type shared_wait_all_for(const value_type& flags, const std::chrono::duration<Rep, Period>& rel_time)
+            {
+                return wait(flags, std::chrono::duration_cast<tick_timer::duration>(rel_time), false, true);
+            }
+
+            /// @brief  Blocks the current thread until all of the provided flags are raised.
+            ///         Doesn't modify the flags upon activation.
+            /// @param  flags: combination of flags to wait on
+            /// @param  abs_time: deadline to wait for the activation
+            /// @return the raised flag(s) that caused the activation, or empty if timed out
+            /// @remark Thread context callable
+            template<class Clock, class Duration>
+            value_type shared_wait_all_until(const value_type& flags, const std::chrono::time_point<Clock, Duration>& abs_time)
+            {
+                return shared_wait_all_for(flags, abs_time - Clock::now());
+            }
+
+            /// @brief  Starts a wait without blocking the current thread: if the flags condition
+            ///         isn't fulfilled yet, the record is registered, and @ref set calls
+            ///         the notify function once the record's condition becomes fulfilled.
+            ///         A registered record must be finished by @ref finish_wait.
+            /// @param  w: the record of the wait
+            /// @param  flags: selection of flags to wait on
+            /// @param  exclusive: whether the raised flags are cleared upon activation
+            /// @param  match_all: whether all or any of the flags need to be raised
+            /// @param  notify: the function to call when the registered record is satisfied
+            /// @param  context: the argument of the notify call
+            /// @return true if the condition is already fulfilled (the record isn't registered),
+            ///         false if the record is registered
+            /// @remark Thread context callable
+            bool start_wait(wait_record& w, const value_type& flags, bool exclusive, bool match_all,
+                    notify_function notify, void *context)
+            {
+                w.exclusive = exclusive;
+                w.match_all = match_all;
+                w.mask = flags;
+
+                cpu::critical_section cs;
+                const lock_guard<decltype(cs)> lock(cs);
+
+                if (try_consume(w))
+                {
+                    return true;
+                }
+                enqueue(&w, notify, context);
+                return false;
+            }
+
+            /// @brief  Checks whether a registered record's condition has been fulfilled.
+            /// @param  w: the record of the wait
+            /// @return true if the record is satisfied, its result holds the raised flags
+            /// @remark Thread and ISR context callable
+            bool is_satisfied(const wait_record& w) const
+            {
+                cpu::critical_section cs;
+                const lock_guard<decltype(cs)> lock(cs);
+
+                return w.satisfied;
+            }
+
+            /// @brief  Finishes a wait started by @ref start_wait, unregistering the record
+            ///         if its condition hasn't been fulfilled.
+            /// @param  w: the record of the wait
+            /// @return true if the record is satisfied, its result holds the raised flags
+            /// @remark Thread context callable
+            bool finish_wait(wait_record& w)
+            {
+                cpu::critical_section cs;
+                const lock_guard<decltype(cs)> lock(cs);
+
+                if (!w.satisfied)
+                {
+                    dequeue(&w);
+                }
+                return w.satisfied;
+            }
+
+        protected:
+            value_type wait(const value_type& flags, const tick_timer::duration& rel_time,
+                    bool exclusive, bool match_all)
+            {
+                wait_record w;
+                w.exclusive = exclusive;
+                w.match_all = match_all;
+                w.mask = flags;
+                {
+                    cpu::critical_section cs;
+                    const lock_guard<decltype(cs)> lock(cs);
+
+                    if (try_consume(w))
+                    {
+                        // no need to block
+                        return w.result;
+                    }
+                    else if (to_ticks(rel_time) == 0)
+                    {
+                        return value_type();
+                    }
+                    enqueue(&w);
+                }
+
+                if (suspend(&w, rel_time))
+                {
+                    return w.result;
+                }
+                else
+                {
+                    return value_type();
+                }
+            }
+
+        private:
+            // may only be called while the critical section is locked
+            bool try_consume(wait_record& w)
+            {
+                if (!is_match(flags_, w.mask, w.match_all))
+                {
+                    return false;
+                }
+                w.result = flags_ & w.mask;
+                if (w.exclusive)
+                {
+                    flags_ &= ~w.mask;
+                }
+                return true;
+            }
+
+            static bool is_match(const value_type& current, const value_type& mask, bool match_all)
+            {
+                if (match_all)
+                {
+                    return (current & mask) == mask;
+                }
+                else
+                {
+                    return !((current & mask) == value_type());
+                }
+            }
+
+            value_type flags_;
+        };
+
+        /// @brief  Condition flags with an arbitrary number of flags. Waiting threads
+        ///         block only once, regardless of which part of the flags they are waiting on.
+        ///         All bits are usable, as opposed to @ref condition_flags,
+        ///         where the kernel reserves the highest byte of the flags.
+        /// @tparam BITS: the number of flags in the condition
+        template<const std::size_t BITS>
+        class wide_condition_flags : public basic_condition_flags<std::bitset<BITS>>
+        {
+        public:
+            using value_type = std::bitset<BITS>;
+
+            /// @brief  The number of flags in the condition.
+            static constexpr std::size_t size()
+            {
+                return BITS;
+            }
+
+            /// @brief  Creates a flags value with a single flag selected.
+            /// @param  pos: the position of the flag
+            /// @return flags value containing the selected flag only
+            static value_type flag(std::size_t pos)
+            {
+                return value_type().set(pos);
+            }
+        };
+
+    #endif // (configUSE_TASK_NOTIFICATIONS == 1)
+}
+
+#endif // __FREERTOS_WIDE_CONDITION_FLAGS_H_
@@ -0,0 +1,283 @@
+/**
+ * @file      work_stealing.h
+ * @brief     Work-stealing task scheduler with a worker on each core
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __FREERTOS_WORK_STEALING_H_
+#define __FREERTOS_WORK_STEALING_H_
+
+#include "freertos/thread.h"
+#include <atomic>
+#include <new>
+
+namespace freertos
+{
+    #if (configUSE_TASK_NOTIFICATIONS == 1)
+
+        class task_group;
+        class work_stealing_scheduler_base;
+
+        /// @brief  A unit of work that is executed by a @ref work_stealing_scheduler.
+        ///         The task is owned by the spawner, and it must remain valid
+        ///         until the @ref task_group it's spawned in is waited for.
+        class stealable_task
+        {
+        public:
+            using function = void (*)(stealable_task*);
+
+        protected:
+            explicit constexpr stealable_task(function fn)
+                : fn_(fn), group_(nullptr), next_(nullptr)
+            {
+            }
+
+        private:
+            friend class work_stealing_scheduler_base;
+
+            function fn_;
+            task_group *group_;
+            stealable_task *next_;
+        };
+
+        /// @brief  A @ref stealable_task that executes a callable object.
+        template<class F>
+        class function_task : public stealable_task
+        {
+        public:
+            explicit function_task(const F& func)
+                : stealable_task(&call), func_(func)
+            {
+            }
+
+        private:
+            static void call(stealable_task *t)
+            {
+                static_cast<function_task*>(t)->func_();
+            }
+
+            F func_;
+        };
+
+        /// @brief  Creates a @ref function_task from a callable.
+        template<class F>
+        function_task<F> make_task(const F& func)
+        {
+            return function_task<F>(func);
+        }
+
+        /// @brief  Tracks the completion of a set of spawned tasks.
+        class task_group
+        {
+        public:
+            /// @brief  Constructs the task group, the current thread becomes its waiter.
+            /// @remark Thread context callable
+            task_group();
+
+            /// @brief  The tasks of the group must be completed when it's destroyed.
+            ~task_group();
+
+            /// @brief  Checks if all spawned tasks of the group have completed.
+            bool done() const
+            {
+                return pending_.load(std::memory_order_acquire) == 0;
+            }
+
+        private:
+            friend class work_stealing_scheduler_base;
+
+            void add()
+            {
+                pending_.fetch_add(1, std::memory_order_relaxed);
+            }
+            void complete();
+
+            thread *const owner_;
+            std::atomic<std::size_t> pending_;
+
+            // non-copyable
+            task_group(const task_group&) = delete;
+            task_group& operator=(const task_group&) = delete;
+        };
+
+        /// @brief  Bounded Chase-Lev work-stealing deque. Only the owner worker may
+        ///         push and pop at the bottom, other workers steal from the top.
+        class work_deque
+        {
+        public:
+            work_deque(std::atomic<stealable_task*> *buffer, std::size_t capacity)
+                : top_(0), bottom_(0), buffer_(buffer), mask_(capacity - 1)
+            {
+            }
+
+            /// @brief  Pushes a task to the bottom of the deque (owner only).
+            /// @return false if the deque is full
+            bool push(stealable_task *t);
+
+            /// @brief  Pops a task from the bottom of the deque (owner only).
+            /// @return the most recently pushed task, or nullptr if the deque is empty
+            stealable_task *pop();
+
+            /// @brief  Steals a task from the top of the deque.
+            /// @return the oldest task, or nullptr if the deque is empty or the race was lost
+            stealable_task *steal();
+
+        private:
+            std::atomic<std::ptrdiff_t> top_;
+            std::atomic<std::ptrdiff_t> bottom_;
+            std::atomic<stealable_task*> *const buffer_;
+            const std::size_t mask_;
+
+            // non-copyable
+            work_deque(const work_deque&) = delete;
+            work_deque& operator=(const work_deque&) = delete;
+        };
+
+        /// @brief  The non-template part of @ref work_stealing_scheduler.
+        class work_stealing_scheduler_base
+        {
+        public:
+            /// @brief  Spawns a task for execution. When called from one of the workers,
+            ///         the task is pushed to the worker's own deque, otherwise it is handed over
+            ///         to one of the workers without locking.
+            /// @param  group: the group that the task's completion is tracked in
+            /// @param  t: the task to execute
+            /// @remark Thread context callable
+            void spawn(task_group& group, stealable_task& t);
+
+            /// @brief  Waits until all tasks of the group are completed.
+            ///         When called from one of the workers, the worker executes other
+            ///         tasks in the meantime.
+            /// @param  group: the group to wait for
+            /// @remark Thread context callable
+            void wait(task_group& group);
+
+            /// @brief  The number of worker threads.
+            std::size_t get_workers_count() const
+            {
+                return count_;
+            }
+
+        protected:
+            struct worker
+            {
+                worker(work_stealing_scheduler_base *sched, std::size_t idx,
+                        std::atomic<stealable_task*> *buffer, std::size_t capacity)
+                    : owner(sched), index(idx), deque(buffer, capacity), inbox(nullptr),
+                      sleeping(false), handle(nullptr), seed(2463534242UL + static_cast<std::uint32_t>(idx))
+                {
+                }
+
+                work_stealing_scheduler_base *const owner;
+                const std::size_t index;
+                work_deque deque;
+                std::atomic<stealable_task*> inbox;
+                std::atomic<bool> sleeping;
+                std::atomic<thread*> handle;
+                std::uint32_t seed;
+            };
+
+            work_stealing_scheduler_base(worker *workers, std::size_t count)
+                : workers_(workers), count_(count), next_inbox_(0)
+            {
+            }
+
+            // the worker thread function
+            static void work(worker *w);
+
+        private:
+            worker *workers_;
+            const std::size_t count_;
+            std::atomic<std::size_t> next_inbox_;
+
+            worker *find_worker(thread *t) const;
+            stealable_task *take_inbox(worker *from, worker *w);
+            stealable_task *steal_from(worker *victim, worker *w);
+            stealable_task *find_task(worker *w);
+            void execute(stealable_task *t);
+            void wake_one(const worker *except);
+
+            // non-copyable
+            work_stealing_scheduler_base(const work_stealing_scheduler_base&) = delete;
+            work_stealing_scheduler_base& operator=(const work_stealing_scheduler_base&) = delete;
+        };
+
+        /// @brief  Task scheduler with a worker thread pinned to each core, each worker
+        ///         owning a work-stealing deque. Idle workers steal from randomly selected
+        ///         other workers, and park on their task notification when there is no work.
+        ///         On single core builds it falls back to a single worker.
+        /// @tparam STACK_SIZE: the stack size of each worker thread in bytes
+        /// @tparam DEQUE_SIZE: the task capacity of each worker's deque (power of 2)
+        template<const std::size_t STACK_SIZE, const std::size_t DEQUE_SIZE = 64>
+        class work_stealing_scheduler : public work_stealing_scheduler_base
+        {
+            static_assert((DEQUE_SIZE > 0) && ((DEQUE_SIZE & (DEQUE_SIZE - 1)) == 0),
+                    "The deque size must be a power of 2.");
+
+        public:
+            /// @brief  The number of worker threads, one per core.
+            static constexpr std::size_t workers()
+            {
+                return native::NUMBER_OF_CORES;
+            }
+
+            /// @brief  Constructs the scheduler, starting all worker threads.
+            /// @param  prio: the priority of the worker threads
+            /// @param  name: short label for identifying the worker threads
+            /// @remark Thread context callable
+            explicit work_stealing_scheduler(thread::priority prio = thread::priority(),
+                    const char *name = thread::DEFAULT_NAME)
+                : work_stealing_scheduler_base(reinterpret_cast<worker*>(&workers_), workers())
+            {
+                for (std::size_t i = 0; i < workers(); i++)
+                {
+                    ::new (&workers_[i]) worker(this, i, buffers_[i], DEQUE_SIZE);
+                }
+                for (std::size_t i = 0; i < workers(); i++)
+                {
+                    auto *t = ::new (&threads_[i]) worker_thread(&work_stealing_scheduler_base::work,
+                            reinterpret_cast<worker*>(&workers_[i]), prio, name);
+                    reinterpret_cast<worker*>(&workers_[i])->handle.store(t, std::memory_order_release);
+                }
+            }
+
+            ~work_stealing_scheduler()
+            {
+                for (std::size_t i = 0; i < workers(); i++)
+                {
+                    reinterpret_cast<worker_thread*>(&threads_[i])->~worker_thread();
+                    reinterpret_cast<worker*>(&workers_[i])->~worker();
+                }
+            }
+
+        private:
+            using worker_thread = static_thread<STACK_SIZE>;
+
+            typename std::aligned_storage<sizeof(worker), alignof(worker)>::type workers_[workers()];
+            std::atomic<stealable_task*> buffers_[workers()][DEQUE_SIZE] {};
+            typename std::aligned_storage<sizeof(worker_thread), alignof(worker_thread)>::type threads_[workers()];
+        };
+
+    #endif // (configUSE_TASK_NOTIFICATIONS == 1)
+}
+
+#endif // __FREERTOS_WORK_STEALING_H_
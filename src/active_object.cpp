@@ -0,0 +1,226 @@
+/**
+ * @file      active_object.cpp
+ * @brief     Active objects: threads with event queues, typed dispatch and pooled events
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/active_object.h"
+#include "freertos/cpu.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+void freertos::retain(const event *e)
+{
+    if (e->pool_ != nullptr)
+    {
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        configASSERT(e->refs_ < UINT8_MAX);
+        const_cast<event*>(e)->refs_++;
+    }
+}
+
+void freertos::release(const event *e)
+{
+    if (e->pool_ != nullptr)
+    {
+        bool last;
+        {
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            configASSERT(e->refs_ > 0);
+            last = (--const_cast<event*>(e)->refs_ == 0);
+        }
+        if (last)
+        {
+            e->pool_->free(const_cast<event*>(e));
+        }
+    }
+}
+
+event_pool_base::event_pool_base(void *blocks, std::size_t block_size, std::size_t count, destructor dtor)
+    : free_list_(nullptr), destroy_(dtor)
+{
+    auto block = reinterpret_cast<unsigned char*>(blocks);
+    for (std::size_t i = count; i > 0; i--)
+    {
+        auto b = reinterpret_cast<free_block*>(block + (i - 1) * block_size);
+        b->next = free_list_;
+        free_list_ = b;
+    }
+}
+
+void *event_pool_base::allocate()
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    free_block *b = free_list_;
+    if (b != nullptr)
+    {
+        free_list_ = b->next;
+    }
+    return b;
+}
+
+void event_pool_base::free(event *e)
+{
+    destroy_(e);
+
+    auto b = reinterpret_cast<free_block*>(e);
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    b->next = free_list_;
+    free_list_ = b;
+}
+
+std::size_t event_pool_base::get_free_count() const
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    std::size_t count = 0;
+    for (free_block *b = free_list_; b != nullptr; b = b->next)
+    {
+        count++;
+    }
+    return count;
+}
+
+bool active_object_base::post(const event *e, tick_timer::duration waittime)
+{
+    retain(e);
+    if (!queue_.push_back(e, waittime))
+    {
+        release(e);
+        return false;
+    }
+    return true;
+}
+
+bool active_object_base::post_urgent(const event *e, tick_timer::duration waittime)
+{
+    retain(e);
+    if (!queue_.push_front(e, waittime))
+    {
+        release(e);
+        return false;
+    }
+    return true;
+}
+
+bool active_object_base::defer(event_queue& deferred, const event *e)
+{
+    retain(e);
+    if (!deferred.push_back(e))
+    {
+        release(e);
+        return false;
+    }
+    return true;
+}
+
+bool active_object_base::recall(event_queue& deferred)
+{
+    const event *e;
+    if (!deferred.pop_front(&e))
+    {
+        return false;
+    }
+    // the deferred queue's reference is passed on to the event queue
+    if (!queue_.push_front(e))
+    {
+        release(e);
+        return false;
+    }
+    return true;
+}
+
+void active_object_base::run(active_object_base *ao)
+{
+    for (;;)
+    {
+        const event *e;
+        if (ao->queue_.pop_front(&e, infinity))
+        {
+            ao->dispatch_(ao, e);
+            release(e);
+        }
+    }
+}
+
+bool topic_base::subscribe(active_object_base& ao)
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    if (count_ == max_count_)
+    {
+        return false;
+    }
+    subscribers_[count_++] = &ao;
+    return true;
+}
+
+void topic_base::unsubscribe(active_object_base& ao)
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    for (std::size_t i = 0; i < count_; i++)
+    {
+        if (subscribers_[i] == &ao)
+        {
+            subscribers_[i] = subscribers_[--count_];
+            break;
+        }
+    }
+}
+
+std::size_t topic_base::publish(const event *e)
+{
+    // hold a reference, so the first subscribers can't free the event during the publishing
+    retain(e);
+
+    std::size_t delivered = 0;
+    for (std::size_t i = 0; i < count_; i++)
+    {
+        if (subscribers_[i]->post(e))
+        {
+            delivered++;
+        }
+    }
+
+    release(e);
+    return delivered;
+}
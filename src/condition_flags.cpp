@@ -37,6 +37,16 @@ namespace freertos
 using namespace freertos;
 using namespace freertos::native;
 
+// the wrapper adds no data to the kernel object
+static_assert(sizeof(condition_flags) == sizeof(StaticEventGroup_t),
+        "The condition_flags wrapper must match the kernel object size.");
+
+#if (configINLINE_WRAPPERS != 1)
+
+#include "freertos/impl/condition_flags.inl"
+
+#endif // (configINLINE_WRAPPERS != 1)
+
 condition_flags::condition_flags()
 {
     configASSERT(!this_cpu::is_in_isr());
@@ -49,60 +59,6 @@ condition_flags::~condition_flags()
     vEventGroupDelete(handle());
 }
 
-cflag condition_flags::get() const
-{
-    if (!this_cpu::is_in_isr())
-    {
-        return xEventGroupGetBits(handle());
-    }
-    else
-    {
-        return xEventGroupGetBitsFromISR(handle());
-    }
-}
-
-void condition_flags::set(cflag flags)
-{
-    if (!this_cpu::is_in_isr())
-    {
-        (void)xEventGroupSetBits(handle(), flags);
-    }
-    else
-    {
-        #if (configUSE_TIMERS == 1)
-
-            BaseType_t needs_yield = false;
-            (void)xEventGroupSetBitsFromISR(handle(), flags, &needs_yield);
-            portYIELD_FROM_ISR(needs_yield);
-
-        #else
-
-            configASSERT(false);
-
-        #endif // (configUSE_TIMERS == 1)
-    }
-}
-
-void condition_flags::clear(cflag flags)
-{
-    if (!this_cpu::is_in_isr())
-    {
-        (void)xEventGroupClearBits(handle(), flags);
-    }
-    else
-    {
-        #if (configUSE_TIMERS == 1)
-
-            (void)xEventGroupClearBitsFromISR(handle(), flags);
-
-        #else
-
-            configASSERT(false);
-
-        #endif // (configUSE_TIMERS == 1)
-    }
-}
-
 cflag condition_flags::wait(cflag flags, const tick_timer::duration& rel_time, bool exclusive, bool match_all)
 {
     configASSERT(!this_cpu::is_in_isr());
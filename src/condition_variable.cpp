@@ -36,6 +36,10 @@ namespace freertos
 using namespace freertos;
 using namespace freertos::native;
 
+// a single element queue and the waiter count
+static_assert(sizeof(condition_variable_any) == sizeof(StaticQueue_t) + 2 * sizeof(UBaseType_t),
+        "The condition_variable_any must only add its waiter count to its queue.");
+
 condition_variable_any::condition_variable_any()
     : queue_(), waiters_(0)
 {
@@ -0,0 +1,367 @@
+/**
+ * @file      coroutine.cpp
+ * @brief     Single thread scheduler for C++20 stackless coroutines
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/coroutine.h"
+#include "freertos/cpu.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+#if defined(__cpp_impl_coroutine)
+
+    coroutine_scheduler_base::coroutine_scheduler_base(void *frames, std::size_t frame_size,
+            std::size_t frame_count, unsigned char *events, std::size_t event_count,
+            tick_timer::duration poll_interval)
+        : free_list_(nullptr), frame_size_(frame_size), poll_interval_(poll_interval),
+    #if (configUSE_QUEUE_SETS == 1)
+          events_(event_count, events), wakeup_(),
+    #else
+          owner_(nullptr),
+    #endif
+          ready_(nullptr), waiters_(nullptr)
+    {
+    #if (configUSE_QUEUE_SETS == 1)
+        // the wakeup semaphore is a permanent member of the set
+        (void)events_.add(wakeup_);
+    #else
+        (void)events;
+        (void)event_count;
+    #endif
+
+        auto block = reinterpret_cast<unsigned char*>(frames);
+        for (std::size_t i = frame_count; i > 0; i--)
+        {
+            auto f = reinterpret_cast<free_frame*>(block + (i - 1) * frame_size);
+            f->next = free_list_;
+            free_list_ = f;
+        }
+    }
+
+    void *coroutine_scheduler_base::allocate(std::size_t size)
+    {
+        if ((size + FRAME_HEADER_SIZE) > frame_size_)
+        {
+            // the frame pool's block size is insufficient for this coroutine
+            configASSERT(false);
+            return nullptr;
+        }
+
+        free_frame *f;
+        {
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            f = free_list_;
+            if (f == nullptr)
+            {
+                return nullptr;
+            }
+            free_list_ = f->next;
+        }
+
+        // the header stores the owner, so the frame can be returned to its pool
+        *reinterpret_cast<coroutine_scheduler_base**>(f) = this;
+        return reinterpret_cast<unsigned char*>(f) + FRAME_HEADER_SIZE;
+    }
+
+    void coroutine_scheduler_base::deallocate(void *frame)
+    {
+        auto block = reinterpret_cast<unsigned char*>(frame) - FRAME_HEADER_SIZE;
+        auto sched = *reinterpret_cast<coroutine_scheduler_base**>(block);
+        auto f = reinterpret_cast<free_frame*>(block);
+
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        f->next = sched->free_list_;
+        sched->free_list_ = f;
+    }
+
+    std::size_t coroutine_scheduler_base::get_free_frames() const
+    {
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        std::size_t count = 0;
+        for (free_frame *f = free_list_; f != nullptr; f = f->next)
+        {
+            count++;
+        }
+        return count;
+    }
+
+    void coroutine_scheduler_base::schedule(coroutine_waiter *w, std::coroutine_handle<> h)
+    {
+        w->handle_ = h;
+        {
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            // LIFO order is fine, the ready coroutines are all resumed in the same pass
+            w->next_ = ready_;
+            ready_ = w;
+        }
+        wake();
+    }
+
+    void coroutine_scheduler_base::add_waiter(coroutine_waiter *w)
+    {
+        // only called from the scheduler thread
+        w->next_ = waiters_;
+        waiters_ = w;
+
+    #if (configUSE_QUEUE_SETS == 1)
+        // the object is added to the set after the coroutine's failed attempt,
+        // and before the scheduler's next attempt, so its events cannot be missed
+        if (w->watch_ != nullptr)
+        {
+            w->watched_ = watch(w);
+        }
+    #endif
+    }
+
+#if (configUSE_QUEUE_SETS == 1)
+
+    bool coroutine_scheduler_base::watch(coroutine_waiter *w)
+    {
+        for (coroutine_waiter *other = waiters_; other != nullptr; other = other->next_)
+        {
+            if ((other != w) && (other->source_ == w->source_) && other->watched_)
+            {
+                // another coroutine awaits the same object
+                return true;
+            }
+        }
+        // adding fails if the object isn't empty (then it will be polled successfully),
+        // or if it has remained in the set after a previous wait
+        return w->watch_(events_, w->source_, true) ||
+                (w->watch_(events_, w->source_, false) && w->watch_(events_, w->source_, true));
+    }
+
+    void coroutine_scheduler_base::dispatch_events(coroutine_waiter **runnable)
+    {
+        // each event is followed by a single read of its member, so the events
+        // and the members' contents stay in sync
+        const void *const wakeup = queue_set::member_id(wakeup_);
+        const void *member;
+        while ((member = events_.try_select_member()) != nullptr)
+        {
+            if (member == wakeup)
+            {
+                (void)wakeup_.try_acquire();
+                continue;
+            }
+
+            // the longest waiting awaiter of the member receives the element
+            coroutine_waiter **found = nullptr;
+            for (coroutine_waiter **pw = &waiters_; *pw != nullptr; pw = &(*pw)->next_)
+            {
+                if ((*pw)->watched_ && ((*pw)->member_ == member))
+                {
+                    found = pw;
+                }
+            }
+            // without an awaiter, the element stays in the member for the next awaiter
+            if ((found != nullptr) && (*found)->try_complete())
+            {
+                coroutine_waiter *w = *found;
+                remove_waiter(found);
+                w->next_ = *runnable;
+                *runnable = w;
+            }
+        }
+    }
+
+#endif // (configUSE_QUEUE_SETS == 1)
+
+    void coroutine_scheduler_base::remove_waiter(coroutine_waiter **pw)
+    {
+        coroutine_waiter *w = *pw;
+        *pw = w->next_;
+
+    #if (configUSE_QUEUE_SETS == 1)
+        if (!w->watched_)
+        {
+            return;
+        }
+        w->watched_ = false;
+        for (coroutine_waiter *other = waiters_; other != nullptr; other = other->next_)
+        {
+            if ((other->source_ == w->source_) && other->watched_)
+            {
+                // another coroutine awaits the same object
+                return;
+            }
+        }
+        // fails if the object isn't empty, then it remains in the set until the next removal
+        (void)w->watch_(events_, w->source_, false);
+    #endif
+    }
+
+    bool coroutine_waiter::needs_polling() const
+    {
+        if (poll_ == nullptr)
+        {
+            return false;
+        }
+    #if (configUSE_QUEUE_SETS == 1)
+        return !notified_ && !watched_;
+    #else
+        return !notified_;
+    #endif
+    }
+
+    void coroutine_scheduler_base::wait_events(tick_timer::duration rel_time)
+    {
+    #if (configUSE_QUEUE_SETS == 1)
+        (void)events_.wait(rel_time);
+    #else
+        (void)this_thread::wait_wakeup_for(rel_time);
+    #endif
+    }
+
+    void coroutine_scheduler_base::wake()
+    {
+    #if (configUSE_QUEUE_SETS == 1)
+        // fails when the scheduler is already woken up
+        wakeup_.release();
+    #else
+        thread *owner = owner_;
+        if (owner != nullptr)
+        {
+            owner->get_wakeup_notifier().signal();
+        }
+    #endif
+    }
+
+    void coroutine_waiter::suspend(coroutine_scheduler_base& sched, std::coroutine_handle<> h)
+    {
+        handle_ = h;
+        if (timeout_ != infinity)
+        {
+            deadline_ = tick_timer::now() + timeout_;
+        }
+        sched.add_waiter(this);
+    }
+
+    void coroutine_task::promise_type::start_awaiter::await_suspend(std::coroutine_handle<> h) noexcept
+    {
+        sched_->schedule(this, h);
+    }
+
+    void coroutine_scheduler_base::run()
+    {
+    #if (configUSE_QUEUE_SETS != 1)
+        owner_ = thread::get_current();
+        (void)owner_->get_wakeup_notifier().cancel_signal();
+    #endif
+
+        for (;;)
+        {
+            // collect the coroutines that can continue
+            coroutine_waiter *runnable;
+            {
+                cpu::critical_section cs;
+                const lock_guard<decltype(cs)> lock(cs);
+
+                runnable = ready_;
+                ready_ = nullptr;
+            }
+
+        #if (configUSE_QUEUE_SETS == 1)
+            dispatch_events(&runnable);
+        #endif
+
+            const auto now = tick_timer::now();
+            auto sleep_time = infinity;
+            for (coroutine_waiter **pw = &waiters_; *pw != nullptr; )
+            {
+                coroutine_waiter *w = *pw;
+            #if (configUSE_QUEUE_SETS == 1)
+                if ((w->watch_ != nullptr) && !w->watched_)
+                {
+                    // the object wasn't empty when it was awaited, retry adding it to the set
+                    w->watched_ = watch(w);
+                }
+                // the awaiters of set members only complete through the set's events
+                bool done = !w->watched_ && w->try_complete();
+            #else
+                bool done = w->try_complete();
+            #endif
+                if (!done && (w->timeout_ != infinity) && ((now - w->deadline_) >= tick_timer::duration(0))
+                        && ((now - w->deadline_) <= (infinity / 2)))
+                {
+                    w->timed_out_ = true;
+                    done = true;
+                }
+
+                if (done)
+                {
+                    remove_waiter(pw);
+                    w->next_ = runnable;
+                    runnable = w;
+                    continue;
+                }
+
+                if (w->timeout_ != infinity)
+                {
+                    const auto remaining = w->deadline_ - now;
+                    if (remaining < sleep_time)
+                    {
+                        sleep_time = remaining;
+                    }
+                }
+                if (w->needs_polling() && (poll_interval_ < sleep_time))
+                {
+                    sleep_time = poll_interval_;
+                }
+                pw = &w->next_;
+            }
+
+            if (runnable == nullptr)
+            {
+                wait_events(sleep_time);
+                continue;
+            }
+
+            // the coroutines may suspend again during their execution, modifying the lists
+            while (runnable != nullptr)
+            {
+                coroutine_waiter *w = runnable;
+                runnable = w->next_;
+                w->next_ = nullptr;
+                w->handle_.resume();
+            }
+        }
+    }
+
+#endif // defined(__cpp_impl_coroutine)
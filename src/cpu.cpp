@@ -24,6 +24,7 @@
  * SOFTWARE.
  */
 #include "freertos/cpu.h"
+#include "freertos/critical_section_profiler.h"
 
 namespace freertos
 {
@@ -37,15 +38,35 @@ namespace freertos
 using namespace freertos;
 using namespace freertos::native;
 
+#if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+
+__attribute__((noinline)) const void *cpu::call_site()
+{
+    return __builtin_return_address(0);
+}
+
+#endif // (configUSE_CRITICAL_SECTION_PROFILER == 1)
+
 void cpu::critical_section::lock()
 {
     if (!this_cpu::is_in_isr())
     {
         taskENTER_CRITICAL();
+    #if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+        #if (configCRITICAL_SECTION_PROFILER_WRAP_PORT == 1)
+            // the port hook has already started the measurement
+            critical_section_profiler::interrupts().attribute(site_);
+        #else
+            critical_section_profiler::interrupts().enter(site_);
+        #endif
+    #endif
     }
     else
     {
         restore_ = std::uintptr_t(taskENTER_CRITICAL_FROM_ISR());
+    #if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+        critical_section_profiler::interrupts().enter(site_);
+    #endif
     }
 }
 
@@ -53,15 +74,64 @@ void cpu::critical_section::unlock()
 {
     if (!this_cpu::is_in_isr())
     {
+    #if (configUSE_CRITICAL_SECTION_PROFILER == 1) && (configCRITICAL_SECTION_PROFILER_WRAP_PORT != 1)
+        critical_section_profiler::interrupts().exit();
+    #endif
         taskEXIT_CRITICAL();
     }
     else
     {
+    #if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+        critical_section_profiler::interrupts().exit();
+    #endif
         taskEXIT_CRITICAL_FROM_ISR(restore_);
     }
 }
 
+#if !(defined(__ARM_ARCH_PROFILE) && (__ARM_ARCH_PROFILE == 'M'))
+
 bool this_cpu::is_in_isr()
 {
     return xPortIsInsideInterrupt();
 }
+
+#endif
+
+unsigned this_cpu::id()
+{
+    #if (configNUMBER_OF_CORES > 1)
+        return portGET_CORE_ID();
+    #else
+        return 0;
+    #endif
+}
+
+void cpu::spinlock::lock()
+{
+    std::uintptr_t restore = std::uintptr_t(portSET_INTERRUPT_MASK_FROM_ISR());
+
+    #if (configNUMBER_OF_CORES > 1)
+
+        const std::uint16_t ticket = next_.fetch_add(1, std::memory_order_relaxed);
+        while (serving_.load(std::memory_order_acquire) != ticket)
+        {
+            portNOP();
+        }
+
+    #endif
+
+    restore_ = restore;
+}
+
+void cpu::spinlock::unlock()
+{
+    std::uintptr_t restore = restore_;
+
+    #if (configNUMBER_OF_CORES > 1)
+
+        serving_.store(serving_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    #endif
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(restore);
+}
@@ -0,0 +1,208 @@
+/**
+ * @file      critical_section_profiler.cpp
+ * @brief     Measurement of interrupt-disabled and scheduler-suspended durations per call site
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/critical_section_profiler.h"
+
+#if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "FreeRTOS.h"
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+#ifndef configPROFILER_CYCLE_COUNTER
+    #ifdef portNVIC_INT_CTRL_REG
+    // the DWT cycle counter of Cortex-M3 and above
+    #define configPROFILER_CYCLE_COUNTER()      (*reinterpret_cast<volatile std::uint32_t*>(0xE0001004UL))
+    #define PROFILER_USES_DWT                   1
+    #elif (configGENERATE_RUN_TIME_STATS == 1)
+    #define configPROFILER_CYCLE_COUNTER()      portGET_RUN_TIME_COUNTER_VALUE()
+    #else
+    #error "Define configPROFILER_CYCLE_COUNTER() to use the critical section profiler."
+    #endif
+#endif
+
+static critical_section_profiler interrupts_profiler;
+static critical_section_profiler scheduler_profiler;
+
+critical_section_profiler& critical_section_profiler::interrupts()
+{
+    return interrupts_profiler;
+}
+
+critical_section_profiler& critical_section_profiler::scheduler_suspension()
+{
+    return scheduler_profiler;
+}
+
+void critical_section_profiler::start()
+{
+#ifdef PROFILER_USES_DWT
+    auto DEMCR = reinterpret_cast<volatile std::uint32_t*>(0xE000EDFCUL);
+    auto DWT_CTRL = reinterpret_cast<volatile std::uint32_t*>(0xE0001000UL);
+
+    // enable the trace unit, then the cycle counter
+    *DEMCR |= (1UL << 24);
+    *DWT_CTRL |= 1UL;
+#endif
+}
+
+void critical_section_profiler::enter(const void *site)
+{
+    core_state& state = cores_.local();
+    if (state.depth++ == 0)
+    {
+        state.site = site;
+        state.start = static_cast<std::uint32_t>(configPROFILER_CYCLE_COUNTER());
+    }
+}
+
+void critical_section_profiler::attribute(const void *site)
+{
+    core_state& state = cores_.local();
+    if (state.depth == 1)
+    {
+        state.site = site;
+    }
+}
+
+void critical_section_profiler::exit()
+{
+    const std::uint32_t now = static_cast<std::uint32_t>(configPROFILER_CYCLE_COUNTER());
+    core_state& state = cores_.local();
+    if ((state.depth > 0) && (--state.depth == 0))
+    {
+        record(state.site, now - state.start);
+    }
+}
+
+void critical_section_profiler::record(const void *site, std::uint32_t cycles)
+{
+    std::size_t bin = 0;
+    for (std::uint32_t limit = 64; (cycles >= limit) && (bin < (HISTOGRAM_BINS - 1)); limit <<= 2)
+    {
+        bin++;
+    }
+
+    const lock_guard<cpu::spinlock> lock(lock_);
+
+    // open addressing, the sites are never removed
+    const std::size_t count = configCRITICAL_SECTION_PROFILER_SITES;
+    std::size_t i = (reinterpret_cast<std::uintptr_t>(site) >> 1) % count;
+    for (std::size_t probes = 0; probes < count; probes++, i = (i + 1) % count)
+    {
+        site_statistics& s = sites_[i];
+        if ((s.count == 0) || (s.site == site))
+        {
+            s.site = site;
+            s.count++;
+            s.total += cycles;
+            if (cycles > s.max)
+            {
+                s.max = cycles;
+            }
+            s.histogram[bin]++;
+            return;
+        }
+    }
+    untracked_++;
+}
+
+std::size_t critical_section_profiler::get_worst(site_statistics *sites, std::size_t max_sites) const
+{
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < configCRITICAL_SECTION_PROFILER_SITES; i++)
+    {
+        site_statistics s;
+        {
+            const lock_guard<cpu::spinlock> lock(lock_);
+            s = sites_[i];
+        }
+        if (s.count == 0)
+        {
+            continue;
+        }
+
+        // insertion into the ordered output
+        std::size_t pos = n;
+        while ((pos > 0) && (sites[pos - 1].max < s.max))
+        {
+            if (pos < max_sites)
+            {
+                sites[pos] = sites[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < max_sites)
+        {
+            sites[pos] = s;
+            if (n < max_sites)
+            {
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+void critical_section_profiler::reset()
+{
+    const lock_guard<cpu::spinlock> lock(lock_);
+
+    for (std::size_t i = 0; i < configCRITICAL_SECTION_PROFILER_SITES; i++)
+    {
+        sites_[i] = site_statistics();
+    }
+    untracked_ = 0;
+}
+
+#if (configCRITICAL_SECTION_PROFILER_WRAP_PORT == 1)
+
+    // the port's critical section functions are wrapped by the linker (--wrap),
+    // so the kernel's own critical sections are measured too
+    extern "C" void __real_vPortEnterCritical(void);
+    extern "C" void __real_vPortExitCritical(void);
+
+    extern "C" void __wrap_vPortEnterCritical(void)
+    {
+        __real_vPortEnterCritical();
+        interrupts_profiler.enter(__builtin_return_address(0));
+    }
+
+    extern "C" void __wrap_vPortExitCritical(void)
+    {
+        interrupts_profiler.exit();
+        __real_vPortExitCritical();
+    }
+
+#endif // (configCRITICAL_SECTION_PROFILER_WRAP_PORT == 1)
+
+#endif // (configUSE_CRITICAL_SECTION_PROFILER == 1)
@@ -0,0 +1,163 @@
+/**
+ * @file      executor.cpp
+ * @brief     Static thread pool executor with priority lanes
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/executor.h"
+#include "freertos/cpu.h"
+#include <algorithm>
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+future_base::~future_base()
+{
+    // the job would write into a destroyed object
+    configASSERT(!pending_);
+}
+
+void future_base::wait()
+{
+    (void)wait(infinity);
+}
+
+bool future_base::is_pending() const
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    return pending_;
+}
+
+bool future_base::wait(const tick_timer::duration& rel_time)
+{
+    configASSERT(!this_cpu::is_in_isr());
+
+    // make_ready() gives the semaphore in the same critical section as it clears the flag,
+    // so once the flag is seen cleared, the job doesn't access the future anymore
+    if (!is_pending())
+    {
+        return true;
+    }
+    else if (ready_.try_acquire_for(rel_time))
+    {
+        // leave the semaphore available for other waiters
+        ready_.release();
+        return true;
+    }
+    else
+    {
+        return !is_pending();
+    }
+}
+
+void future_base::make_pending()
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    configASSERT(!pending_);
+
+    // clear the signal of the previous job
+    (void)ready_.try_acquire();
+    pending_ = true;
+}
+
+void future_base::make_ready()
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    pending_ = false;
+    ready_.release();
+}
+
+void future_base::check_value(bool has_value)
+{
+    // no job has been run for the future
+    configASSERT(has_value);
+}
+
+bool executor_lane::post(const job& j, tick_timer::duration waittime)
+{
+    bool success = queue_->push_back(j, waittime);
+    if (success)
+    {
+        auto queued = queue_->size();
+
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        stats_.max_queued = std::max(stats_.max_queued, queued);
+    }
+    return success;
+}
+
+executor_lane::statistics executor_lane::get_statistics() const
+{
+    statistics stats;
+    {
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        stats = stats_;
+    }
+    stats.queued = queue_->size();
+    return stats;
+}
+
+void executor_lane::reset_statistics()
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    stats_ = statistics();
+}
+
+void executor_lane::work(executor_lane *lane)
+{
+    for (;;)
+    {
+        job j;
+        if (lane->queue_->pop_front(&j, infinity))
+        {
+            const auto start = clock::now();
+            j();
+            const auto run_time = clock::now() - start;
+
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            lane->stats_.executed++;
+            lane->stats_.run_time += run_time;
+            lane->stats_.max_run_time = std::max(lane->stats_.max_run_time, run_time);
+        }
+    }
+}
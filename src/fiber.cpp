@@ -0,0 +1,399 @@
+/**
+ * @file      fiber.cpp
+ * @brief     Cooperative stackful fibers multiplexed on a single thread
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/fiber.h"
+#include "freertos/thread_local.h"
+#include "freertos/cpu.h"
+#include <atomic>
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+#if (configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0) && \
+    (defined(FIBER_CONTEXT_CORTEX_M) || defined(FIBER_CONTEXT_UCONTEXT))
+
+    // the slot that holds the thread's running scheduler, it's only taken when the first scheduler runs
+    static std::atomic<thread_local_storage::index_type> scheduler_slot { thread_local_storage::INVALID_INDEX };
+
+    static thread_local_storage::index_type allocate_scheduler_slot()
+    {
+        auto index = scheduler_slot.load(std::memory_order_acquire);
+        if (index == thread_local_storage::INVALID_INDEX)
+        {
+            auto allocated = thread_local_storage::allocate();
+            if (allocated == thread_local_storage::INVALID_INDEX)
+            {
+                // no free slot left
+            }
+            else if (scheduler_slot.compare_exchange_strong(index, allocated, std::memory_order_acq_rel))
+            {
+                index = allocated;
+            }
+            else
+            {
+                // another thread has allocated it in the meantime
+                thread_local_storage::release(allocated);
+            }
+        }
+        return index;
+    }
+
+    #if defined(FIBER_CONTEXT_CORTEX_M)
+
+        #if defined(__VFP_FP__) && !defined(__SOFTFP__)
+            #define FIBER_CONTEXT_FPU   1
+        #endif
+
+        /// @brief  Saves the callee-saved registers on the current stack, stores the stack pointer,
+        ///         then loads the other stack, and restores the registers from it.
+        ///         The caller-saved registers are preserved by the compiler around the call.
+        extern "C" __attribute__((naked, noinline)) void fiber_switch_context(void **save_sp, void *load_sp)
+        {
+            __asm volatile(
+                "push   {r4-r11, lr}        \n"
+            #if defined(FIBER_CONTEXT_FPU)
+                "vpush  {s16-s31}           \n"
+            #endif
+                "mov    r2, sp              \n"
+                "str    r2, [r0]            \n"
+                "mov    sp, r1              \n"
+            #if defined(FIBER_CONTEXT_FPU)
+                "vpop   {s16-s31}           \n"
+            #endif
+                "pop    {r4-r11, pc}        \n"
+            );
+        }
+
+    #endif // defined(FIBER_CONTEXT_CORTEX_M)
+
+    void fiber_wait_queue::push(fiber *f)
+    {
+        f->next_ = nullptr;
+        if (tail_ != nullptr)
+        {
+            tail_->next_ = f;
+        }
+        else
+        {
+            head_ = f;
+        }
+        tail_ = f;
+    }
+
+    fiber *fiber_wait_queue::pop()
+    {
+        fiber *f = head_;
+        if (f != nullptr)
+        {
+            head_ = f->next_;
+            if (head_ == nullptr)
+            {
+                tail_ = nullptr;
+            }
+            f->next_ = nullptr;
+        }
+        return f;
+    }
+
+    void fiber_wait_queue::wait()
+    {
+        fiber_scheduler *sched = fiber_scheduler::get_current();
+        configASSERT((sched != nullptr) && (sched->current_ != nullptr));
+
+        fiber *f = sched->current_;
+        f->state_ = fiber::state::blocked;
+        push(f);
+        sched->suspend_current();
+    }
+
+    bool fiber_wait_queue::notify_one()
+    {
+        fiber *f = pop();
+        if (f != nullptr)
+        {
+            fiber_scheduler *sched = fiber_scheduler::get_current();
+            configASSERT(sched != nullptr);
+            sched->make_ready(f);
+        }
+        return f != nullptr;
+    }
+
+    void fiber_wait_queue::notify_all()
+    {
+        while (notify_one())
+        {
+        }
+    }
+
+    fiber_scheduler *fiber_scheduler::get_current()
+    {
+        auto index = scheduler_slot.load(std::memory_order_acquire);
+        if (index == thread_local_storage::INVALID_INDEX)
+        {
+            return nullptr;
+        }
+        return static_cast<fiber_scheduler*>(thread_local_storage::get(index));
+    }
+
+    void fiber_scheduler::switch_to(fiber_context& from, fiber_context& to)
+    {
+        #if defined(FIBER_CONTEXT_CORTEX_M)
+            fiber_switch_context(&from.sp, to.sp);
+        #else
+            (void)swapcontext(&from.uc, &to.uc);
+        #endif
+    }
+
+    void fiber_scheduler::entry()
+    {
+        fiber_scheduler *sched = get_current();
+        fiber *f = sched->current_;
+
+        f->func_(f->param_);
+
+        f->state_ = fiber::state::finished;
+        sched->live_--;
+        sched->suspend_current();
+
+        // a finished fiber is never resumed
+        configASSERT(false);
+        for (;;)
+        {
+        }
+    }
+
+    void fiber_scheduler::start(fiber& f)
+    {
+        configASSERT((f.state_ == fiber::state::created) || (f.state_ == fiber::state::finished));
+
+        #if defined(FIBER_CONTEXT_CORTEX_M)
+        {
+            // the initial frame is popped by the first switch to the fiber, landing in entry()
+            auto sp = reinterpret_cast<std::uint32_t*>(
+                    (reinterpret_cast<std::uintptr_t>(f.stack_) + f.stack_size_) & ~std::uintptr_t(7));
+            *(--sp) = reinterpret_cast<std::uint32_t>(&entry); // pc
+            for (unsigned i = 0; i < 8; i++)
+            {
+                *(--sp) = 0; // r4-r11
+            }
+            #if defined(FIBER_CONTEXT_FPU)
+                for (unsigned i = 0; i < 16; i++)
+                {
+                    *(--sp) = 0; // s16-s31
+                }
+            #endif
+            f.ctx_.sp = sp;
+        }
+        #else
+        {
+            (void)getcontext(&f.ctx_.uc);
+            f.ctx_.uc.uc_stack.ss_sp = f.stack_;
+            f.ctx_.uc.uc_stack.ss_size = f.stack_size_;
+            f.ctx_.uc.uc_link = nullptr;
+            makecontext(&f.ctx_.uc, reinterpret_cast<void (*)()>(&entry), 0);
+        }
+        #endif
+
+        live_++;
+        make_ready(&f);
+    }
+
+    void fiber_scheduler::make_ready(fiber *f)
+    {
+        f->state_ = fiber::state::ready;
+        ready_.push(f);
+    }
+
+    void fiber_scheduler::wake_sleepers(const tick_timer::time_point& now)
+    {
+        for (fiber **pf = &sleeping_; *pf != nullptr; )
+        {
+            fiber *f = *pf;
+            // deadlines in the past appear as less than half of the tick range behind
+            if ((now - f->wake_time_) <= (infinity / 2))
+            {
+                *pf = f->next_;
+                make_ready(f);
+            }
+            else
+            {
+                pf = &f->next_;
+            }
+        }
+    }
+
+    void fiber_scheduler::suspend_current()
+    {
+        fiber *f = current_;
+        if (sleeping_ != nullptr)
+        {
+            wake_sleepers(tick_timer::now());
+        }
+
+        fiber *next = ready_.pop();
+        if (next == f)
+        {
+            // a yield without other ready fibers
+            current_ = f;
+            return;
+        }
+        if (next != nullptr)
+        {
+            current_ = next;
+            switch_to(f->ctx_, next->ctx_);
+        }
+        else
+        {
+            // nothing to run, let the host wait for the sleepers
+            current_ = nullptr;
+            switch_to(f->ctx_, host_);
+        }
+        // resumed, current_ was set to this fiber by the switching side
+    }
+
+    void fiber_scheduler::yield()
+    {
+        configASSERT(current_ != nullptr);
+
+        make_ready(current_);
+        suspend_current();
+    }
+
+    void fiber_scheduler::sleep_until(const tick_timer::time_point& abs_time)
+    {
+        configASSERT(current_ != nullptr);
+
+        fiber *f = current_;
+        f->state_ = fiber::state::sleeping;
+        f->wake_time_ = abs_time;
+        f->next_ = sleeping_;
+        sleeping_ = f;
+        suspend_current();
+    }
+
+    void fiber_scheduler::run()
+    {
+        configASSERT(!this_cpu::is_in_isr());
+        const auto slot = allocate_scheduler_slot();
+        configASSERT((slot != thread_local_storage::INVALID_INDEX) && (get_current() == nullptr));
+
+        thread_local_storage::set(slot, this);
+
+        while (live_ > 0)
+        {
+            wake_sleepers(tick_timer::now());
+
+            fiber *next = ready_.pop();
+            if (next != nullptr)
+            {
+                current_ = next;
+                switch_to(host_, next->ctx_);
+                continue;
+            }
+
+            if (sleeping_ == nullptr)
+            {
+                // all remaining fibers are blocked on each other
+                configASSERT(false);
+                break;
+            }
+
+            // block the thread until the earliest sleeper's wakeup
+            const auto now = tick_timer::now();
+            auto earliest = sleeping_->wake_time_;
+            for (fiber *f = sleeping_->next_; f != nullptr; f = f->next_)
+            {
+                if ((f->wake_time_ - now) < (earliest - now))
+                {
+                    earliest = f->wake_time_;
+                }
+            }
+            this_thread::sleep_until(earliest);
+        }
+
+        thread_local_storage::set(slot, nullptr);
+    }
+
+    void this_fiber::yield()
+    {
+        fiber_scheduler::get_current()->yield();
+    }
+
+    void this_fiber::sleep_for(tick_timer::duration rel_time)
+    {
+        fiber_scheduler::get_current()->sleep_until(tick_timer::now() + rel_time);
+    }
+
+    void fiber_mutex::lock()
+    {
+        fiber *f = fiber_scheduler::get_current()->get_current_fiber();
+        configASSERT(owner_ != f); // not recursive
+
+        if (owner_ == nullptr)
+        {
+            owner_ = f;
+        }
+        else
+        {
+            // the unlocking fiber hands the ownership over before waking this one
+            waiters_.wait();
+            configASSERT(owner_ == f);
+        }
+    }
+
+    bool fiber_mutex::try_lock()
+    {
+        if (owner_ != nullptr)
+        {
+            return false;
+        }
+        owner_ = fiber_scheduler::get_current()->get_current_fiber();
+        return true;
+    }
+
+    void fiber_mutex::unlock()
+    {
+        configASSERT(owner_ == fiber_scheduler::get_current()->get_current_fiber());
+
+        owner_ = waiters_.front();
+        (void)waiters_.notify_one();
+    }
+
+    void fiber_condition_variable::wait(unique_lock<fiber_mutex>& lock)
+    {
+        // no other fiber runs between the unlock and the suspension
+        lock.unlock();
+        waiters_.wait();
+        lock.lock();
+    }
+
+#endif // (configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0) && (fiber context switch available)
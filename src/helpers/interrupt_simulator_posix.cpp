@@ -0,0 +1,267 @@
+/**
+ * @file      interrupt_simulator_posix.cpp
+ * @brief     Simulated interrupt controller for the POSIX port, the handlers run in signal context
+ *            like the port's tick, and xPortIsInsideInterrupt() reports true within them.
+ *            Host threads that aren't kernel threads must block configINTERRUPT_SIMULATOR_SIGNAL.
+ * @author    Benedek Kupper
+ */
+#include "freertos/interrupt_simulator.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifndef configINTERRUPT_SIMULATOR_SIGNAL
+    #ifdef SIGRTMIN
+        #define configINTERRUPT_SIMULATOR_SIGNAL    SIGRTMIN
+    #else
+        #define configINTERRUPT_SIMULATOR_SIGNAL    SIGUSR2
+    #endif
+#endif
+
+using namespace freertos;
+using namespace freertos::native;
+
+namespace
+{
+    struct line_state
+    {
+        std::atomic<interrupt_simulator::handler> func {nullptr};
+        void *arg = nullptr;
+        interrupt_simulator::priority_type priority = 0;
+        std::atomic<bool> pending {false};
+        // the time of the first raise since the last dispatch, 0 if unknown
+        std::atomic<std::uint64_t> raise_time {0};
+        std::atomic<std::uint32_t> raised {0};
+
+        // only written by the dispatching handler
+        std::uint32_t dispatched = 0;
+        std::uint64_t max_latency_ns = 0;
+        std::uint64_t total_latency_ns = 0;
+
+        std::atomic<bool> storming {false};
+        std::uint64_t storm_period_ns = 0;
+        pthread_t storm_thread;
+    };
+
+    line_state lines[interrupt_simulator::LINES];
+
+    // the handlers may switch threads (yield from ISR), so the nesting is tracked per thread
+    thread_local unsigned nesting = 0;
+    thread_local long active_priority = -1;
+
+    std::uint64_t now_ns()
+    {
+        timespec ts;
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    line_state *highest_pending()
+    {
+        line_state *next = nullptr;
+        for (auto &l : lines)
+        {
+            if (l.pending.load() && (static_cast<long>(l.priority) > active_priority)
+                    && ((next == nullptr) || (l.priority > next->priority)))
+            {
+                next = &l;
+            }
+        }
+        return next;
+    }
+
+    void dispatch()
+    {
+        // tail-chain the pending lines in priority order
+        for (line_state *l = highest_pending(); l != nullptr; l = highest_pending())
+        {
+            if (!l->pending.exchange(false))
+            {
+                continue;
+            }
+            const std::uint64_t raise_time = l->raise_time.exchange(0);
+            if (raise_time != 0)
+            {
+                const std::uint64_t latency = now_ns() - raise_time;
+                l->total_latency_ns += latency;
+                if (latency > l->max_latency_ns)
+                {
+                    l->max_latency_ns = latency;
+                }
+            }
+            l->dispatched++;
+
+            const long preempted_priority = active_priority;
+            active_priority = l->priority;
+            nesting++;
+
+            interrupt_simulator::handler func = l->func.load();
+            if (func != nullptr)
+            {
+                func(l->arg);
+            }
+
+            nesting--;
+            active_priority = preempted_priority;
+        }
+    }
+
+    void signal_handler(int)
+    {
+        const int saved_errno = errno;
+        dispatch();
+        errno = saved_errno;
+    }
+
+    void *storm_main(void *arg)
+    {
+        line_state *l = static_cast<line_state*>(arg);
+        const auto line = static_cast<interrupt_simulator::line_type>(l - lines);
+
+        timespec next;
+        (void)clock_gettime(CLOCK_MONOTONIC, &next);
+        while (l->storming.load())
+        {
+            std::uint64_t nsec = next.tv_nsec + l->storm_period_ns;
+            next.tv_sec += nsec / 1000000000;
+            next.tv_nsec = nsec % 1000000000;
+            (void)clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+
+            interrupt_simulator::raise(line);
+        }
+        return nullptr;
+    }
+}
+
+void interrupt_simulator::start()
+{
+    struct sigaction action = {};
+    action.sa_handler = signal_handler;
+    action.sa_flags = SA_RESTART;
+    // the kernel's FromISR calls rely on all signals being masked in handlers (like the port's tick)
+    (void)sigfillset(&action.sa_mask);
+    (void)sigaction(configINTERRUPT_SIMULATOR_SIGNAL, &action, nullptr);
+}
+
+bool interrupt_simulator::attach(line_type line, handler func, void *arg, priority_type priority)
+{
+    configASSERT(line < LINES);
+    line_state &l = lines[line];
+    if (l.func.load() != nullptr)
+    {
+        return false;
+    }
+    l.arg = arg;
+    l.priority = priority;
+    l.func.store(func);
+    return true;
+}
+
+void interrupt_simulator::detach(line_type line)
+{
+    configASSERT(line < LINES);
+    stop_storm(line);
+    lines[line].func.store(nullptr);
+    lines[line].pending.store(false);
+}
+
+void interrupt_simulator::raise(line_type line)
+{
+    configASSERT(line < LINES);
+    line_state &l = lines[line];
+
+    l.raised++;
+    std::uint64_t unknown = 0;
+    (void)l.raise_time.compare_exchange_strong(unknown, now_ns());
+    l.pending.store(true);
+
+    if (nesting > 0)
+    {
+        // raised from a handler, preempt it immediately if the new line is more urgent
+        if (static_cast<long>(l.priority) > active_priority)
+        {
+            dispatch();
+        }
+    }
+    else
+    {
+        // delivered to the running thread, once it doesn't mask interrupts
+        (void)kill(getpid(), configINTERRUPT_SIMULATOR_SIGNAL);
+    }
+}
+
+bool interrupt_simulator::start_storm(line_type line, std::uint32_t rate_Hz)
+{
+    configASSERT(line < LINES);
+    configASSERT(rate_Hz > 0);
+    line_state &l = lines[line];
+    if ((l.func.load() == nullptr) || l.storming.exchange(true))
+    {
+        return false;
+    }
+    l.storm_period_ns = 1000000000 / rate_Hz;
+
+    // the storm thread inherits the signal mask, it must never run the handlers or the kernel's tick
+    sigset_t all, previous;
+    (void)sigfillset(&all);
+    (void)pthread_sigmask(SIG_SETMASK, &all, &previous);
+    bool success = pthread_create(&l.storm_thread, nullptr, storm_main, &l) == 0;
+    (void)pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+    if (!success)
+    {
+        l.storming.store(false);
+    }
+    return success;
+}
+
+void interrupt_simulator::stop_storm(line_type line)
+{
+    configASSERT(line < LINES);
+    line_state &l = lines[line];
+    if (l.storming.exchange(false))
+    {
+        (void)pthread_join(l.storm_thread, nullptr);
+    }
+}
+
+unsigned interrupt_simulator::get_nesting()
+{
+    return nesting;
+}
+
+interrupt_simulator::line_statistics interrupt_simulator::get_statistics(line_type line)
+{
+    configASSERT(line < LINES);
+    const line_state &l = lines[line];
+    line_statistics stats;
+    stats.raised = l.raised.load();
+    stats.dispatched = l.dispatched;
+    stats.max_latency_ns = l.max_latency_ns;
+    stats.total_latency_ns = l.total_latency_ns;
+    return stats;
+}
+
+void interrupt_simulator::reset_statistics(line_type line)
+{
+    configASSERT(line < LINES);
+    line_state &l = lines[line];
+    l.raised.store(0);
+    l.dispatched = 0;
+    l.max_latency_ns = 0;
+    l.total_latency_ns = 0;
+}
+
+/* the POSIX port doesn't provide ISR detection, the simulated interrupts are the only ISRs */
+extern "C" BaseType_t xPortIsInsideInterrupt(void)
+{
+    return interrupt_simulator::get_nesting() > 0;
+}
+
+#endif /* defined(__unix__) || defined(__APPLE__) */
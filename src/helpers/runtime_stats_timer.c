@@ -30,8 +30,13 @@ struct
 
 /**
  * @brief This is a tunable value, a tradeoff between resolution and long runtime without overflow.
+ *        It is set through configRUN_TIME_COUNTER_RATE_HZ, so the C++ runtime_clock has the same rate.
  */
+#ifdef configRUN_TIME_COUNTER_RATE_HZ
+static const uint32_t TimerResolution = configRUN_TIME_COUNTER_RATE_HZ / configTICK_RATE_HZ;
+#else
 static const uint32_t TimerResolution = 100;
+#endif
 
 /**
  * @brief Empty funtion, the SysTick is configured by kernel when the scheduler is started.
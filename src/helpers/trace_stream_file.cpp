@@ -0,0 +1,38 @@
+/**
+ * @file      trace_stream_file.cpp
+ * @brief     Streams the trace recorder's events to a file, for ports with file system access
+ *            (e.g. the POSIX port). Convert the output with tools/trace2chrome.py.
+ * @author    Benedek Kupper
+ */
+#include "freertos/trace_recorder.h"
+#include "freertos/thread.h"
+#include <cstdio>
+
+#if (configUSE_TRACE_RECORDER == 1)
+
+void freertos::trace_stream_to_file(void *file)
+{
+    std::FILE *f = static_cast<std::FILE*>(file);
+
+    // the stream starts with the events recorded so far, then continues without overwriting
+    trace_recorder::start(trace_recorder::mode::streaming);
+    const trace_recorder::trace_header header = trace_recorder::get_header();
+    (void)std::fwrite(&header, sizeof(header), 1, f);
+
+    for (;;)
+    {
+        trace_recorder::trace_event events[64];
+        std::size_t n = trace_recorder::read(events, sizeof(events) / sizeof(events[0]));
+        if (n > 0)
+        {
+            (void)std::fwrite(events, sizeof(events[0]), n, f);
+            (void)std::fflush(f);
+        }
+        else
+        {
+            this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
+
+#endif /* (configUSE_TRACE_RECORDER == 1) */
@@ -0,0 +1,157 @@
+/**
+ * @file      latency_probe.cpp
+ * @brief     Wake-up latency measurement from signalling to the woken thread running
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/latency_probe.h"
+#include "freertos/cpu.h"
+
+#if (configGENERATE_RUN_TIME_STATS == 1)
+
+using namespace freertos;
+
+static latency_probe_base *probes = nullptr;
+
+latency_probe_base::latency_probe_base(const char *name, std::size_t *bins, std::size_t bin_count)
+    : name_(name), bins_(bins), bin_count_(bin_count), next_(nullptr), thread_(nullptr),
+      signal_time_(), pending_(false), stats_()
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    next_ = probes;
+    probes = this;
+}
+
+latency_probe_base::~latency_probe_base()
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    for (latency_probe_base **p = &probes; *p != nullptr; p = &(*p)->next_)
+    {
+        if (*p == this)
+        {
+            *p = next_;
+            break;
+        }
+    }
+}
+
+latency_probe_base *latency_probe_base::first()
+{
+    return probes;
+}
+
+void latency_probe_base::mark_signal()
+{
+    auto now = runtime_clock::now();
+
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    if (pending_)
+    {
+        stats_.coalesced++;
+    }
+    else
+    {
+        signal_time_ = now;
+        pending_ = true;
+    }
+}
+
+void latency_probe_base::mark_wake()
+{
+    auto now = runtime_clock::now();
+    thread *t = thread::get_current();
+
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    if (pending_)
+    {
+        pending_ = false;
+        thread_ = t;
+        // the unsigned counter difference is correct across wrap-around
+        record(duration(static_cast<duration::rep>(now.time_since_epoch().count()
+                - signal_time_.time_since_epoch().count())));
+    }
+}
+
+void latency_probe_base::record(duration latency)
+{
+    if ((stats_.count == 0) || (latency < stats_.min))
+    {
+        stats_.min = latency;
+    }
+    if ((stats_.count == 0) || (latency > stats_.max))
+    {
+        stats_.max = latency;
+    }
+    stats_.count++;
+    stats_.total += latency.count();
+
+    std::size_t bin = 0;
+    for (auto l = latency.count(); (l > 0) && (bin < (bin_count_ - 1)); l >>= 1)
+    {
+        bin++;
+    }
+    bins_[bin]++;
+}
+
+latency_probe_base::statistics latency_probe_base::get_statistics() const
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    return stats_;
+}
+
+std::size_t latency_probe_base::get_histogram(std::size_t *bins, std::size_t max_bins) const
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    std::size_t n = (bin_count_ < max_bins) ? bin_count_ : max_bins;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        bins[i] = bins_[i];
+    }
+    return n;
+}
+
+void latency_probe_base::reset()
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    for (std::size_t i = 0; i < bin_count_; i++)
+    {
+        bins_[i] = 0;
+    }
+    stats_ = statistics();
+    pending_ = false;
+}
+
+#endif // (configGENERATE_RUN_TIME_STATS == 1)
@@ -39,6 +39,13 @@ using namespace freertos::native;
 
 #if (configUSE_MUTEXES == 1)
 
+    // the wrappers add no data to the kernel object
+    static_assert(sizeof(mutex) == sizeof(StaticSemaphore_t), "The mutex wrapper must match the kernel object size.");
+    #if (configUSE_RECURSIVE_MUTEXES == 1)
+    static_assert(sizeof(recursive_mutex) == sizeof(StaticSemaphore_t),
+            "The recursive_mutex wrapper must match the kernel object size.");
+    #endif // (configUSE_RECURSIVE_MUTEXES == 1)
+
     void mutex::unlock()
     {
         configASSERT(!this_cpu::is_in_isr());
@@ -0,0 +1,71 @@
+/**
+ * @file      parallel.cpp
+ * @brief     Fork-join parallel algorithms executed on an executor's workers
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/parallel.h"
+#include "freertos/cpu.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+#if (configUSE_TASK_NOTIFICATIONS == 1)
+
+    fork_join::fork_join()
+        : owner_(thread::get_current()), pending_(1)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+
+        // discard any leftover signal from a previous wait
+        (void)owner_->get_wakeup_notifier().cancel_signal();
+    }
+
+    void fork_join::leave()
+    {
+        // the object may be destroyed as soon as the counter reaches zero
+        thread *owner = owner_;
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            owner->get_wakeup_notifier().signal();
+        }
+    }
+
+    void fork_join::join()
+    {
+        configASSERT(thread::get_current() == owner_);
+
+        leave();
+        while (pending_.load(std::memory_order_acquire) != 0)
+        {
+            (void)this_thread::wait_wakeup_for(infinity);
+        }
+    }
+
+#endif // (configUSE_TASK_NOTIFICATIONS == 1)
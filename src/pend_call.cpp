@@ -40,7 +40,7 @@ using namespace freertos::native;
 
     bool freertos::pend_call(pend_function_2 func, void *arg1, std::uint32_t arg2, tick_timer::duration waittime)
     {
-        if (!this_cpu::is_in_isr())
+        if (!this_cpu::uses_isr_api())
         {
             return xTimerPendFunctionCall(func, arg1, arg2, to_ticks(waittime));
         }
@@ -0,0 +1,125 @@
+/**
+ * @file      periodic_thread.cpp
+ * @brief     Fixed rate thread with execution time statistics
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/periodic_thread.h"
+#include "freertos/cpu.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+periodic_thread_base::statistics periodic_thread_base::get_statistics() const
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    return stats_;
+}
+
+void periodic_thread_base::reset_statistics()
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    stats_ = statistics();
+}
+
+void periodic_thread_base::record(const statistics& cycle)
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    stats_.cycles++;
+    stats_.overruns += cycle.overruns;
+    stats_.skipped += cycle.skipped;
+    stats_.last_exec_time = cycle.last_exec_time;
+    if (cycle.last_exec_time > stats_.max_exec_time)
+    {
+        stats_.max_exec_time = cycle.last_exec_time;
+    }
+    stats_.last_response_time = cycle.last_response_time;
+    if (cycle.last_response_time > stats_.max_response_time)
+    {
+        stats_.max_response_time = cycle.last_response_time;
+    }
+    if (cycle.max_jitter > stats_.max_jitter)
+    {
+        stats_.max_jitter = cycle.max_jitter;
+    }
+}
+
+void periodic_thread_base::run(periodic_thread_base *p)
+{
+    const TickType_t period = to_ticks(p->period_);
+    const auto nominal = std::chrono::duration_cast<clock::duration>(p->period_);
+    configASSERT(period > 0);
+
+    TickType_t release = xTaskGetTickCount();
+    clock::time_point last_start;
+    bool first = true;
+
+    for (;;)
+    {
+        statistics cycle = statistics();
+
+        const auto start = clock::now();
+        if (!first)
+        {
+            const auto interval = start - last_start;
+            cycle.max_jitter = (interval > nominal) ? (interval - nominal) : (nominal - interval);
+        }
+        first = false;
+        last_start = start;
+
+        p->step_(p->param_);
+
+        cycle.last_exec_time = clock::now() - start;
+        const TickType_t response = xTaskGetTickCount() - release;
+        cycle.last_response_time = tick_timer::duration(response);
+
+        if (response >= period)
+        {
+            cycle.overruns = 1;
+
+            if (p->policy_ == overrun_policy::skip)
+            {
+                // continue with the next period that hasn't started yet
+                const TickType_t missed = response / period;
+                cycle.skipped = missed;
+                release += missed * period;
+            }
+        }
+        p->record(cycle);
+
+        // returns immediately if the next release time has already passed
+        (void)xTaskDelayUntil(&release, period);
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * @file      placement.cpp
+ * @brief     Memory region placement of kernel objects
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/placement.h"
+
+using namespace freertos;
+
+const memory_region *freertos::find_memory_region(const void *address, std::size_t size,
+        const memory_region *regions, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (regions[i].contains(address, size))
+        {
+            return &regions[i];
+        }
+    }
+    return nullptr;
+}
+
+std::size_t freertos::report_placement(const placement_record *records, std::size_t record_count,
+        const memory_region *regions, std::size_t region_count,
+        void (*print)(const placement_record& record, const memory_region *region))
+{
+    std::size_t misplaced = 0;
+    for (std::size_t i = 0; i < record_count; i++)
+    {
+        const memory_region *region = find_memory_region(records[i].address, records[i].size,
+                regions, region_count);
+        if (region == nullptr)
+        {
+            misplaced++;
+        }
+        if (print != nullptr)
+        {
+            print(records[i], region);
+        }
+    }
+    return misplaced;
+}
@@ -25,6 +25,7 @@
  */
 #include "freertos/queue.h"
 #include "freertos/cpu.h"
+#include "freertos/trace_recorder.h"
 
 namespace freertos
 {
@@ -36,17 +37,14 @@ namespace freertos
 using namespace freertos;
 using namespace freertos::native;
 
-queue::size_type queue::size() const
-{
-    if (!this_cpu::is_in_isr())
-    {
-        return uxQueueMessagesWaiting(handle());
-    }
-    else
-    {
-        return uxQueueMessagesWaitingFromISR(handle());
-    }
-}
+// the wrapper adds no data to the kernel object
+static_assert(sizeof(queue) == sizeof(StaticQueue_t), "The queue wrapper must match the kernel object size.");
+
+#if (configINLINE_WRAPPERS != 1)
+
+#include "freertos/impl/queue.inl"
+
+#endif // (configINLINE_WRAPPERS != 1)
 
 queue::size_type queue::available() const
 {
@@ -57,30 +55,6 @@ queue::size_type queue::available() const
     }
 }
 
-bool queue::full() const
-{
-    if (!this_cpu::is_in_isr())
-    {
-        return uxQueueMessagesWaiting(handle()) == 0;
-    }
-    else
-    {
-        return xQueueIsQueueFullFromISR(handle());
-    }
-}
-
-bool queue::empty() const
-{
-    if (!this_cpu::is_in_isr())
-    {
-        return uxQueueSpacesAvailable(handle()) == 0;
-    }
-    else
-    {
-        return xQueueIsQueueEmptyFromISR(handle());
-    }
-}
-
 #if 0
 queue::size_type queue::max_size() const
 {
@@ -108,88 +82,6 @@ queue::~queue()
     vQueueDelete(handle());
 }
 
-bool queue::push_front(void *data, tick_timer::duration waittime)
-{
-    if (!this_cpu::is_in_isr())
-    {
-        return xQueueSendToFront(handle(), data, to_ticks(waittime));
-    }
-    else
-    {
-        // cannot wait in ISR
-        configASSERT(to_ticks(waittime) == 0);
-
-        BaseType_t needs_yield = false;
-        bool success = xQueueSendToFrontFromISR(handle(), data, &needs_yield);
-        portYIELD_FROM_ISR(needs_yield);
-        return success;
-    }
-}
-
-bool queue::push_back(void *data, tick_timer::duration waittime)
-{
-    if (!this_cpu::is_in_isr())
-    {
-        return xQueueSendToBack(handle(), data, to_ticks(waittime));
-    }
-    else
-    {
-        // cannot wait in ISR
-        configASSERT(to_ticks(waittime) == 0);
-
-        BaseType_t needs_yield = false;
-        bool success = xQueueSendToBackFromISR(handle(), data, &needs_yield);
-        portYIELD_FROM_ISR(needs_yield);
-        return success;
-    }
-}
-
-void queue::replace(void *data)
-{
-    if (!this_cpu::is_in_isr())
-    {
-        bool success = xQueueOverwrite(handle(), data);
-        configASSERT(success);
-    }
-    else
-    {
-        BaseType_t needs_yield = false;
-        bool success = xQueueOverwriteFromISR(handle(), data, &needs_yield);
-        configASSERT(success);
-        portYIELD_FROM_ISR(needs_yield);
-    }
-}
-
-bool queue::peek_front(void *data, tick_timer::duration waittime) const
-{
-    if (!this_cpu::is_in_isr())
-    {
-        return xQueuePeek(handle(), data, to_ticks(waittime));
-    }
-    else
-    {
-        return xQueuePeekFromISR(handle(), data);
-    }
-}
-
-bool queue::pop_front(void *data, tick_timer::duration waittime)
-{
-    if (!this_cpu::is_in_isr())
-    {
-        return xQueueReceive(handle(), data, to_ticks(waittime));
-    }
-    else
-    {
-        // cannot wait in ISR
-        configASSERT(to_ticks(waittime) == 0);
-
-        BaseType_t needs_yield = false;
-        bool success = xQueueReceiveFromISR(handle(), data, &needs_yield);
-        portYIELD_FROM_ISR(needs_yield);
-        return success;
-    }
-}
-
 queue::queue(size_type size, size_type elem_size, unsigned char *elem_buffer)
 {
     // construction not allowed in ISR
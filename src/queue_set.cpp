@@ -0,0 +1,129 @@
+/**
+ * @file      queue_set.cpp
+ * @brief     Wrapper for FreeRTOS queue sets
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/queue_set.h"
+#include "freertos/cpu.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "queue.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+#if (configUSE_QUEUE_SETS == 1)
+
+    // the set stores the handles of the members that posted events
+    static_assert(sizeof(QueueSetMemberHandle_t) == sizeof(void*), "The queue set storage size is miscalculated.");
+
+    queue_set::queue_set(size_type size, unsigned char *elem_buffer)
+    {
+        // construction not allowed in ISR
+        configASSERT(!this_cpu::is_in_isr());
+
+        (void)xQueueGenericCreateStatic(size, sizeof(QueueSetMemberHandle_t), elem_buffer,
+                this, queueQUEUE_TYPE_SET);
+    }
+
+    bool queue_set::add(queue *q)
+    {
+        // no ISR API available
+        configASSERT(!this_cpu::is_in_isr());
+
+        return pdPASS == xQueueAddToSet(q->handle(), handle());
+    }
+
+    bool queue_set::remove(queue *q)
+    {
+        // no ISR API available
+        configASSERT(!this_cpu::is_in_isr());
+
+        return pdPASS == xQueueRemoveFromSet(q->handle(), handle());
+    }
+
+    bool queue_set::add(queue& q)
+    {
+        return add(&q);
+    }
+
+    bool queue_set::add(semaphore& sem)
+    {
+        return add(static_cast<queue*>(&sem));
+    }
+
+    bool queue_set::remove(queue& q)
+    {
+        return remove(&q);
+    }
+
+    bool queue_set::remove(semaphore& sem)
+    {
+        return remove(static_cast<queue*>(&sem));
+    }
+
+    const void *queue_set::select_member(tick_timer::duration waittime)
+    {
+        // blocking is only possible in thread context
+        configASSERT(!this_cpu::is_in_isr());
+
+        return xQueueSelectFromSet(handle(), to_ticks(waittime));
+    }
+
+    const void *queue_set::try_select_member()
+    {
+        if (this_cpu::uses_isr_api())
+        {
+            return xQueueSelectFromSetFromISR(handle());
+        }
+        else
+        {
+            return select_member(tick_timer::duration(0));
+        }
+    }
+
+    bool queue_set::select(tick_timer::duration waittime)
+    {
+        return nullptr != select_member(waittime);
+    }
+
+    bool queue_set::try_select()
+    {
+        return nullptr != try_select_member();
+    }
+
+    const void *queue_set::member_id(const queue& q)
+    {
+        return q.handle();
+    }
+
+    const void *queue_set::member_id(const semaphore& sem)
+    {
+        return member_id(static_cast<const queue&>(sem));
+    }
+
+#endif // (configUSE_QUEUE_SETS == 1)
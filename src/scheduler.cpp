@@ -24,6 +24,9 @@
  * SOFTWARE.
  */
 #include "freertos/scheduler.h"
+#include "freertos/critical_section_profiler.h"
+#include <algorithm>
+#include <cstring>
 
 namespace freertos
 {
@@ -61,12 +64,247 @@ scheduler::state scheduler::get_state()
 void scheduler::critical_section::lock()
 {
     vTaskSuspendAll();
+#if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+    critical_section_profiler::scheduler_suspension().enter(site_);
+#endif
 }
 
 void scheduler::critical_section::unlock()
 {
+#if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+    critical_section_profiler::scheduler_suspension().exit();
+#endif
     if (xTaskResumeAll())
     {
         // a context switch had already happened
     }
 }
+
+#if (configUSE_TRACE_FACILITY == 1)
+
+    /// @brief  Collects the kernel's thread status records in the caller's array.
+    template<typename T, typename Counter>
+    static std::size_t collect_status(T *records, std::size_t max_records, Counter total)
+    {
+        TaskStatus_t *status = reinterpret_cast<TaskStatus_t*>(records);
+        // the records are converted in place, so never collect more than the array can hold
+        // after the conversion, even when the caller's records are larger than the kernel's
+        const std::size_t max_status = std::min(max_records, (max_records * sizeof(T)) / sizeof(TaskStatus_t));
+
+        // the scheduler is suspended by the kernel only for the duration of this call
+        return uxTaskGetSystemState(status, max_status, total);
+    }
+
+    /// @brief  Converts the collected kernel records in place to the caller's record type.
+    template<typename T, class Converter>
+    static void convert_status(T *records, std::size_t count, Converter convert)
+    {
+        // each record is copied out before its place is overwritten
+        auto convert_at = [&](std::size_t i)
+        {
+            TaskStatus_t s;
+            std::memcpy(&s, reinterpret_cast<char*>(records) + i * sizeof(TaskStatus_t), sizeof(s));
+            T r = convert(s);
+            std::memcpy(&records[i], &r, sizeof(r));
+        };
+        if (sizeof(T) > sizeof(TaskStatus_t))
+        {
+            for (std::size_t i = count; i > 0; i--)
+            {
+                convert_at(i - 1);
+            }
+        }
+        else
+        {
+            for (std::size_t i = 0; i < count; i++)
+            {
+                convert_at(i);
+            }
+        }
+    }
+
+    static thread::state convert_state(eTaskState state)
+    {
+        switch (state)
+        {
+            case eTaskState::eRunning:
+                return thread::state::running;
+            case eTaskState::eReady:
+                return thread::state::ready;
+            case eTaskState::eBlocked:
+            case eTaskState::eSuspended:
+                return thread::state::suspended;
+            default:
+                return thread::state::terminated;
+        }
+    }
+
+    std::size_t scheduler::snapshot(thread_info *threads, std::size_t max_threads)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+
+        std::size_t count = collect_status(threads, max_threads, nullptr);
+        convert_status(threads, count, [](const TaskStatus_t& status)
+        {
+            thread_info info;
+            info.handle = reinterpret_cast<thread*>(status.xHandle);
+            info.name = status.pcTaskName;
+            info.id = status.xTaskNumber;
+            info.state = convert_state(status.eCurrentState);
+            info.priority = status.uxCurrentPriority;
+            info.base_priority = status.uxBasePriority;
+            info.stack_free = status.usStackHighWaterMark * sizeof(StackType_t);
+        #if (configGENERATE_RUN_TIME_STATS == 1)
+            info.run_time = runtime_clock::duration(status.ulRunTimeCounter);
+        #endif
+            return info;
+        });
+        return count;
+    }
+
+    static const scheduler::thread_info *find_info(const scheduler::thread_info& t,
+            const scheduler::thread_info *list, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            // the handle of a deleted thread can be reused, the id is unique
+            if ((list[i].handle == t.handle) && (list[i].id == t.id))
+            {
+                return &list[i];
+            }
+        }
+        return nullptr;
+    }
+
+    std::size_t scheduler::snapshot_diff(const thread_info *before, std::size_t before_count,
+            const thread_info *after, std::size_t after_count,
+            thread_change *changes, std::size_t max_changes)
+    {
+        std::size_t n = 0;
+        auto add = [&](thread_change::kind what, const thread_info *info, const thread_info *previous)
+        {
+            if (n < max_changes)
+            {
+                thread_change& c = changes[n++];
+                c.what = what;
+                c.info = info;
+                c.previous = previous;
+            #if (configGENERATE_RUN_TIME_STATS == 1)
+                if (previous != nullptr)
+                {
+                    c.run_time_delta = info->run_time - previous->run_time;
+                }
+                else if (what == thread_change::kind::created)
+                {
+                    c.run_time_delta = info->run_time;
+                }
+                else
+                {
+                    c.run_time_delta = runtime_clock::duration(0);
+                }
+            #endif
+            }
+        };
+
+        for (std::size_t i = 0; i < after_count; i++)
+        {
+            const thread_info& a = after[i];
+            const thread_info *b = find_info(a, before, before_count);
+            if (b == nullptr)
+            {
+                add(thread_change::kind::created, &a, nullptr);
+            }
+            else if ((a.state != b->state) || (a.priority != b->priority) ||
+                     (a.base_priority != b->base_priority) || (a.stack_free != b->stack_free)
+                #if (configGENERATE_RUN_TIME_STATS == 1)
+                     || (a.run_time != b->run_time)
+                #endif
+                    )
+            {
+                add(thread_change::kind::changed, &a, b);
+            }
+        }
+        for (std::size_t i = 0; i < before_count; i++)
+        {
+            if (find_info(before[i], after, after_count) == nullptr)
+            {
+                add(thread_change::kind::deleted, &before[i], nullptr);
+            }
+        }
+        return n;
+    }
+
+#endif // (configUSE_TRACE_FACILITY == 1)
+
+#if (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1)
+
+    static const scheduler::thread_usage *find_usage(thread *t,
+            const scheduler::thread_usage *list, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (list[i].handle == t)
+            {
+                return &list[i];
+            }
+        }
+        return nullptr;
+    }
+
+    static scheduler::thread_usage convert_usage(const TaskStatus_t& status,
+            const scheduler::cpu_usage& summary,
+            const scheduler::thread_usage *previous, std::size_t previous_count)
+    {
+        scheduler::thread_usage u;
+        u.handle = reinterpret_cast<thread*>(status.xHandle);
+        u.name = status.pcTaskName;
+        u.priority = status.uxCurrentPriority;
+        u.run_time = runtime_clock::duration(status.ulRunTimeCounter);
+        u.stack_free = status.usStackHighWaterMark * sizeof(StackType_t);
+
+        #ifdef configCONTEXT_SWITCH_COUNTER_INDEX
+            u.context_switches = u.handle->get_context_switches();
+        #else
+            u.context_switches = 0;
+        #endif
+
+        auto prev = find_usage(u.handle, previous, previous_count);
+        u.run_time_delta = (prev != nullptr) ? (u.run_time - prev->run_time) : u.run_time;
+
+        const auto capacity = summary.elapsed.count() * native::NUMBER_OF_CORES;
+        u.usage_permille = (capacity > 0) ?
+                static_cast<std::uint16_t>((std::uint64_t(u.run_time_delta.count()) * 1000) / capacity) : 0;
+        return u;
+    }
+
+    std::size_t scheduler::cpu_usage_snapshot(thread_usage *threads, std::size_t max_threads,
+            cpu_usage& summary,
+            const thread_usage *previous, std::size_t previous_count)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+        configASSERT((previous == nullptr) || (previous + previous_count <= threads)
+                || (threads + max_threads <= previous));
+
+        // the kernel records are placed in the caller's array, and converted in place
+        run_time_counter total;
+        std::size_t count = collect_status(threads, max_threads, &total);
+        if (count == 0)
+        {
+            return 0;
+        }
+        run_time_counter idle = ulTaskGetIdleRunTimeCounter();
+
+        summary.elapsed = runtime_clock::duration(total) - summary.total_time;
+        summary.idle_delta = runtime_clock::duration(idle) - summary.idle_time;
+        summary.total_time = runtime_clock::duration(total);
+        summary.idle_time = runtime_clock::duration(idle);
+        summary.threads_count = count;
+
+        convert_status(threads, count, [&](const TaskStatus_t& status)
+        {
+            return convert_usage(status, summary, previous, previous_count);
+        });
+        return count;
+    }
+
+#endif // (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1)
@@ -25,6 +25,7 @@
  */
 #include "freertos/semaphore.h"
 #include "freertos/cpu.h"
+#include "freertos/trace_recorder.h"
 #include <cstring>
 
 namespace freertos
@@ -37,6 +38,20 @@ namespace freertos
 using namespace freertos;
 using namespace freertos::native;
 
+// the wrappers add no data to the kernel object
+static_assert(sizeof(binary_semaphore) == sizeof(StaticSemaphore_t),
+        "The binary_semaphore wrapper must match the kernel object size.");
+#if (configUSE_COUNTING_SEMAPHORES == 1)
+static_assert(sizeof(counting_semaphore<>) == sizeof(StaticSemaphore_t),
+        "The counting_semaphore wrapper must match the kernel object size.");
+#endif // (configUSE_COUNTING_SEMAPHORES == 1)
+
+#if (configINLINE_WRAPPERS != 1)
+
+#include "freertos/impl/semaphore.inl"
+
+#endif // (configINLINE_WRAPPERS != 1)
+
 #if 0 // doesn't seem like a good idea
 semaphore::semaphore(semaphore&& other)
 {
@@ -55,54 +70,9 @@ semaphore& semaphore::operator=(semaphore&& other)
 }
 #endif
 
-bool semaphore::take(tick_timer::duration timeout)
-{
-    if (!this_cpu::is_in_isr())
-    {
-        return xSemaphoreTake(handle(), to_ticks(timeout));
-    }
-    else
-    {
-        // cannot wait in ISR
-        configASSERT(to_ticks(timeout) == 0);
-
-        BaseType_t needs_yield = false;
-        bool success = xSemaphoreTakeFromISR(handle(), &needs_yield);
-        portYIELD_FROM_ISR(needs_yield);
-        return success;
-    }
-}
-
-bool semaphore::give(count_type update)
-{
-    // the API only allows giving a single count
-    if (!this_cpu::is_in_isr())
-    {
-        bool success = true;
-        while (success && (update > 0))
-        {
-            success = xSemaphoreGive(handle());
-            update--;
-        }
-        return success;
-    }
-    else
-    {
-        BaseType_t needs_yield = false;
-        bool success = true;
-        while (success && (update > 0))
-        {
-            success = xSemaphoreGiveFromISR(handle(), &needs_yield);
-            update--;
-        }
-        portYIELD_FROM_ISR(needs_yield);
-        return success;
-    }
-}
-
 thread *semaphore::get_mutex_holder() const
 {
-    if (!this_cpu::is_in_isr())
+    if (!this_cpu::uses_isr_api())
     {
         return reinterpret_cast<thread*>(xSemaphoreGetMutexHolder(handle()));
     }
@@ -0,0 +1,268 @@
+/**
+ * @file      stack_monitor.cpp
+ * @brief     Stack high-water mark monitoring and stack size recommendations
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/stack_monitor.h"
+#include "freertos/cpu.h"
+#include "freertos/scheduler.h"
+#include <cstring>
+
+#if (configUSE_TRACE_FACILITY == 1) && (INCLUDE_uxTaskGetStackHighWaterMark == 1)
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+stack_monitor_base::entry *stack_monitor_base::find(const thread *t) const
+{
+    for (std::size_t i = 0; i < count_; i++)
+    {
+        if (entries_[i].handle == t)
+        {
+            return &entries_[i];
+        }
+    }
+    return nullptr;
+}
+
+void stack_monitor_base::record(entry *e, std::size_t min_free)
+{
+    if (min_free < e->min_free)
+    {
+        e->min_free = min_free;
+    }
+    history_[(e - entries_) * depth_ + (e->samples % depth_)] = min_free;
+    e->samples++;
+}
+
+void stack_monitor_base::remove(std::size_t index)
+{
+    count_--;
+    if (index != count_)
+    {
+        entries_[index] = entries_[count_];
+        for (std::size_t i = 0; i < depth_; i++)
+        {
+            history_[index * depth_ + i] = history_[count_ * depth_ + i];
+        }
+    }
+}
+
+std::size_t stack_monitor_base::scan()
+{
+    static_assert(sizeof(TaskStatus_t) <= STATUS_RECORD_SIZE,
+            "The status record size bound must be increased.");
+    static_assert(alignof(TaskStatus_t) <= alignof(std::uint64_t),
+            "The status record alignment must be increased.");
+    configASSERT(!this_cpu::is_in_isr());
+
+    // the kernel computes the high-water mark of each thread
+    TaskStatus_t *status = reinterpret_cast<TaskStatus_t*>(scratch_);
+    std::size_t n = uxTaskGetSystemState(status, max_threads_, nullptr);
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    for (std::size_t i = 0; i < count_; i++)
+    {
+        entries_[i].seen = false;
+    }
+    for (std::size_t i = 0; i < n; i++)
+    {
+        entry *e = find(reinterpret_cast<thread*>(status[i].xHandle));
+        if (e != nullptr)
+        {
+            e->seen = true;
+            record(e, status[i].usStackHighWaterMark * sizeof(StackType_t));
+        }
+    }
+
+    // the deleted threads' entries are freed up before the new threads are added
+    for (std::size_t i = count_; i > 0; i--)
+    {
+        if (!entries_[i - 1].seen)
+        {
+            remove(i - 1);
+        }
+    }
+    for (std::size_t i = 0; i < n; i++)
+    {
+        thread *t = reinterpret_cast<thread*>(status[i].xHandle);
+        if (find(t) != nullptr)
+        {
+            continue;
+        }
+        if (count_ == max_threads_)
+        {
+            // cannot happen, as the kernel reported at most max_threads_ threads
+            configASSERT(false);
+            break;
+        }
+        entry *e = &entries_[count_++];
+        e->handle = t;
+        // the kernel's name string is freed along with the thread
+        std::strncpy(e->name, status[i].pcTaskName, sizeof(e->name) - 1);
+        e->name[sizeof(e->name) - 1] = '\0';
+        e->min_free = static_cast<std::size_t>(-1);
+        e->samples = 0;
+        e->seen = true;
+        record(e, status[i].usStackHighWaterMark * sizeof(StackType_t));
+    }
+    return count_;
+}
+
+void stack_monitor_base::poll()
+{
+    bool round_done = false;
+    {
+        // a thread can't be deleted, nor its memory freed by the idle thread,
+        // while the scheduler is suspended
+        scheduler::critical_section sched;
+        const lock_guard<decltype(sched)> sched_lock(sched);
+
+        thread *t = nullptr;
+        {
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            if (cursor_ < count_)
+            {
+                t = entries_[cursor_++].handle;
+            }
+            else
+            {
+                cursor_ = 0;
+                round_done = true;
+            }
+        }
+        if (t != nullptr)
+        {
+            // the stack is inspected outside of the interrupt critical section
+            std::size_t min_free = uxTaskGetStackHighWaterMark(reinterpret_cast<TaskHandle_t>(t)) * sizeof(StackType_t);
+
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            entry *e = find(t);
+            if (e != nullptr)
+            {
+                record(e, min_free);
+            }
+        }
+    }
+    if (round_done)
+    {
+        (void)scan();
+    }
+}
+
+void stack_monitor_base::forget(const thread *t)
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    entry *e = find(t);
+    if (e != nullptr)
+    {
+        remove(e - entries_);
+    }
+}
+
+std::size_t stack_monitor_base::report(stack_usage *usage, std::size_t max_count) const
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    std::size_t n = (count_ < max_count) ? count_ : max_count;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const entry& e = entries_[i];
+        usage[i].handle = e.handle;
+        std::memcpy(usage[i].name, e.name, sizeof(usage[i].name));
+        usage[i].min_free = e.min_free;
+        usage[i].reclaimable = (e.min_free > margin_) ? (e.min_free - margin_) : 0;
+        usage[i].at_risk = e.min_free < margin_;
+    }
+    return n;
+}
+
+std::size_t stack_monitor_base::get_history(const thread *t, std::size_t *history, std::size_t max_count) const
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    entry *e = find(t);
+    if (e == nullptr)
+    {
+        return 0;
+    }
+    const std::size_t *row = &history_[(e - entries_) * depth_];
+    std::size_t n = (e->samples < depth_) ? e->samples : depth_;
+    std::size_t first = (e->samples < depth_) ? 0 : (e->samples % depth_);
+    if (n > max_count)
+    {
+        // keep the newest samples
+        first = (first + n - max_count) % depth_;
+        n = max_count;
+    }
+    for (std::size_t i = 0; i < n; i++)
+    {
+        history[i] = row[(first + i) % depth_];
+    }
+    return n;
+}
+
+bool stack_monitor_base::any_at_risk() const
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    for (std::size_t i = 0; i < count_; i++)
+    {
+        if (entries_[i].min_free < margin_)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t stack_monitor_base::recommend_stack_size(std::size_t stacksize, const stack_usage& usage) const
+{
+    std::size_t used = (stacksize > usage.min_free) ? (stacksize - usage.min_free) : 0;
+    std::size_t size = used + margin_;
+    return (size + sizeof(StackType_t) - 1) / sizeof(StackType_t) * sizeof(StackType_t);
+}
+
+#endif // (configUSE_TRACE_FACILITY == 1) && (INCLUDE_uxTaskGetStackHighWaterMark == 1)
@@ -26,7 +26,9 @@
 #include "freertos/thread.h"
 #include "freertos/cpu.h"
 #include "freertos/scheduler.h"
-#include "freertos/condition_flags.h"
+#include "freertos/thread_local.h"
+#include "freertos/trace_recorder.h"
+#include <new>
 
 namespace freertos
 {
@@ -38,6 +40,9 @@ namespace freertos
 using namespace freertos;
 using namespace freertos::native;
 
+// the wrapper adds no data to the kernel object
+static_assert(sizeof(thread) == sizeof(StaticTask_t), "The thread wrapper must match the kernel object size.");
+
 #if configTASK_RETURN_ADDRESS != vTaskExitHandler
 #error "Ensure that FreeRTOSConfig.h contains: #define configTASK_RETURN_ADDRESS vTaskExitHandler"
 #endif
@@ -45,34 +50,59 @@ using namespace freertos::native;
 /// @brief  The thread's execution enters this function when the thread function returns.
 extern "C" void vTaskExitHandler(void)
 {
+    #if (configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0)
+
+        // destroy the thread local objects
+        thread_local_storage::destroy_all();
+
+    #endif // (configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0)
+
     thread *t = thread::get_current();
     // call destructor
     t->~thread();
 }
 
+#ifdef configCONTEXT_SWITCH_COUNTER_INDEX
+
+    #if (configNUM_THREAD_LOCAL_STORAGE_POINTERS <= configCONTEXT_SWITCH_COUNTER_INDEX)
+    #error "Context switch counter storage must be allowed."
+    #endif
+
+    /// @brief  Counts the context switches of each thread,
+    ///         call it from the traceTASK_SWITCHED_IN() macro.
+    extern "C" void vTaskSwitchedInHook(void)
+    {
+        TaskHandle_t t = xTaskGetCurrentTaskHandle();
+        std::uintptr_t count = reinterpret_cast<std::uintptr_t>(
+                pvTaskGetThreadLocalStoragePointer(t, configCONTEXT_SWITCH_COUNTER_INDEX));
+        vTaskSetThreadLocalStoragePointer(t, configCONTEXT_SWITCH_COUNTER_INDEX,
+                reinterpret_cast<void*>(count + 1));
+    }
+
+    std::size_t thread::get_context_switches() const
+    {
+        return reinterpret_cast<std::uintptr_t>(
+                pvTaskGetThreadLocalStoragePointer(handle(), configCONTEXT_SWITCH_COUNTER_INDEX));
+    }
+
+#endif // configCONTEXT_SWITCH_COUNTER_INDEX
+
+#ifdef configTHREAD_ALLOCATOR_INDEX
+
+    static void reclaim_thread_blocks(TaskHandle_t deleted);
+
+#endif // configTHREAD_ALLOCATOR_INDEX
+
 thread::~thread()
 {
     signal_exit();
 
     vTaskDelete(handle());
-}
-
-void thread::signal_exit()
-{
-    #ifdef configTHREAD_EXIT_CONDITION_INDEX
-
-        cpu::critical_section cs;
-        const lock_guard<decltype(cs)> lock(cs);
-
-        auto cond = get_exit_condition();
-        // at task creation, this pointer is set to NULL
-        if (cond != nullptr)
-        {
-            // if there is, signal it
-            cond->set(cflag::max());
-        }
 
-    #endif // configTHREAD_EXIT_CONDITION_INDEX
+#ifdef configTHREAD_ALLOCATOR_INDEX
+    // when another thread is deleted, the kernel has finished with it by now
+    reclaim_thread_blocks(nullptr);
+#endif
 }
 
 #ifdef configTHREAD_EXIT_CONDITION_INDEX
@@ -81,41 +111,183 @@ void thread::signal_exit()
     #error "Thread exit condition storage must be allowed."
     #endif
 
-    condition_flags *thread::get_exit_condition() const
-     {
-        return reinterpret_cast<condition_flags*>(
+    #if (configUSE_TASK_NOTIFICATIONS != 1)
+    #error "Thread exit signalling requires task notifications."
+    #endif
+
+    /// @brief  Placed on the joiner's stack, and referenced by each joined thread.
+    struct thread::join_record
+    {
+        thread *joiner;
+        thread *const *threads;
+        std::size_t count;
+        volatile std::uint32_t exited;
+    };
+
+    // the exit condition of a thread that has exited without a joiner points here
+    static char exited_unjoined;
+
+    thread::join_record *thread::get_join_record() const
+    {
+        return reinterpret_cast<join_record*>(
                 pvTaskGetThreadLocalStoragePointer(handle(),
                         configTHREAD_EXIT_CONDITION_INDEX));
     }
 
-    void thread::set_exit_condition(condition_flags *cond)
+    bool thread::joinable() const
     {
-        configASSERT(nullptr == get_exit_condition()); // cannot have multiple threads joining
-        vTaskSetThreadLocalStoragePointer(handle(),
-                configTHREAD_EXIT_CONDITION_INDEX, reinterpret_cast<void*>(cond));
+        return (get_state() != state::terminated) && (nullptr == get_join_record());
     }
 
-    bool thread::joinable() const
+    std::uint32_t thread::join_threads(thread *const *threads, std::size_t count,
+            bool join_all, const tick_timer::duration& rel_time)
     {
-        return (get_state() != state::terminated) && (nullptr == get_exit_condition());
+        configASSERT(!this_cpu::is_in_isr());
+        configASSERT((count > 0) && (count <= 32));
+
+        join_record record;
+        record.joiner = get_current();
+        record.threads = threads;
+        record.count = count;
+        record.exited = 0;
+        const std::uint32_t all = (count < 32) ? ((1UL << count) - 1) : ~0UL;
+
+        // discard any leftover signal from a previous wait
+        (void)record.joiner->get_wakeup_notifier().cancel_signal();
+        {
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            for (std::size_t i = 0; i < count; i++)
+            {
+                configASSERT(threads[i]->get_id() != record.joiner->get_id()); // else resource_deadlock_would_occur
+
+                const void *condition = threads[i]->get_join_record();
+                if ((condition == &exited_unjoined) || (threads[i]->get_state() == state::terminated))
+                {
+                    // the thread has already exited, its exit won't be signalled
+                    record.exited = record.exited | (1UL << i);
+                }
+                else
+                {
+                    configASSERT(nullptr == condition); // cannot have multiple threads joining
+
+                    vTaskSetThreadLocalStoragePointer(threads[i]->handle(),
+                            configTHREAD_EXIT_CONDITION_INDEX, reinterpret_cast<void*>(&record));
+                }
+            }
+        }
+
+        // wait for signal from thread exit
+        const auto start = tick_timer::now();
+        auto remaining = rel_time;
+        while (join_all ? (record.exited != all) : (record.exited == 0))
+        {
+            (void)this_thread::wait_wakeup_for(remaining);
+
+            if (rel_time != infinity)
+            {
+                const auto elapsed = tick_timer::now() - start;
+                if (elapsed >= rel_time)
+                {
+                    break;
+                }
+                remaining = rel_time - elapsed;
+            }
+        }
+
+        std::uint32_t exited;
+        {
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            // the exited threads may have been deleted already,
+            // the others are still alive, so the record can be removed from them
+            exited = record.exited;
+            for (std::size_t i = 0; i < count; i++)
+            {
+                if ((exited & (1UL << i)) == 0)
+                {
+                    vTaskSetThreadLocalStoragePointer(threads[i]->handle(),
+                            configTHREAD_EXIT_CONDITION_INDEX, nullptr);
+                }
+            }
+        }
+        return exited;
     }
 
     void thread::join()
     {
         configASSERT(joinable()); // else invalid_argument
-        configASSERT(this->get_id() != freertos::this_thread::get_id()); // else resource_deadlock_would_occur
 
-        condition_flags exit_cond;
-        set_exit_condition(&exit_cond);
-
-        // wait for signal from thread exit
-        exit_cond.shared_wait_any_for(cflag::max(), infinity);
+        thread *const self = this;
+        (void)join_threads(&self, 1, true, infinity);
 
         // signal received, thread is deleted, return
     }
 
+    bool thread::join_for(const tick_timer::duration& rel_time)
+    {
+        configASSERT(joinable()); // else invalid_argument
+
+        thread *const self = this;
+        return join_threads(&self, 1, true, rel_time) != 0;
+    }
+
+    std::size_t thread::join_any(thread *const *threads, std::size_t count,
+            const tick_timer::duration& rel_time)
+    {
+        std::uint32_t exited = join_threads(threads, count, false, rel_time);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if ((exited & (1UL << i)) != 0)
+            {
+                return i;
+            }
+        }
+        return count;
+    }
+
+    bool thread::join_all(thread *const *threads, std::size_t count,
+            const tick_timer::duration& rel_time)
+    {
+        const std::uint32_t all = (count < 32) ? ((1UL << count) - 1) : ~0UL;
+        return join_threads(threads, count, true, rel_time) == all;
+    }
+
 #endif // configTHREAD_EXIT_CONDITION_INDEX
 
+void thread::signal_exit()
+{
+    #ifdef configTHREAD_EXIT_CONDITION_INDEX
+
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        auto record = get_join_record();
+        // at task creation, this pointer is set to NULL
+        if (record == nullptr)
+        {
+            // a joiner that comes before the deletion mustn't wait for the signal
+            vTaskSetThreadLocalStoragePointer(handle(),
+                    configTHREAD_EXIT_CONDITION_INDEX, reinterpret_cast<void*>(&exited_unjoined));
+        }
+        else
+        {
+            // if there is, mark the exit and wake the joiner
+            for (std::size_t i = 0; i < record->count; i++)
+            {
+                if (record->threads[i] == this)
+                {
+                    record->exited = record->exited | (1UL << i);
+                }
+            }
+            record->joiner->get_wakeup_notifier().signal();
+        }
+
+    #endif // configTHREAD_EXIT_CONDITION_INDEX
+}
+
 void thread::suspend()
 {
     configASSERT(!this_cpu::is_in_isr());
@@ -126,7 +298,7 @@ void thread::suspend()
 
 void thread::resume()
 {
-    if (!this_cpu::is_in_isr())
+    if (!this_cpu::uses_isr_api())
     {
         vTaskResume(handle());
     }
@@ -139,7 +311,7 @@ void thread::resume()
 
 thread::priority thread::get_priority() const
 {
-    if (!this_cpu::is_in_isr())
+    if (!this_cpu::uses_isr_api())
     {
         return uxTaskPriorityGet(handle());
     }
@@ -157,10 +329,44 @@ void thread::set_priority(priority prio)
     }
 }
 
+thread::affinity_mask thread::get_affinity() const
+{
+    configASSERT(!this_cpu::is_in_isr());
+    #if (configNUMBER_OF_CORES > 1) && (configUSE_CORE_AFFINITY == 1)
+    {
+        return vTaskCoreAffinityGet(handle());
+    }
+    #else
+    {
+        return (1 << native::NUMBER_OF_CORES) - 1;
+    }
+    #endif
+}
+
+void thread::set_affinity(affinity_mask cores)
+{
+    configASSERT(!this_cpu::is_in_isr());
+    #if (configNUMBER_OF_CORES > 1) && (configUSE_CORE_AFFINITY == 1)
+    {
+        vTaskCoreAffinitySet(handle(), cores);
+    }
+    #elif (configNUMBER_OF_CORES > 1)
+    {
+        // the kernel doesn't support affinity, the thread may run on any core
+        (void)cores;
+    }
+    #else
+    {
+        configASSERT((cores & 1) != 0);
+        (void)cores;
+    }
+    #endif
+}
+
 thread::id thread::get_id() const
 {
 #if (configUSE_TRACE_FACILITY == 1)
-    return priv::uxTaskGetTaskNumber(handle());
+    return uxTaskGetTaskNumber(handle());
 #else
     return id(this);
 #endif // (configUSE_TRACE_FACILITY == 1)
@@ -198,6 +404,25 @@ thread::state thread::get_state() const
     }
 }
 
+#if (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1)
+
+    runtime_clock::duration thread::get_cpu_time() const
+    {
+        configASSERT(!this_cpu::is_in_isr());
+
+        TaskStatus_t status;
+        // skip the costly stack high water mark calculation
+        vTaskGetInfo(handle(), &status, pdFALSE, eInvalid);
+        return runtime_clock::duration(status.ulRunTimeCounter);
+    }
+
+    runtime_clock::duration this_thread::get_cpu_time()
+    {
+        return thread::get_current()->get_cpu_time();
+    }
+
+#endif // (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1)
+
 thread* thread::get_current()
 {
     configASSERT(!this_cpu::is_in_isr());
@@ -221,6 +446,119 @@ thread* thread::get_current()
 
 #endif // (configSUPPORT_DYNAMIC_ALLOCATION == 1)
 
+#ifdef configTHREAD_ALLOCATOR_INDEX
+
+    #if (configNUM_THREAD_LOCAL_STORAGE_POINTERS <= configTHREAD_ALLOCATOR_INDEX)
+    #error "Thread allocator storage must be allowed."
+    #endif
+
+    namespace
+    {
+        struct block_header
+        {
+            thread::deallocator dealloc;
+            void *allocator;
+            std::size_t size;
+            block_header *next;
+            TaskHandle_t cleaner;
+        };
+
+        // the blocks of the deleted threads, which the kernel might still access
+        block_header *cleaned_blocks = nullptr;
+    }
+
+    /// @brief  Returns the blocks to their allocators that were cleaned up by the current task,
+    ///         or by the thread that is being deleted. The kernel accesses the control block
+    ///         after the clean up hook, but it's done with it by the time the same task proceeds.
+    static void reclaim_thread_blocks(TaskHandle_t deleted)
+    {
+        const TaskHandle_t current = xTaskGetCurrentTaskHandle();
+        block_header *reclaimed = nullptr;
+        {
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            for (block_header **ph = &cleaned_blocks; *ph != nullptr; )
+            {
+                block_header *header = *ph;
+                if ((header->cleaner == current) || (header->cleaner == deleted))
+                {
+                    *ph = header->next;
+                    header->next = reclaimed;
+                    reclaimed = header;
+                }
+                else
+                {
+                    ph = &header->next;
+                }
+            }
+        }
+
+        while (reclaimed != nullptr)
+        {
+            block_header *header = reclaimed;
+            reclaimed = header->next;
+            header->dealloc(header->allocator, header, header->size);
+        }
+    }
+
+    /// @brief  Queues the single block allocated threads' memory to be returned to their allocator,
+    ///         call it from the portCLEAN_UP_TCB() macro. The block is returned when the cleaning
+    ///         task proceeds: at its next clean up, or its next @ref vTaskReclaimHook call.
+    extern "C" void vTaskCleanUpHook(void *tcb)
+    {
+        // this task's previous clean ups have completed, and a thread that is being deleted
+        // cannot be in the middle of one
+        reclaim_thread_blocks(reinterpret_cast<TaskHandle_t>(tcb));
+
+        auto header = reinterpret_cast<block_header*>(pvTaskGetThreadLocalStoragePointer(
+                reinterpret_cast<TaskHandle_t>(tcb), configTHREAD_ALLOCATOR_INDEX));
+        if (header != nullptr)
+        {
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            header->cleaner = xTaskGetCurrentTaskHandle();
+            header->next = cleaned_blocks;
+            cleaned_blocks = header;
+        }
+    }
+
+    /// @brief  Returns the memory of the threads that the idle thread has cleaned up,
+    ///         call it from vApplicationIdleHook().
+    extern "C" void vTaskReclaimHook(void)
+    {
+        reclaim_thread_blocks(nullptr);
+    }
+
+    thread *thread::construct(void *block, std::size_t size,
+            deallocator dealloc, void *allocator,
+            function func, void *param, std::size_t stacksize,
+            priority prio, const char *name)
+    {
+        static_assert(sizeof(block_header) <= BLOCK_HEADER_SIZE, "The block header doesn't fit.");
+        configASSERT(size >= allocation_size(stacksize));
+
+        auto header = ::new (block) block_header();
+        header->dealloc = dealloc;
+        header->allocator = allocator;
+        header->size = size;
+
+        auto tcb = reinterpret_cast<unsigned char*>(block) + BLOCK_HEADER_SIZE;
+        auto stack = reinterpret_cast<StackType_t*>(tcb + align(sizeof(StaticTask_t)));
+
+        // the thread may not run before its block is registered
+        vTaskSuspendAll();
+        thread *t = ::new (tcb) thread(stack, stacksize / sizeof(StackType_t),
+                func, param, prio, name);
+        vTaskSetThreadLocalStoragePointer(t->handle(), configTHREAD_ALLOCATOR_INDEX, header);
+        (void)xTaskResumeAll();
+
+        return t;
+    }
+
+#endif // configTHREAD_ALLOCATOR_INDEX
+
 thread::thread(StackType_t *pstack ,std::uint32_t stack_size,
         function func, void *param, priority prio, const char *name)
 {
@@ -232,31 +570,45 @@ thread::thread(StackType_t *pstack ,std::uint32_t stack_size,
 
     bool thread::notifier::notify(unsigned action, notify_value value)
     {
-        if (!this_cpu::is_in_isr())
+        if (!this_cpu::uses_isr_api())
         {
-            return
-            #if (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
-                xTaskNotifyAndQueryIndexed(handle(), index_
-            #else
-                xTaskNotifyAndQuery(handle()
-            #endif // (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
-                    , value, static_cast<eNotifyAction>(action), &last_value_);
+            return notify(thread_context, action, value);
         }
         else
         {
-            BaseType_t needs_yield = false;
-            bool success =
-            #if (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
-                xTaskNotifyAndQueryIndexedFromISR(handle(), index_
-            #else
-                xTaskNotifyAndQueryFromISR(handle()
-            #endif // (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
-                    , value, static_cast<eNotifyAction>(action), &last_value_, &needs_yield);
-            portYIELD_FROM_ISR(needs_yield);
-            return success;
+            return notify(isr_context, action, value);
         }
     }
 
+    bool thread::notifier::notify(thread_context_t, unsigned action, notify_value value)
+    {
+        trace_recorder::api_call(trace_recorder::api::thread_notify, thread_);
+
+        return
+        #if (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
+            xTaskNotifyAndQueryIndexed(handle(), index_
+        #else
+            xTaskNotifyAndQuery(handle()
+        #endif // (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
+                , value, static_cast<eNotifyAction>(action), &last_value_);
+    }
+
+    bool thread::notifier::notify(isr_context_t, unsigned action, notify_value value)
+    {
+        trace_recorder::api_call(trace_recorder::api::thread_notify, thread_);
+
+        BaseType_t needs_yield = false;
+        bool success =
+        #if (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
+            xTaskNotifyAndQueryIndexedFromISR(handle(), index_
+        #else
+            xTaskNotifyAndQueryFromISR(handle()
+        #endif // (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
+                , value, static_cast<eNotifyAction>(action), &last_value_, &needs_yield);
+        portYIELD_FROM_ISR(needs_yield);
+        return success;
+    }
+
     void thread::notifier::signal()
     {
         notify(eNoAction, 0);
@@ -306,6 +658,74 @@ thread::thread(StackType_t *pstack ,std::uint32_t stack_size,
         notify(eSetValueWithOverwrite, new_value);
     }
 
+    void thread::notifier::signal(thread_context_t ctx)
+    {
+        notify(ctx, eNoAction, 0);
+    }
+
+    void thread::notifier::signal(isr_context_t ctx)
+    {
+        notify(ctx, eNoAction, 0);
+    }
+
+    void thread::notifier::increment(thread_context_t ctx)
+    {
+        notify(ctx, eIncrement, 0);
+    }
+
+    void thread::notifier::increment(isr_context_t ctx)
+    {
+        notify(ctx, eIncrement, 0);
+    }
+
+    void thread::notifier::set_flags(thread_context_t ctx, notify_value flags)
+    {
+        notify(ctx, eSetBits, flags);
+    }
+
+    void thread::notifier::set_flags(isr_context_t ctx, notify_value flags)
+    {
+        notify(ctx, eSetBits, flags);
+    }
+
+    bool thread::notifier::try_set_value(thread_context_t ctx, notify_value new_value)
+    {
+        return notify(ctx, eSetValueWithoutOverwrite, new_value);
+    }
+
+    bool thread::notifier::try_set_value(isr_context_t ctx, notify_value new_value)
+    {
+        return notify(ctx, eSetValueWithoutOverwrite, new_value);
+    }
+
+    void thread::notifier::set_value(thread_context_t ctx, notify_value new_value)
+    {
+        notify(ctx, eSetValueWithOverwrite, new_value);
+    }
+
+    void thread::notifier::set_value(isr_context_t ctx, notify_value new_value)
+    {
+        notify(ctx, eSetValueWithOverwrite, new_value);
+    }
+
+    thread::notifier thread::get_wakeup_notifier()
+    {
+        #if (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
+            return notifier(*this, configWAKEUP_NOTIFICATION_INDEX);
+        #else
+            return notifier(*this);
+        #endif // (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
+    }
+
+    bool this_thread::wait_wakeup_for(const tick_timer::duration& rel_time)
+    {
+        #if (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
+            return wait_signal_for(configWAKEUP_NOTIFICATION_INDEX, rel_time);
+        #else
+            return wait_signal_for(rel_time);
+        #endif // (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
+    }
+
     bool this_thread::wait_notification_for(const tick_timer::duration& rel_time,
             thread::notify_value *value,
             thread::notify_value clear_flags_before, thread::notify_value clear_flags_after)
@@ -366,3 +786,20 @@ void this_thread::sleep_for(tick_timer::duration rel_time)
 
     native::vTaskDelay(to_ticks(rel_time));
 }
+
+void this_thread::sleep_until(const tick_timer::time_point& abs_time)
+{
+    configASSERT(!this_cpu::is_in_isr());
+    configASSERT(scheduler::get_state() == scheduler::state::running);
+
+    // the wakeup time is calculated from the reference point instead of the current tick,
+    // so a tick elapsing before the call doesn't extend the delay
+    TickType_t reference = xTaskGetTickCount();
+    const TickType_t increment = to_ticks(abs_time) - reference;
+
+    // deadlines in the past appear as more than half of the tick range ahead
+    if ((increment > 0) && (increment <= (infinite_delay / 2)))
+    {
+        (void)xTaskDelayUntil(&reference, increment);
+    }
+}
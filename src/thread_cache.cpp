@@ -0,0 +1,218 @@
+/**
+ * @file      thread_cache.cpp
+ * @brief     Cache of recyclable dynamically allocated threads
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/thread_cache.h"
+#include "freertos/cpu.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+#if (configSUPPORT_DYNAMIC_ALLOCATION == 1) && (configUSE_TASK_NOTIFICATIONS == 1)
+
+    void thread_cache_base::work(entry *e)
+    {
+        {
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            // the entry stays reserved until the thread is registered in it
+            e->handle = thread::get_current();
+        }
+
+        for (;;)
+        {
+            thread::function func;
+            void *param;
+            {
+                cpu::critical_section cs;
+                const lock_guard<decltype(cs)> lock(cs);
+
+                func = e->func;
+                param = e->param;
+            }
+
+            if (func == nullptr)
+            {
+                // parked, wait for the next assignment
+                (void)this_thread::wait_wakeup_for(infinity);
+                continue;
+            }
+
+            func(param);
+
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            e->func = nullptr;
+            e->busy = false;
+        }
+    }
+
+    thread *thread_cache_base::spawn(thread::function func, void *param,
+            std::size_t stacksize, thread::priority prio, const char *name)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+        configASSERT(func != nullptr);
+
+        entry *reuse = nullptr;
+        entry *empty = nullptr;
+        {
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            // select the parked thread with the smallest sufficient stack
+            for (std::size_t i = 0; i < count_; i++)
+            {
+                entry *e = &entries_[i];
+                if (e->handle == nullptr)
+                {
+                    if ((empty == nullptr) && !e->busy)
+                    {
+                        empty = e;
+                    }
+                }
+                else if (!e->busy && (e->stacksize >= stacksize) &&
+                        ((reuse == nullptr) || (e->stacksize < reuse->stacksize)))
+                {
+                    reuse = e;
+                }
+            }
+
+            entry *selected = (reuse != nullptr) ? reuse : empty;
+            if (selected == nullptr)
+            {
+                stats_.failed++;
+                return nullptr;
+            }
+            // reserve the entry
+            selected->busy = true;
+        }
+
+        if (reuse != nullptr)
+        {
+            thread *t = reuse->handle;
+            if (t->get_priority() != prio)
+            {
+                t->set_priority(prio);
+            }
+            {
+                cpu::critical_section cs;
+                const lock_guard<decltype(cs)> lock(cs);
+
+                reuse->func = func;
+                reuse->param = param;
+                stats_.reused++;
+            }
+            t->get_wakeup_notifier().signal();
+            return t;
+        }
+
+        // the job is assigned before the thread exists, so it starts executing right away
+        empty->stacksize = stacksize;
+        empty->func = func;
+        empty->param = param;
+        thread *t = make_thread(reinterpret_cast<thread::function>(&work),
+                reinterpret_cast<void*>(empty), stacksize, prio, name);
+
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        if (t == nullptr)
+        {
+            empty->func = nullptr;
+            empty->busy = false;
+            stats_.failed++;
+            return nullptr;
+        }
+        stats_.created++;
+        return t;
+    }
+
+    std::size_t thread_cache_base::trim(std::size_t keep)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+
+        std::size_t deleted = 0;
+        for (std::size_t i = 0; i < count_; i++)
+        {
+            entry *e = &entries_[i];
+            thread *t = nullptr;
+            {
+                cpu::critical_section cs;
+                const lock_guard<decltype(cs)> lock(cs);
+
+                if ((e->handle != nullptr) && !e->busy)
+                {
+                    if (keep > 0)
+                    {
+                        keep--;
+                        continue;
+                    }
+                    t = e->handle;
+                    e->handle = nullptr;
+                }
+            }
+            if (t != nullptr)
+            {
+                // the parked thread is blocked waiting, it can be deleted safely
+                t->~thread();
+                deleted++;
+            }
+        }
+        return deleted;
+    }
+
+    std::size_t thread_cache_base::get_parked_count() const
+    {
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < count_; i++)
+        {
+            if ((entries_[i].handle != nullptr) && !entries_[i].busy)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    thread_cache_base::statistics thread_cache_base::get_statistics() const
+    {
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        return stats_;
+    }
+
+#endif // (configSUPPORT_DYNAMIC_ALLOCATION == 1) && (configUSE_TASK_NOTIFICATIONS == 1)
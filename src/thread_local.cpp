@@ -0,0 +1,155 @@
+/**
+ * @file      thread_local.cpp
+ * @brief     Typed thread-local storage slots built on the FreeRTOS TLS pointers
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/thread_local.h"
+#include "freertos/cpu.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+#if (configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0)
+
+    static_assert(thread_local_storage::SLOTS <= 32, "The slot allocation mask is limited to 32 slots.");
+
+    // the slots that are used internally by the library
+    static constexpr std::uint32_t reserved_slots()
+    {
+        return 0
+        #ifdef configTHREAD_EXIT_CONDITION_INDEX
+            | (1UL << configTHREAD_EXIT_CONDITION_INDEX)
+        #endif
+        #ifdef configCONTEXT_SWITCH_COUNTER_INDEX
+            | (1UL << configCONTEXT_SWITCH_COUNTER_INDEX)
+        #endif
+        #ifdef configTHREAD_ALLOCATOR_INDEX
+            | (1UL << configTHREAD_ALLOCATOR_INDEX)
+        #endif
+            ;
+    }
+
+    static std::uint32_t allocated_slots = reserved_slots();
+    static thread_local_storage::destructor slot_destructors[thread_local_storage::SLOTS];
+
+    thread_local_storage::index_type thread_local_storage::allocate(destructor dtor)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        for (index_type i = 0; i < SLOTS; i++)
+        {
+            if ((allocated_slots & (1UL << i)) == 0)
+            {
+                allocated_slots |= 1UL << i;
+                slot_destructors[i] = dtor;
+                return i;
+            }
+        }
+        return INVALID_INDEX;
+    }
+
+    bool thread_local_storage::allocate(index_type index, destructor dtor)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+        configASSERT((index >= 0) && (index < SLOTS));
+
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        if ((allocated_slots & (1UL << index)) != 0)
+        {
+            return false;
+        }
+        allocated_slots |= 1UL << index;
+        slot_destructors[index] = dtor;
+        return true;
+    }
+
+    void thread_local_storage::release(index_type index)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+        configASSERT((index >= 0) && (index < SLOTS));
+        configASSERT((reserved_slots() & (1UL << index)) == 0);
+
+        cpu::critical_section cs;
+        const lock_guard<decltype(cs)> lock(cs);
+
+        allocated_slots &= ~(1UL << index);
+        slot_destructors[index] = nullptr;
+    }
+
+    void *thread_local_storage::get(index_type index)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+        return pvTaskGetThreadLocalStoragePointer(nullptr, index);
+    }
+
+    void *thread_local_storage::get(const thread& t, index_type index)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+        return pvTaskGetThreadLocalStoragePointer(
+                reinterpret_cast<TaskHandle_t>(const_cast<thread*>(&t)), index);
+    }
+
+    void thread_local_storage::set(index_type index, void *value)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+        vTaskSetThreadLocalStoragePointer(nullptr, index, value);
+    }
+
+    void thread_local_storage::set(thread& t, index_type index, void *value)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+        vTaskSetThreadLocalStoragePointer(reinterpret_cast<TaskHandle_t>(&t), index, value);
+    }
+
+    void thread_local_storage::destroy_all()
+    {
+        for (index_type i = 0; i < SLOTS; i++)
+        {
+            // the slot may be released concurrently, read the callback only once
+            destructor dtor = slot_destructors[i];
+            if (dtor == nullptr)
+            {
+                continue;
+            }
+            void *value = pvTaskGetThreadLocalStoragePointer(nullptr, i);
+            if (value != nullptr)
+            {
+                vTaskSetThreadLocalStoragePointer(nullptr, i, nullptr);
+                dtor(value);
+            }
+        }
+    }
+
+#endif // (configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0)
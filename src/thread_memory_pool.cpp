@@ -0,0 +1,88 @@
+/**
+ * @file      thread_memory_pool.cpp
+ * @brief     Fixed block pool for single allocation threads
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/thread_memory_pool.h"
+#include "freertos/cpu.h"
+
+#ifdef configTHREAD_ALLOCATOR_INDEX
+
+using namespace freertos;
+
+thread_memory_pool_base::thread_memory_pool_base(void *blocks, std::size_t block_size, std::size_t count)
+    : free_list_(nullptr), block_size_(block_size)
+{
+    auto block = reinterpret_cast<unsigned char*>(blocks);
+    for (std::size_t i = count; i > 0; i--)
+    {
+        auto b = reinterpret_cast<free_block*>(block + (i - 1) * block_size);
+        b->next = free_list_;
+        free_list_ = b;
+    }
+}
+
+void *thread_memory_pool_base::allocate(std::size_t size)
+{
+    if (size > block_size_)
+    {
+        return nullptr;
+    }
+
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    free_block *b = free_list_;
+    if (b != nullptr)
+    {
+        free_list_ = b->next;
+    }
+    return b;
+}
+
+void thread_memory_pool_base::deallocate(void *block, std::size_t size)
+{
+    (void)size;
+    auto b = reinterpret_cast<free_block*>(block);
+
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    b->next = free_list_;
+    free_list_ = b;
+}
+
+std::size_t thread_memory_pool_base::get_free_count() const
+{
+    cpu::critical_section cs;
+    const lock_guard<decltype(cs)> lock(cs);
+
+    std::size_t count = 0;
+    for (free_block *b = free_list_; b != nullptr; b = b->next)
+    {
+        count++;
+    }
+    return count;
+}
+
+#endif // configTHREAD_ALLOCATOR_INDEX
@@ -36,17 +36,8 @@ namespace freertos
 using namespace freertos;
 using namespace freertos::native;
 
-tick_timer::time_point tick_timer::now()
-{
-    rep ticks;
-    if (!this_cpu::is_in_isr())
-    {
-        ticks = xTaskGetTickCount();
-    }
-    else
-    {
-        ticks = xTaskGetTickCountFromISR();
-    }
+#if (configINLINE_WRAPPERS != 1)
 
-    return time_point(duration(ticks));
-}
+#include "freertos/impl/tick_timer.inl"
+
+#endif // (configINLINE_WRAPPERS != 1)
@@ -39,6 +39,10 @@ using namespace freertos::native;
 
 #if (configUSE_TIMERS == 1)
 
+    // the wrapper adds no data to the kernel object
+    static_assert(sizeof(timed_service) == sizeof(StaticTimer_t),
+            "The timed_service wrapper must match the kernel object size.");
+
     timed_service::~timed_service()
     {
         configASSERT(!this_cpu::is_in_isr());
@@ -93,7 +97,7 @@ using namespace freertos::native;
 
     bool timed_service::start(tick_timer::duration waittime)
     {
-        if (!this_cpu::is_in_isr())
+        if (!this_cpu::uses_isr_api())
         {
             return xTimerStart(handle(), to_ticks(waittime));
         }
@@ -111,7 +115,7 @@ using namespace freertos::native;
 
     bool timed_service::stop(tick_timer::duration waittime)
     {
-        if (!this_cpu::is_in_isr())
+        if (!this_cpu::uses_isr_api())
         {
             return xTimerStop(handle(), to_ticks(waittime));
         }
@@ -129,7 +133,7 @@ using namespace freertos::native;
 
     bool timed_service::reset(tick_timer::duration waittime)
     {
-        if (!this_cpu::is_in_isr())
+        if (!this_cpu::uses_isr_api())
         {
             return xTimerReset(handle(), to_ticks(waittime));
         }
@@ -153,7 +157,7 @@ using namespace freertos::native;
 
     bool timed_service::set_period(tick_timer::duration new_period, tick_timer::duration waittime)
     {
-        if (!this_cpu::is_in_isr())
+        if (!this_cpu::uses_isr_api())
         {
             return xTimerChangePeriod(handle(), to_ticks(new_period), to_ticks(waittime));
         }
@@ -0,0 +1,355 @@
+/**
+ * @file      trace_recorder.cpp
+ * @brief     Binary scheduler trace recorder
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/trace_recorder.h"
+#include "freertos/trace_hooks.h"
+#include "freertos/tick_timer.h"
+#include <cstring>
+
+#if (configUSE_TRACE_RECORDER == 1)
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+#ifndef configTRACE_RECORDER_EVENTS
+#define configTRACE_RECORDER_EVENTS             1024
+#endif
+
+#ifndef configTRACE_TIMESTAMP
+    #if (configGENERATE_RUN_TIME_STATS == 1)
+    #define configTRACE_TIMESTAMP()             portGET_RUN_TIME_COUNTER_VALUE()
+    #define configTRACE_TIMESTAMP_RATE_HZ       configRUN_TIME_COUNTER_RATE_HZ
+    #else
+    #define configTRACE_TIMESTAMP()             xTaskGetTickCountFromISR()
+    #define configTRACE_TIMESTAMP_RATE_HZ       configTICK_RATE_HZ
+    #endif
+#endif
+
+static_assert((configTRACE_RECORDER_EVENTS & (configTRACE_RECORDER_EVENTS - 1)) == 0,
+        "The trace ring size must be a power of two.");
+
+// the event type values are shared with the C hooks
+static_assert(static_cast<unsigned>(trace_recorder::event::block_receive) == TRACE_EVENT_BLOCK_RECEIVE,
+        "These values must match!");
+static_assert(static_cast<unsigned>(trace_recorder::event::block_send) == TRACE_EVENT_BLOCK_SEND,
+        "These values must match!");
+static_assert(static_cast<unsigned>(trace_recorder::event::block_peek) == TRACE_EVENT_BLOCK_PEEK,
+        "These values must match!");
+static_assert(static_cast<unsigned>(trace_recorder::event::queue_send) == TRACE_EVENT_QUEUE_SEND,
+        "These values must match!");
+static_assert(static_cast<unsigned>(trace_recorder::event::queue_receive) == TRACE_EVENT_QUEUE_RECEIVE,
+        "These values must match!");
+
+namespace
+{
+    constexpr std::uint32_t RING_MASK = configTRACE_RECORDER_EVENTS - 1;
+    constexpr std::size_t MAX_NAME_LENGTH = 64;
+    // the characters are packed in the timestamp, info and object fields
+    constexpr std::size_t NAME_CHARS_PER_EVENT = sizeof(std::uint32_t) + sizeof(std::uint16_t)
+            + sizeof(std::uintptr_t);
+
+    trace_recorder::trace_event ring[configTRACE_RECORDER_EVENTS];
+    // the free running index of each slot's event + 1, written after the event,
+    // so the reader can tell a completed slot from one of the previous lap
+    std::atomic<std::uint32_t> sequence[configTRACE_RECORDER_EVENTS] {};
+    // both indexes are free running, only their difference matters
+    std::atomic<std::uint32_t> head {0};
+    std::atomic<std::uint32_t> tail {0};
+    std::atomic<std::uint32_t> dropped {0};
+    std::atomic<bool> recording {true};
+    std::atomic<bool> streaming {false};
+
+    trace_recorder::trace_event make_event(trace_recorder::event type, const void *object,
+            std::uint16_t info)
+    {
+        trace_recorder::trace_event e;
+        e.timestamp = static_cast<std::uint32_t>(configTRACE_TIMESTAMP());
+        e.type = type;
+        e.core = static_cast<std::uint8_t>(this_cpu::id());
+        e.info = info;
+        e.object = reinterpret_cast<std::uintptr_t>(object);
+        return e;
+    }
+}
+
+void trace_recorder::record_block(const trace_event *events, std::size_t count)
+{
+    if (!recording.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    // the reservation is lock-free, the interrupt masking only keeps the slot writing short
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    std::uint32_t h = head.load(std::memory_order_relaxed);
+    if (streaming.load(std::memory_order_relaxed))
+    {
+        do
+        {
+            if ((h + count - tail.load(std::memory_order_acquire)) > configTRACE_RECORDER_EVENTS)
+            {
+                dropped.fetch_add(count, std::memory_order_relaxed);
+                portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+                return;
+            }
+        }
+        while (!head.compare_exchange_weak(h, h + count, std::memory_order_acq_rel));
+    }
+    else
+    {
+        h = head.fetch_add(count, std::memory_order_acq_rel);
+    }
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const std::uint32_t index = (h + i) & RING_MASK;
+
+        // the sequence is written last, it marks the slot as complete for the reader
+        sequence[index].store(h + i, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        ring[index] = events[i];
+        sequence[index].store(h + i + 1, std::memory_order_release);
+    }
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+}
+
+void trace_recorder::record(event type, const void *object, std::uint16_t info)
+{
+    const trace_event e = make_event(type, object, info);
+    record_block(&e, 1);
+}
+
+void trace_recorder::name(const void *object, const char *name)
+{
+    constexpr std::size_t MAX_EVENTS = 1 + (MAX_NAME_LENGTH + NAME_CHARS_PER_EVENT - 1) / NAME_CHARS_PER_EVENT;
+    trace_event events[MAX_EVENTS];
+
+    std::size_t length = 0;
+    while ((length < MAX_NAME_LENGTH) && (name[length] != '\0'))
+    {
+        length++;
+    }
+    events[0] = make_event(event::name, object, static_cast<std::uint16_t>(length));
+
+    std::size_t count = 1;
+    for (std::size_t offset = 0; offset < length; offset += NAME_CHARS_PER_EVENT)
+    {
+        char chars[NAME_CHARS_PER_EVENT] = {};
+        std::memcpy(chars, name + offset,
+                ((length - offset) < NAME_CHARS_PER_EVENT) ? (length - offset) : NAME_CHARS_PER_EVENT);
+
+        trace_event& e = events[count++];
+        e.type = event::name_chars;
+        e.core = events[0].core;
+        std::memcpy(&e.timestamp, chars, sizeof(e.timestamp));
+        std::memcpy(&e.info, chars + sizeof(e.timestamp), sizeof(e.info));
+        std::memcpy(&e.object, chars + sizeof(e.timestamp) + sizeof(e.info), sizeof(e.object));
+    }
+
+    // the name events are reserved together, so they stay contiguous
+    record_block(events, count);
+}
+
+void trace_recorder::start(mode m)
+{
+    streaming.store(m == mode::streaming, std::memory_order_relaxed);
+    recording.store(true, std::memory_order_release);
+}
+
+void trace_recorder::stop()
+{
+    recording.store(false, std::memory_order_release);
+}
+
+bool trace_recorder::is_recording()
+{
+    return recording.load(std::memory_order_relaxed);
+}
+
+void trace_recorder::clear()
+{
+    tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    dropped.store(0, std::memory_order_relaxed);
+}
+
+std::size_t trace_recorder::read(trace_event *events, std::size_t max_events)
+{
+    std::uint32_t t = tail.load(std::memory_order_relaxed);
+    const std::uint32_t h = head.load(std::memory_order_acquire);
+
+    // in ring mode the oldest events may have been overwritten
+    if ((h - t) > configTRACE_RECORDER_EVENTS)
+    {
+        dropped.fetch_add(h - t - configTRACE_RECORDER_EVENTS, std::memory_order_relaxed);
+        t = h - configTRACE_RECORDER_EVENTS;
+    }
+
+    std::size_t n = 0;
+    while ((t != h) && (n < max_events))
+    {
+        const std::uint32_t index = t & RING_MASK;
+        if (sequence[index].load(std::memory_order_acquire) != (t + 1))
+        {
+            // the slot is still being written, or still holds the previous lap's event
+            break;
+        }
+        events[n] = ring[index];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence[index].load(std::memory_order_relaxed) != (t + 1))
+        {
+            // overwritten by a newer lap while copying, the next read skips it
+            break;
+        }
+        n++;
+        t++;
+    }
+
+    tail.store(t, std::memory_order_release);
+    return n;
+}
+
+std::size_t trace_recorder::get_dropped()
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+trace_recorder::trace_header trace_recorder::get_header()
+{
+    trace_header hdr;
+    std::memcpy(hdr.magic, "FRTR", sizeof(hdr.magic));
+    hdr.version = 1;
+    hdr.event_size = sizeof(trace_event);
+    hdr.pointer_size = sizeof(std::uintptr_t);
+    hdr.cores = native::NUMBER_OF_CORES;
+    hdr.timestamp_rate_Hz = configTRACE_TIMESTAMP_RATE_HZ;
+    hdr.dropped = dropped.load(std::memory_order_relaxed);
+    return hdr;
+}
+
+std::size_t trace_recorder::write(bool (*write)(void *context, const void *data, std::size_t size),
+        void *context)
+{
+    configASSERT(!this_cpu::is_in_isr());
+
+    const trace_header hdr = get_header();
+    if (!write(context, &hdr, sizeof(hdr)))
+    {
+        return 0;
+    }
+
+    std::size_t total = 0;
+    trace_event events[16];
+    std::size_t n;
+    while ((n = read(events, sizeof(events) / sizeof(events[0]))) > 0)
+    {
+        if (!write(context, events, n * sizeof(events[0])))
+        {
+            break;
+        }
+        total += n;
+    }
+    return total;
+}
+
+// the kernel trace macro hooks, see freertos/trace_hooks.h
+
+#ifdef configCONTEXT_SWITCH_COUNTER_INDEX
+    extern "C" void vTaskSwitchedInHook(void);
+#endif
+
+extern "C" void vTraceTaskSwitchedIn(void *pxTCB)
+{
+    #ifdef configCONTEXT_SWITCH_COUNTER_INDEX
+        vTaskSwitchedInHook();
+    #endif
+    trace_recorder::record(trace_recorder::event::task_switched_in, pxTCB);
+}
+
+extern "C" void vTraceTaskSwitchedOut(void *pxTCB)
+{
+    trace_recorder::record(trace_recorder::event::task_switched_out, pxTCB);
+}
+
+extern "C" void vTraceTaskCreate(void *pxTCB)
+{
+    trace_recorder::record(trace_recorder::event::task_create, pxTCB);
+    trace_recorder::name(pxTCB, pcTaskGetName(reinterpret_cast<TaskHandle_t>(pxTCB)));
+}
+
+extern "C" void vTraceTaskDelete(void *pxTCB)
+{
+    trace_recorder::record(trace_recorder::event::task_delete, pxTCB);
+}
+
+extern "C" void vTraceTaskReady(void *pxTCB)
+{
+    trace_recorder::record(trace_recorder::event::task_ready, pxTCB);
+}
+
+extern "C" void vTraceTaskDelay(void)
+{
+    trace_recorder::record(trace_recorder::event::task_delay, nullptr);
+}
+
+extern "C" void vTraceTaskNotify(void *pxTCB)
+{
+    trace_recorder::record(trace_recorder::event::task_notify, pxTCB);
+}
+
+extern "C" void vTraceTaskNotifyWait(void)
+{
+    trace_recorder::record(trace_recorder::event::task_notify_wait, nullptr);
+}
+
+extern "C" void vTraceQueueBlocking(unsigned char ucEvent, void *pxQueue)
+{
+    trace_recorder::record(static_cast<trace_recorder::event>(ucEvent), pxQueue);
+}
+
+extern "C" void vTraceQueueEvent(unsigned char ucEvent, void *pxQueue)
+{
+    trace_recorder::record(static_cast<trace_recorder::event>(ucEvent), pxQueue);
+}
+
+extern "C" void vTraceIsrEnter(unsigned short usIrq)
+{
+    trace_recorder::isr_enter(usIrq);
+}
+
+extern "C" void vTraceIsrExit(void)
+{
+    trace_recorder::isr_exit();
+}
+
+#endif // (configUSE_TRACE_RECORDER == 1)
@@ -0,0 +1,142 @@
+/**
+ * @file      wide_condition_flags.cpp
+ * @brief     Notification based condition flags of arbitrary width
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/wide_condition_flags.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+#if (configUSE_TASK_NOTIFICATIONS == 1)
+
+    flags_wait_list::~flags_wait_list()
+    {
+        configASSERT(head_ == nullptr);
+    }
+
+    void flags_wait_list::enqueue(waiter *w)
+    {
+        // waiting is only possible in thread context
+        configASSERT(!this_cpu::is_in_isr());
+
+        w->owner = thread::get_current();
+        w->notify = nullptr;
+        w->context = nullptr;
+
+        // discard any leftover signal from a previous, timed out wait
+        (void)w->owner->get_wakeup_notifier().cancel_signal();
+
+        append(w);
+    }
+
+    void flags_wait_list::enqueue(waiter *w, notify_function notify, void *context)
+    {
+        // the registering thread doesn't block, it is notified through the function
+        w->owner = nullptr;
+        w->notify = notify;
+        w->context = context;
+
+        append(w);
+    }
+
+    void flags_wait_list::append(waiter *w)
+    {
+        w->next = nullptr;
+        w->satisfied = false;
+
+        // FIFO order
+        waiter **pw = &head_;
+        while (*pw != nullptr)
+        {
+            pw = &(*pw)->next;
+        }
+        *pw = w;
+    }
+
+    void flags_wait_list::dequeue(waiter *w)
+    {
+        for (waiter **pw = &head_; *pw != nullptr; pw = &(*pw)->next)
+        {
+            if (*pw == w)
+            {
+                *pw = w->next;
+                break;
+            }
+        }
+    }
+
+    void flags_wait_list::wake(waiter *w)
+    {
+        // the waiter is already removed from the list,
+        // and it cannot leave until the critical section is unlocked
+        w->satisfied = true;
+        if (w->notify != nullptr)
+        {
+            w->notify(w->context);
+        }
+        else
+        {
+            w->owner->get_wakeup_notifier().signal();
+        }
+    }
+
+    bool flags_wait_list::suspend(waiter *w, const tick_timer::duration& rel_time)
+    {
+        const auto start = tick_timer::now();
+        auto remaining = rel_time;
+
+        for (;;)
+        {
+            (void)this_thread::wait_wakeup_for(remaining);
+
+            cpu::critical_section cs;
+            const lock_guard<decltype(cs)> lock(cs);
+
+            // other notifications on the same index might wake the thread
+            // without it being satisfied, so the state is always verified
+            if (w->satisfied)
+            {
+                return true;
+            }
+            else if (rel_time != infinity)
+            {
+                const auto elapsed = tick_timer::now() - start;
+                if (elapsed >= rel_time)
+                {
+                    dequeue(w);
+                    return false;
+                }
+                remaining = rel_time - elapsed;
+            }
+        }
+    }
+
+#endif // (configUSE_TASK_NOTIFICATIONS == 1)
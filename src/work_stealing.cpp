@@ -0,0 +1,367 @@
+/**
+ * @file      work_stealing.cpp
+ * @brief     Work-stealing task scheduler with a worker on each core
+ * @author    Benedek Kupper
+ *
+ * Copyright (c) 2021 Benedek Kupper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "freertos/work_stealing.h"
+#include "freertos/cpu.h"
+
+namespace freertos
+{
+    namespace native
+    {
+        #include "task.h"
+    }
+}
+using namespace freertos;
+using namespace freertos::native;
+
+#if (configUSE_TASK_NOTIFICATIONS == 1)
+
+    task_group::task_group()
+        : owner_(thread::get_current()), pending_(0)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+
+        // discard any leftover signal from a previous wait
+        (void)owner_->get_wakeup_notifier().cancel_signal();
+    }
+
+    task_group::~task_group()
+    {
+        configASSERT(done());
+    }
+
+    void task_group::complete()
+    {
+        // the object may be destroyed as soon as the counter reaches zero
+        thread *owner = owner_;
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            owner->get_wakeup_notifier().signal();
+        }
+    }
+
+    bool work_deque::push(stealable_task *t)
+    {
+        std::ptrdiff_t b = bottom_.load(std::memory_order_relaxed);
+        std::ptrdiff_t top = top_.load(std::memory_order_acquire);
+        if (static_cast<std::size_t>(b - top) > mask_)
+        {
+            return false;
+        }
+        buffer_[b & mask_].store(t, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    stealable_task *work_deque::pop()
+    {
+        std::ptrdiff_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::ptrdiff_t top = top_.load(std::memory_order_relaxed);
+
+        stealable_task *t = nullptr;
+        if (top <= b)
+        {
+            t = buffer_[b & mask_].load(std::memory_order_relaxed);
+            if (top == b)
+            {
+                // last element, race against the thieves
+                if (!top_.compare_exchange_strong(top, top + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    t = nullptr;
+                }
+                bottom_.store(b + 1, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            // empty
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return t;
+    }
+
+    stealable_task *work_deque::steal()
+    {
+        std::ptrdiff_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::ptrdiff_t b = bottom_.load(std::memory_order_acquire);
+
+        stealable_task *t = nullptr;
+        if (top < b)
+        {
+            t = buffer_[top & mask_].load(std::memory_order_relaxed);
+            if (!top_.compare_exchange_strong(top, top + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                t = nullptr;
+            }
+        }
+        return t;
+    }
+
+    work_stealing_scheduler_base::worker *work_stealing_scheduler_base::find_worker(thread *t) const
+    {
+        for (std::size_t i = 0; i < count_; i++)
+        {
+            if (workers_[i].handle.load(std::memory_order_acquire) == t)
+            {
+                return &workers_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void work_stealing_scheduler_base::wake_one(const worker *except)
+    {
+        for (std::size_t i = 0; i < count_; i++)
+        {
+            worker *w = &workers_[i];
+            bool sleeping = true;
+            if ((w != except) &&
+                w->sleeping.compare_exchange_strong(sleeping, false, std::memory_order_seq_cst))
+            {
+                w->handle.load(std::memory_order_acquire)->get_wakeup_notifier().signal();
+                break;
+            }
+        }
+    }
+
+    void work_stealing_scheduler_base::spawn(task_group& group, stealable_task& t)
+    {
+        t.group_ = &group;
+        group.add();
+
+        worker *self = find_worker(thread::get_current());
+        if (self != nullptr)
+        {
+            if (!self->deque.push(&t))
+            {
+                // deque is full, execute in place
+                execute(&t);
+                return;
+            }
+        }
+        else
+        {
+            // hand over to the workers in a round-robin fashion, lock-free
+            worker *w = &workers_[next_inbox_.fetch_add(1, std::memory_order_relaxed) % count_];
+            stealable_task *head = w->inbox.load(std::memory_order_relaxed);
+            do
+            {
+                t.next_ = head;
+            }
+            while (!w->inbox.compare_exchange_weak(head, &t,
+                    std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        // any parked worker can take the task, as the inboxes are stealable too
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake_one(self);
+    }
+
+    stealable_task *work_stealing_scheduler_base::take_inbox(worker *from, worker *w)
+    {
+        // the whole list is taken at once, so any worker can take it
+        stealable_task *t = from->inbox.exchange(nullptr, std::memory_order_acquire);
+        if (t != nullptr)
+        {
+            // move the rest of the handed over tasks to the deque, so they can be stolen
+            stealable_task *next;
+            for (stealable_task *other = t->next_; other != nullptr; other = next)
+            {
+                next = other->next_;
+                if (!w->deque.push(other))
+                {
+                    // deque is full, put the rest to the own inbox
+                    stealable_task *head = w->inbox.load(std::memory_order_relaxed);
+                    stealable_task *last = other;
+                    while (last->next_ != nullptr)
+                    {
+                        last = last->next_;
+                    }
+                    do
+                    {
+                        last->next_ = head;
+                    }
+                    while (!w->inbox.compare_exchange_weak(head, other,
+                            std::memory_order_release, std::memory_order_relaxed));
+                    break;
+                }
+            }
+        }
+        return t;
+    }
+
+    stealable_task *work_stealing_scheduler_base::steal_from(worker *victim, worker *w)
+    {
+        stealable_task *t = victim->deque.steal();
+        if (t == nullptr)
+        {
+            // the victim's handed over tasks are stolen as well, its owner may be busy for long
+            t = take_inbox(victim, w);
+        }
+        return t;
+    }
+
+    stealable_task *work_stealing_scheduler_base::find_task(worker *w)
+    {
+        stealable_task *t = w->deque.pop();
+        if (t != nullptr)
+        {
+            return t;
+        }
+
+        t = take_inbox(w, w);
+        if (t != nullptr)
+        {
+            return t;
+        }
+
+        // steal from random victims
+        for (std::size_t attempt = 0; attempt < 2 * count_; attempt++)
+        {
+            // xorshift32
+            w->seed ^= w->seed << 13;
+            w->seed ^= w->seed >> 17;
+            w->seed ^= w->seed << 5;
+
+            worker *victim = &workers_[w->seed % count_];
+            if (victim != w)
+            {
+                t = steal_from(victim, w);
+                if (t != nullptr)
+                {
+                    return t;
+                }
+            }
+        }
+
+        // visit all victims before giving up, so a worker doesn't park while there is work
+        for (std::size_t i = 0; i < count_; i++)
+        {
+            if (&workers_[i] != w)
+            {
+                t = steal_from(&workers_[i], w);
+                if (t != nullptr)
+                {
+                    return t;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    void work_stealing_scheduler_base::execute(stealable_task *t)
+    {
+        task_group *group = t->group_;
+        t->fn_(t);
+        group->complete();
+    }
+
+    void work_stealing_scheduler_base::wait(task_group& group)
+    {
+        configASSERT(!this_cpu::is_in_isr());
+
+        worker *w = find_worker(thread::get_current());
+        while (!group.done())
+        {
+            if (w != nullptr)
+            {
+                // help with the work while waiting
+                stealable_task *t = find_task(w);
+                if (t != nullptr)
+                {
+                    execute(t);
+                    continue;
+                }
+
+                // the remaining tasks are being executed by other workers,
+                // park until the group completes or new work is spawned
+                w->sleeping.store(true, std::memory_order_seq_cst);
+                t = find_task(w);
+                if (t != nullptr)
+                {
+                    w->sleeping.store(false, std::memory_order_relaxed);
+                    execute(t);
+                    continue;
+                }
+                if (!group.done())
+                {
+                    // task_group::complete() signals the waiter
+                    (void)this_thread::wait_wakeup_for(infinity);
+                }
+                w->sleeping.store(false, std::memory_order_relaxed);
+            }
+            else
+            {
+                (void)this_thread::wait_wakeup_for(infinity);
+            }
+        }
+    }
+
+    void work_stealing_scheduler_base::work(worker *w)
+    {
+        work_stealing_scheduler_base *sched = w->owner;
+        w->handle.store(thread::get_current(), std::memory_order_release);
+
+        // pin the worker to its core before it takes any work
+        #if (configNUMBER_OF_CORES > 1) && (configUSE_CORE_AFFINITY == 1)
+
+            thread::get_current()->set_affinity(thread::affinity_mask(1) << w->index);
+
+        #endif
+
+        for (;;)
+        {
+            stealable_task *t = sched->find_task(w);
+            if (t != nullptr)
+            {
+                sched->execute(t);
+                continue;
+            }
+
+            // announce parking, then check again for work that arrived in the meantime
+            (void)thread::get_current()->get_wakeup_notifier().cancel_signal();
+            w->sleeping.store(true, std::memory_order_seq_cst);
+            t = sched->find_task(w);
+            if (t != nullptr)
+            {
+                w->sleeping.store(false, std::memory_order_relaxed);
+                sched->execute(t);
+                continue;
+            }
+
+            while (w->sleeping.load(std::memory_order_acquire))
+            {
+                (void)this_thread::wait_wakeup_for(infinity);
+            }
+        }
+    }
+
+#endif // (configUSE_TASK_NOTIFICATIONS == 1)
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+Reports the code size (.text) of each freertos wrapper function in the given
+object or ELF files, which is the abstraction cost on top of the kernel API calls
+(the object sizes are checked at compile time against the kernel's static structures).
+The report can be saved and used as baseline, to detect code size regressions.
+
+usage: footprint.py [--nm <nm>] [--save <report.json>] [--baseline <report.json>]
+                    [--threshold <bytes>] <file>...
+"""
+import argparse
+import json
+import subprocess
+import sys
+
+TEXT_TYPES = 'tTwW'
+NAMESPACE = 'freertos::'
+
+
+def read_symbols(nm, files):
+    sizes = {}
+    output = subprocess.run([nm, '--demangle', '--print-size', '--size-sort'] + files,
+                            check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+    for line in output.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) < 4 or fields[2] not in TEXT_TYPES:
+            continue
+        name = fields[3]
+        if not name.startswith(NAMESPACE) or name.startswith(NAMESPACE + 'native::'):
+            continue
+        # inline functions may be emitted in several objects, they are merged by the linker
+        sizes[name] = max(sizes.get(name, 0), int(fields[1], 16))
+    return sizes
+
+
+def class_of(name):
+    scope = name.split('(', 1)[0]
+    return scope.rsplit('::', 1)[0] if scope.count('::') > 1 else NAMESPACE.rstrip(':')
+
+
+def print_report(sizes, baseline):
+    classes = {}
+    for name, size in sizes.items():
+        classes.setdefault(class_of(name), []).append((name, size))
+    total = 0
+    for cls in sorted(classes):
+        functions = sorted(classes[cls], key=lambda f: -f[1])
+        cls_size = sum(size for _, size in functions)
+        total += cls_size
+        print('{:<80} {:>8}'.format(cls, cls_size))
+        for name, size in functions:
+            delta = ''
+            if baseline is not None:
+                delta = '{:+d}'.format(size - baseline[name]) if name in baseline else 'new'
+            print('  {:<78} {:>8} {:>8}'.format(name, size, delta))
+    print('{:<80} {:>8}'.format('total', total))
+
+
+def regressions(sizes, baseline, threshold):
+    return [(name, baseline.get(name, 0), size) for name, size in sorted(sizes.items())
+            if size - baseline.get(name, 0) > threshold]
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0].strip())
+    parser.add_argument('files', nargs='+')
+    parser.add_argument('--nm', default='nm', help='the toolchain\'s nm (e.g. arm-none-eabi-nm)')
+    parser.add_argument('--save', help='write the report to this JSON file')
+    parser.add_argument('--baseline', help='compare against this JSON report')
+    parser.add_argument('--threshold', type=int, default=0,
+                        help='allowed growth of a function in bytes before failing')
+    args = parser.parse_args(argv[1:])
+
+    sizes = read_symbols(args.nm, args.files)
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    print_report(sizes, baseline)
+
+    if args.save:
+        with open(args.save, 'w') as f:
+            json.dump(sizes, f, indent=1, sort_keys=True)
+
+    if baseline is not None:
+        grown = regressions(sizes, baseline, args.threshold)
+        for name, old, new in grown:
+            sys.stderr.write('{}: {} -> {} bytes\n'.format(name, old, new))
+        if grown:
+            return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""
+Converts the binary output of freertos::trace_recorder to Chrome trace JSON,
+which can be opened with chrome://tracing or https://ui.perfetto.dev
+
+usage: trace2chrome.py <trace.bin> [<trace.json>]
+"""
+import json
+import struct
+import sys
+
+HEADER = struct.Struct('<4sBBBBII')
+
+# must match freertos::trace_recorder::event
+EVENTS = [
+    'none', 'task_switched_in', 'task_switched_out', 'task_create', 'task_delete', 'task_ready',
+    'task_delay', 'task_notify_wait', 'block_receive', 'block_send', 'block_peek',
+    'queue_send', 'queue_receive', 'task_notify', 'isr_enter', 'isr_exit', 'api_call', 'user',
+    'name', 'name_chars',
+]
+
+# must match freertos::trace_recorder::api
+APIS = [
+    'queue::push_front', 'queue::push_back', 'queue::pop_front',
+    'semaphore::acquire', 'semaphore::release', 'thread::notify',
+]
+
+CORES_PID = 0
+THREADS_PID = 1
+ISR_TID_OFFSET = 1000
+
+
+def read_events(data):
+    magic, version, event_size, pointer_size, cores, rate, dropped = HEADER.unpack_from(data)
+    if magic != b'FRTR' or version != 1:
+        raise ValueError('not a trace recorder output')
+    object_offset = event_size - pointer_size
+    object_format = '<I' if pointer_size == 4 else '<Q'
+    events = []
+    for offset in range(HEADER.size, len(data) - event_size + 1, event_size):
+        raw = data[offset:offset + event_size]
+        timestamp, type_, core, info = struct.unpack_from('<IBBH', raw)
+        obj, = struct.unpack_from(object_format, raw, object_offset)
+        chars = raw[0:4] + raw[6:8] + raw[object_offset:object_offset + pointer_size]
+        events.append((timestamp, type_, core, info, obj, chars))
+    return rate, cores, dropped, events
+
+
+def kind_of(type_):
+    return EVENTS[type_] if type_ < len(EVENTS) else 'unknown'
+
+
+def collect_names(events):
+    names = {}
+    for i, (_, type_, _, info, obj, _) in enumerate(events):
+        if kind_of(type_) == 'name':
+            text = b''
+            for following in events[i + 1:]:
+                if len(text) >= info or kind_of(following[1]) != 'name_chars':
+                    break
+                text += following[5]
+            names[obj] = text[:info].decode('utf-8', 'replace')
+    return names
+
+
+def convert(data):
+    rate, cores, dropped, events = read_events(data)
+    # the names are resolved up front, so the objects named later are also labeled
+    names = collect_names(events)
+    out = []
+    thread_ids = {}
+    running = {}  # core -> (object, start)
+    epoch = 0
+    previous = None
+
+    def thread_id(obj):
+        if obj not in thread_ids:
+            thread_ids[obj] = len(thread_ids) + 1
+        return thread_ids[obj]
+
+    def name_of(obj):
+        return names.get(obj, '0x%x' % obj)
+
+    def slice_end(core, ts):
+        if core in running:
+            obj, start = running.pop(core)
+            for pid, tid in ((CORES_PID, core), (THREADS_PID, thread_id(obj))):
+                out.append({'name': name_of(obj), 'ph': 'X', 'pid': pid, 'tid': tid,
+                            'ts': start, 'dur': ts - start})
+
+    def instant(name, pid, tid, ts, args=None):
+        e = {'name': name, 'ph': 'i', 's': 't', 'pid': pid, 'tid': tid, 'ts': ts}
+        if args:
+            e['args'] = args
+        out.append(e)
+
+    for timestamp, type_, core, info, obj, _ in events:
+        kind = kind_of(type_)
+
+        if kind in ('none', 'name', 'name_chars'):
+            continue
+
+        # the 32 bit timestamps wrap around, the cores' timestamps can slightly differ
+        if previous is not None and timestamp < previous and (previous - timestamp) > (1 << 31):
+            epoch += 1 << 32
+        previous = timestamp
+        ts = (epoch + timestamp) * 1e6 / rate
+
+        current = running.get(core, (None, None))[0]
+        if kind == 'task_switched_in':
+            slice_end(core, ts)
+            running[core] = (obj, ts)
+        elif kind == 'task_switched_out':
+            slice_end(core, ts)
+        elif kind == 'isr_enter':
+            out.append({'name': 'ISR %d' % info, 'ph': 'B', 'pid': CORES_PID,
+                        'tid': ISR_TID_OFFSET + core, 'ts': ts})
+        elif kind == 'isr_exit':
+            out.append({'ph': 'E', 'pid': CORES_PID, 'tid': ISR_TID_OFFSET + core, 'ts': ts})
+        elif kind in ('task_create', 'task_delete', 'task_ready', 'task_notify'):
+            instant(kind, THREADS_PID, thread_id(obj), ts)
+        elif current is not None:
+            if kind == 'api_call':
+                label = APIS[info] if info < len(APIS) else 'api %d' % info
+                instant(label, THREADS_PID, thread_id(current), ts, {'object': name_of(obj)})
+            elif kind == 'user':
+                instant('user %d' % info, THREADS_PID, thread_id(current), ts, {'object': name_of(obj)})
+            else:
+                instant(kind, THREADS_PID, thread_id(current), ts, {'object': name_of(obj)} if obj else None)
+
+    if events:
+        last = (epoch + previous) * 1e6 / rate if previous is not None else 0
+        for core in list(running):
+            slice_end(core, last)
+
+    meta = [{'name': 'process_name', 'ph': 'M', 'pid': CORES_PID, 'args': {'name': 'Cores'}},
+            {'name': 'process_name', 'ph': 'M', 'pid': THREADS_PID, 'args': {'name': 'Threads'}}]
+    for core in range(cores):
+        meta.append({'name': 'thread_name', 'ph': 'M', 'pid': CORES_PID, 'tid': core,
+                     'args': {'name': 'Core %d' % core}})
+        meta.append({'name': 'thread_name', 'ph': 'M', 'pid': CORES_PID, 'tid': ISR_TID_OFFSET + core,
+                     'args': {'name': 'Core %d ISRs' % core}})
+    for obj, tid in thread_ids.items():
+        meta.append({'name': 'thread_name', 'ph': 'M', 'pid': THREADS_PID, 'tid': tid,
+                     'args': {'name': name_of(obj)}})
+
+    return {'traceEvents': meta + out, 'displayTimeUnit': 'ns',
+            'otherData': {'dropped_events': dropped}}
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write(__doc__)
+        return 1
+    with open(argv[1], 'rb') as f:
+        trace = convert(f.read())
+    if len(argv) > 2:
+        with open(argv[2], 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))